@@ -3,6 +3,8 @@
 rm -Rf build
 rm -Rf release
 rm -Rf debug
+rm -Rf bench
+rm -Rf test
 rm -f Makefile
 rm -f Makefile.*
 rm -f ddroom
@@ -76,6 +76,8 @@ HEADERS	= \
 	src/cms_matrix.h \
 \
 	src/batch.h \
+	src/render.h \
+	src/render_server.h \
 	src/batch_dialog.h \
 	src/export.h \
 \
@@ -160,6 +162,8 @@ SOURCES	= \
 	src/cms_matrix.cpp \
 \
 	src/batch.cpp \
+	src/render.cpp \
+	src/render_server.cpp \
 	src/batch_dialog.cpp \
 	src/export.cpp \
 \
@@ -225,7 +229,7 @@ win32 {
 	QMAKE_CXXFLAGS_RELEASE += -O2
 }
 
-QT += widgets svg xml
+QT += widgets svg xml network
 
 debug:DESTDIR = debug
 debug:target.path = ./
@@ -0,0 +1,16 @@
+# Benchmark of processing pipeline with synthetic raw photos, w/o GUI:
+#   qmake ddroom_bench.pro && make && ./bench/ddroom_bench --help
+include(ddroom.pro)
+
+SOURCES -= src/main.cpp
+SOURCES += src/bench.cpp
+
+CONFIG -= debug_and_release
+CONFIG += release console
+
+TARGET = ddroom_bench
+DESTDIR = bench
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
@@ -0,0 +1,16 @@
+# Stress test of concurrent raw decoding with DCRaw, w/o GUI:
+#   qmake ddroom_dcraw_test.pro && make && ./test/ddroom_dcraw_test --help
+include(ddroom.pro)
+
+SOURCES -= src/main.cpp
+SOURCES += src/dcraw_test.cpp
+
+CONFIG -= debug_and_release
+CONFIG += release console
+
+TARGET = ddroom_dcraw_test
+DESTDIR = test
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
@@ -0,0 +1,16 @@
+# Test of supersampling kernel of geometry filters against the reference, w/o GUI:
+#   qmake ddroom_gp_test.pro && make && ./test/ddroom_gp_test
+include(ddroom.pro)
+
+SOURCES -= src/main.cpp
+SOURCES += src/gp_test.cpp
+
+CONFIG -= debug_and_release
+CONFIG += release console
+
+TARGET = ddroom_gp_test
+DESTDIR = test
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
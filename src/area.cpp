@@ -19,6 +19,7 @@
 #include <cstring>
 
 #include "area.h"
+#include "area_helper.h"
 #include "ddr_math.h"
 #include "mt.h"
 #include "system.h"
@@ -195,6 +196,10 @@ int16_t Area::type_to_sizeof(Area::type_t t) {
 		return sizeof(uint8_t) * 4;
 	else if(t == Area::type_t::uint8_p3)
 		return sizeof(uint8_t) * 3;
+	else if(t == Area::type_t::half_p4)
+		return sizeof(uint16_t) * 4;
+	else if(t == Area::type_t::uint16_p1)
+		return sizeof(uint16_t);
 	return 0;
 }
 
@@ -219,6 +224,10 @@ std::string Area::type_to_name(Area::type_t t) {
 		return "type_uint8_p3";
 	if(t == Area::type_t::float_p1)
 		return "type_float_p1";
+	else if(t == Area::type_t::half_p4)
+		return "type_half_p4";
+	else if(t == Area::type_t::uint16_p1)
+		return "type_uint16_p1";
 	return "unknown";
 }
 
@@ -374,8 +383,59 @@ public:
 	float scale_y;
 	float in_x_off;
 	float in_y_off;
+	// weights of separable scaling, or 'nullptr'
+	const AreaHelper::resample_table_t *table_x;
+	const AreaHelper::resample_table_t *table_y;
 };
 
+// weights for 'windowed' downscaling, the same as at 'scale_process_downscale()'
+static void scale_table_downscale(AreaHelper::resample_table_t *table, float f_offset, float scale, int in_min, int in_size, int out_size) {
+	std::vector<float> w;
+	for(int i = 0; i < out_size; ++i) {
+		const float f_in = f_offset + scale * i;
+		int in = floor(f_in);
+		float d = scale;
+		float w_in = 1.0 - (f_in - in);
+		int first = -1;
+		w.clear();
+		while(d > 0.0) {
+			if(in >= 0 && in < in_size) {
+				if(first < 0)
+					first = in;
+				w.push_back(w_in / scale);
+			}
+			d -= w_in;
+			if(d >= 1.0)	w_in = 1.0;
+			else			w_in = d;
+			in++;
+		}
+		table->push(in_min + ((first < 0) ? 0 : first), w.data(), w.size());
+	}
+}
+
+// weights for bilinear upscaling, the same as at 'scale_process_upscale()'
+static void scale_table_upscale(AreaHelper::resample_table_t *table, float f_offset, float scale, int in_min, int in_size, int out_size) {
+	for(int i = 0; i < out_size; ++i) {
+		const float f_in = f_offset + scale * i;
+		float floor_in = floor(f_in);
+		int in = floor_in;
+		float w[2];
+		w[1] = f_in - floor_in;
+		w[0] = 1.0 - w[1];
+		if(in < 0) {
+			in = 0;
+			w[0] = 1.0;
+			w[1] = 0.0;
+		}
+		if(in >= in_size - 1) {
+			in = in_size - 2;
+			w[0] = 0.0;
+			w[1] = 1.0;
+		}
+		table->push(in_min + in, w, 2);
+	}
+}
+
 std::unique_ptr<Area> Area::scale(SubFlow *subflow, int out_w, int out_h, float out_scale_x, float out_scale_y) {
 // TODO: check original 'px_size' asked by View and 'out_scale'
 	// TODO: utilize t_dimensions::position, support of scaling with tiles
@@ -383,6 +443,8 @@ std::unique_ptr<Area> Area::scale(SubFlow *subflow, int out_w, int out_h, float
 	std::unique_ptr<Area> area_out;
 	std::vector<std::unique_ptr<scale_task_t>> tasks(0);
 	std::unique_ptr<std::atomic_int> y_flow;
+	std::unique_ptr<AreaHelper::resample_table_t> table_x;
+	std::unique_ptr<AreaHelper::resample_table_t> table_y;
 
 	if(subflow->sync_point_pre()) {
 		Area::t_dimensions *d_in = this->dimensions();
@@ -418,6 +480,28 @@ cerr << "out size == " << out_w << "x" << out_h << endl;
 
 		// TODO: apply correct offsets/px_size to area_out
 		D_AREA_PTR(area_out);
+
+		// axis-aligned scaling is separable, so weights are calculated once for each column and row
+		const float scale_factor = (out_scale_x + out_scale_y) / 2.0;
+		if(type() == Area::type_t::float_p4 && scale_factor != 1.0 && d_in->width() > 1 && d_in->height() > 1) {
+			const float f_offset_x = in_x_off - int(in_x_off);
+			const float f_offset_y = in_y_off - int(in_y_off);
+			table_x = std::unique_ptr<AreaHelper::resample_table_t>(new AreaHelper::resample_table_t);
+			table_y = std::unique_ptr<AreaHelper::resample_table_t>(new AreaHelper::resample_table_t);
+			if(System::instance()->resample_lanczos()) {
+				// centers of windows of 'scale_table_downscale()', and of points of 'scale_table_upscale()'
+				const float center_x = (scale_factor > 1.0) ? f_offset_x + (out_scale_x - 1.0) * 0.5 : f_offset_x;
+				const float center_y = (scale_factor > 1.0) ? f_offset_y + (out_scale_y - 1.0) * 0.5 : f_offset_y;
+				AreaHelper::resample_table_lanczos3(table_x.get(), center_x, out_scale_x, d_in->edges.x1, d_in->width(), out_w);
+				AreaHelper::resample_table_lanczos3(table_y.get(), center_y, out_scale_y, d_in->edges.y1, d_in->height(), out_h);
+			} else if(scale_factor > 1.0) {
+				scale_table_downscale(table_x.get(), f_offset_x, out_scale_x, d_in->edges.x1, d_in->width(), out_w);
+				scale_table_downscale(table_y.get(), f_offset_y, out_scale_y, d_in->edges.y1, d_in->height(), out_h);
+			} else {
+				scale_table_upscale(table_x.get(), f_offset_x, out_scale_x, d_in->edges.x1, d_in->width(), out_w);
+				scale_table_upscale(table_y.get(), f_offset_y, out_scale_y, d_in->edges.y1, d_in->height(), out_h);
+			}
+		}
 		const int threads_count = subflow->threads_count();
 //		tasks = new scale_task_t *[threads_count];
 		tasks.resize(threads_count);
@@ -433,18 +517,23 @@ cerr << "out size == " << out_w << "x" << out_h << endl;
 			task->y_flow = y_flow.get();
 			task->in_x_off = in_x_off;
 			task->in_y_off = in_y_off;
+			task->table_x = table_x.get();
+			task->table_y = table_y.get();
 
 			subflow->set_private(task, i);
 		}
 	}
 	subflow->sync_point_post();
 
-	float scale_factor_x = ((scale_task_t *)subflow->get_private())->scale_x;
-	float scale_factor_y = ((scale_task_t *)subflow->get_private())->scale_y;
+	scale_task_t *task = (scale_task_t *)subflow->get_private();
+	float scale_factor_x = task->scale_x;
+	float scale_factor_y = task->scale_y;
 	float scale_factor = (scale_factor_x + scale_factor_y) / 2.0;
 	if(scale_factor == 1.0) {
 //cerr << "scale_process_copy()" << endl;
 		scale_process_copy(subflow);
+	} else if(task->table_x != nullptr) {
+		AreaHelper::resample_separable(subflow, task->area_in, task->area_out, task->table_x, task->table_y);
 	} else {
 		if(scale_factor > 1.0) {
 //cerr << "scale > 1.0, downscale: " << scale_factor << endl;
@@ -510,29 +599,32 @@ cerr << "area_out->dimensions()->position.y == " << area_out->dimensions()->posi
 cerr << "area_out->dimensions()->position.px_size == " << area_out->dimensions()->position.px_size << endl;
 */
 
-	int y = 0;
 	if(flag_8b == false) {
-		while((y = task->y_flow->fetch_add(1)) < out_h) {
-			for(int x = 0; x < out_w; ++x) {
-				int index_in = ((y + in_y_offset) * in_width + x + in_x_offset) * 4;
-				int index_out = ((y + out_y_offset) * out_width + x + out_x_offset) * 4;
-				_out[index_out + 0] = _in[index_in + 0];
-				_out[index_out + 1] = _in[index_in + 1];
-				_out[index_out + 2] = _in[index_in + 2];
-				_out[index_out + 3] = _in[index_in + 3];
+		subflow->for_rows(task->y_flow, out_h, [&](int y_begin, int y_end) {
+			for(int y = y_begin; y < y_end; ++y) {
+				for(int x = 0; x < out_w; ++x) {
+					int index_in = ((y + in_y_offset) * in_width + x + in_x_offset) * 4;
+					int index_out = ((y + out_y_offset) * out_width + x + out_x_offset) * 4;
+					_out[index_out + 0] = _in[index_in + 0];
+					_out[index_out + 1] = _in[index_in + 1];
+					_out[index_out + 2] = _in[index_in + 2];
+					_out[index_out + 3] = _in[index_in + 3];
+				}
 			}
-		}
+		});
 	} else {
-		while((y = task->y_flow->fetch_add(1)) < out_h) {
-			for(int x = 0; x < out_w; ++x) {
-				int index_in = ((y + in_y_offset) * in_width + x + in_x_offset) * 4;
-				int index_out = ((y + out_y_offset) * out_width + x + out_x_offset) * 4;
-				u_out[index_out + 0] = u_in[index_in + 0];
-				u_out[index_out + 1] = u_in[index_in + 1];
-				u_out[index_out + 2] = u_in[index_in + 2];
-				u_out[index_out + 3] = u_in[index_in + 3];
+		subflow->for_rows(task->y_flow, out_h, [&](int y_begin, int y_end) {
+			for(int y = y_begin; y < y_end; ++y) {
+				for(int x = 0; x < out_w; ++x) {
+					int index_in = ((y + in_y_offset) * in_width + x + in_x_offset) * 4;
+					int index_out = ((y + out_y_offset) * out_width + x + out_x_offset) * 4;
+					u_out[index_out + 0] = u_in[index_in + 0];
+					u_out[index_out + 1] = u_in[index_in + 1];
+					u_out[index_out + 2] = u_in[index_in + 2];
+					u_out[index_out + 3] = u_in[index_in + 3];
+				}
 			}
-		}
+		});
 	}
 }
 
@@ -579,83 +671,84 @@ void Area::scale_process_downscale(SubFlow *subflow) {
 	const float scale_x = task->scale_x;
 	const float scale_y = task->scale_y;
 	const float w_div = scale_x * scale_y;
-	int j = 0;
-	while((j = task->y_flow->fetch_add(1)) < j_max) {
-		int out_y = j;
-		const float f_in_y = f_offset_y + scale_y * j;
-		for(int i = 0; i < i_max; ++i) {
-			int out_x = i;
-			const float f_in_x = f_offset_x + scale_x * i;
-			// accumulator
-			float px[4];
-			for(int k = 0; k < 4; ++k)
-				px[k] = 0.0;
-			// process window
-			int in_y = floor(f_in_y);
-			float dy = scale_y;
-			float wy = 1.0 - (f_in_y - in_y);
-			while(dy > 0.0) {
-				int in_x = floor(f_in_x);
-				float dx = scale_x;
-				float wx = 1.0 - (f_in_x - in_x);
-				while(dx > 0.0) {
-					// sum pixels
-					float weight = wx * wy;
+	subflow->for_rows(task->y_flow, j_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			int out_y = j;
+			const float f_in_y = f_offset_y + scale_y * j;
+			for(int i = 0; i < i_max; ++i) {
+				int out_x = i;
+				const float f_in_x = f_offset_x + scale_x * i;
+				// accumulator
+				float px[4];
+				for(int k = 0; k < 4; ++k)
+					px[k] = 0.0;
+				// process window
+				int in_y = floor(f_in_y);
+				float dy = scale_y;
+				float wy = 1.0 - (f_in_y - in_y);
+				while(dy > 0.0) {
+					int in_x = floor(f_in_x);
+					float dx = scale_x;
+					float wx = 1.0 - (f_in_x - in_x);
+					while(dx > 0.0) {
+						// sum pixels
+						float weight = wx * wy;
 /*
-					int x = in_x;
-					if(in_x < 0)		x = 0;
-					if(in_x >= in_w)	x = in_w - 1;
-					int y = in_y;
-					if(in_y < 0)		y = 0;
-					if(in_y >= in_h)	y = in_h - 1;
+						int x = in_x;
+						if(in_x < 0)		x = 0;
+						if(in_x >= in_w)	x = in_w - 1;
+						int y = in_y;
+						if(in_y < 0)		y = 0;
+						if(in_y >= in_h)	y = in_h - 1;
 */
-					bool flag_out = false;
-					int x = in_x;
-					flag_out |= in_x < 0;
-					flag_out |= in_x >= in_w;
-					int y = in_y;
-					flag_out |= in_y < 0;
-					flag_out |= in_y >= in_h;
-					if(flag_out == false) {
-						if(flag_8b == false) {
-							px[0] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 0] * weight;
-							px[1] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 1] * weight;
-							px[2] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 2] * weight;
-							px[3] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 3] * weight;
-//							px[3] += weight;
-						} else {
-							px[0] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 0] * 0xFF;
-							px[1] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 1] * 0xFF;
-							px[2] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 2] * 0xFF;
-							px[3] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 3] * 0xFF;
-//							px[3] += weight;
-						}
-					} // else pixel is missing and replaced by black transparent pixel [0.0, 0.0, 0.0, 0.0] and can be ignored because of multiplication results
-					// X turnaround
-					dx -= wx;
-					if(dx >= 1.0)	wx = 1.0;
-					else			wx = dx;
-					in_x++;
+						bool flag_out = false;
+						int x = in_x;
+						flag_out |= in_x < 0;
+						flag_out |= in_x >= in_w;
+						int y = in_y;
+						flag_out |= in_y < 0;
+						flag_out |= in_y >= in_h;
+						if(flag_out == false) {
+							if(flag_8b == false) {
+								px[0] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 0] * weight;
+								px[1] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 1] * weight;
+								px[2] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 2] * weight;
+								px[3] += _in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 3] * weight;
+//								px[3] += weight;
+							} else {
+								px[0] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 0] * 0xFF;
+								px[1] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 1] * 0xFF;
+								px[2] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 2] * 0xFF;
+								px[3] += weight * u_in[(x + in_x_min + (y + in_y_min) * in_width) * 4 + 3] * 0xFF;
+//								px[3] += weight;
+							}
+						} // else pixel is missing and replaced by black transparent pixel [0.0, 0.0, 0.0, 0.0] and can be ignored because of multiplication results
+						// X turnaround
+						dx -= wx;
+						if(dx >= 1.0)	wx = 1.0;
+						else			wx = dx;
+						in_x++;
+					}
+					// Y turnaround
+					dy -= wy;
+					if(dy >= 1.0)	wy = 1.0;
+					else			wy = dy;
+					in_y++;
+				}
+				if(flag_8b == false) {
+					_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 0] = px[0] / w_div;
+					_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 1] = px[1] / w_div;
+					_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 2] = px[2] / w_div;
+					_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 3] = px[3] / w_div;
+				} else {
+					u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 0] = px[0] / w_div;
+					u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 1] = px[1] / w_div;
+					u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 2] = px[2] / w_div;
+					u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 3] = px[3] / w_div;
 				}
-				// Y turnaround
-				dy -= wy;
-				if(dy >= 1.0)	wy = 1.0;
-				else			wy = dy;
-				in_y++;
-			}
-			if(flag_8b == false) {
-				_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 0] = px[0] / w_div;
-				_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 1] = px[1] / w_div;
-				_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 2] = px[2] / w_div;
-				_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 3] = px[3] / w_div;
-			} else {
-				u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 0] = px[0] / w_div;
-				u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 1] = px[1] / w_div;
-				u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 2] = px[2] / w_div;
-				u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + 3] = px[3] / w_div;
 			}
 		}
-	}
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -698,75 +791,76 @@ cerr << "	f_offset_y == " << f_offset_y << endl;
 	bool flag_8b = (area_in->type() == Area::type_t::uint8_p4);
 	const float scale_x = task->scale_x;
 	const float scale_y = task->scale_y;
-	int j = 0;
-	while((j = task->y_flow->fetch_add(1)) < j_max) {
-		int out_y = j;
-		const float f_in_y = f_offset_y + scale_y * j;
-		float floor_in_y = floor(f_in_y);
-		int in_y = floor_in_y;
-		float wy_1 = f_in_y - floor_in_y;
-		float wy_0 = 1.0 - wy_1;
-		// Y limits
-		if(in_y < 0) {
-			in_y = 0;
-			wy_0 = 1.0;
-			wy_1 = 0.0;
-		}
-		if(in_y >= in_h - 1) {
-			in_y = in_h - 2;
-			wy_0 = 0.0;
-			wy_1 = 1.0;
-		}
-		for(int i = 0; i < i_max; ++i) {
-			int out_x = i;
-			const float f_in_x = f_offset_x + scale_x * i;
-			//--
-			float floor_in_x = floor(f_in_x);
-			int in_x = floor_in_x;
-			float wx_1 = f_in_x - floor_in_x;
-			float wx_0 = 1.0 - wx_1;
-			// X limits
-			if(in_x < 0) {
-				in_x = 0;
-				wx_0 = 1.0;
-				wx_1 = 0.0;
+	subflow->for_rows(task->y_flow, j_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			int out_y = j;
+			const float f_in_y = f_offset_y + scale_y * j;
+			float floor_in_y = floor(f_in_y);
+			int in_y = floor_in_y;
+			float wy_1 = f_in_y - floor_in_y;
+			float wy_0 = 1.0 - wy_1;
+			// Y limits
+			if(in_y < 0) {
+				in_y = 0;
+				wy_0 = 1.0;
+				wy_1 = 0.0;
 			}
-			if(in_x >= in_w - 1) {
-				in_x = in_w - 2;
-				wx_0 = 0.0;
-				wx_1 = 1.0;
+			if(in_y >= in_h - 1) {
+				in_y = in_h - 2;
+				wy_0 = 0.0;
+				wy_1 = 1.0;
 			}
-			// accumulator
-			float px[4];
-			for(int k = 0; k < 4; ++k)
-				px[k] = 0.0;
-			// interpolation
-			float w[4];
-			w[0] = wx_0 * wy_0;
-			w[1] = wx_1 * wy_0;
-			w[2] = wx_0 * wy_1;
-			w[3] = wx_1 * wy_1;
-			if(flag_8b == false) {
-				for(int c = 0; c < 4; ++c) {
-					int offset_x = c % 2;
-					int offset_y = c / 2;
-					for(int k = 0; k < 4; ++k)
-						px[k] += _in[(in_x + offset_x + in_x_min + (in_y + offset_y + in_y_min) * in_width) * 4 + k] * w[c];
+			for(int i = 0; i < i_max; ++i) {
+				int out_x = i;
+				const float f_in_x = f_offset_x + scale_x * i;
+				//--
+				float floor_in_x = floor(f_in_x);
+				int in_x = floor_in_x;
+				float wx_1 = f_in_x - floor_in_x;
+				float wx_0 = 1.0 - wx_1;
+				// X limits
+				if(in_x < 0) {
+					in_x = 0;
+					wx_0 = 1.0;
+					wx_1 = 0.0;
+				}
+				if(in_x >= in_w - 1) {
+					in_x = in_w - 2;
+					wx_0 = 0.0;
+					wx_1 = 1.0;
 				}
+				// accumulator
+				float px[4];
 				for(int k = 0; k < 4; ++k)
-					_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + k] = px[k];
-			} else {
-				for(int c = 0; c < 4; ++c) {
-					int offset_x = c % 2;
-					int offset_y = c / 2;
+					px[k] = 0.0;
+				// interpolation
+				float w[4];
+				w[0] = wx_0 * wy_0;
+				w[1] = wx_1 * wy_0;
+				w[2] = wx_0 * wy_1;
+				w[3] = wx_1 * wy_1;
+				if(flag_8b == false) {
+					for(int c = 0; c < 4; ++c) {
+						int offset_x = c % 2;
+						int offset_y = c / 2;
+						for(int k = 0; k < 4; ++k)
+							px[k] += _in[(in_x + offset_x + in_x_min + (in_y + offset_y + in_y_min) * in_width) * 4 + k] * w[c];
+					}
 					for(int k = 0; k < 4; ++k)
-						px[k] += w[c] * u_in[(in_x + offset_x + in_x_min + (in_y + offset_y + in_y_min) * in_width) * 4 + k] * 0xFF;
+						_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + k] = px[k];
+				} else {
+					for(int c = 0; c < 4; ++c) {
+						int offset_x = c % 2;
+						int offset_y = c / 2;
+						for(int k = 0; k < 4; ++k)
+							px[k] += w[c] * u_in[(in_x + offset_x + in_x_min + (in_y + offset_y + in_y_min) * in_width) * 4 + k] * 0xFF;
+					}
+					for(int k = 0; k < 4; ++k)
+						u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + k] = px[k];
 				}
-				for(int k = 0; k < 4; ++k)
-					u_out[((out_y + out_y_min) * out_width + out_x + out_x_min) * 4 + k] = px[k];
 			}
 		}
-	}
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -97,6 +97,8 @@ public:
 		uint8_p4,	// U8	BGRA (QT format)
 		uint8_p3,	// U8	RGB (JPEG export)
 		float_p1,	// float V
+		half_p4,	// half float RGBA, storage only - for caches; filters compute in float
+		uint16_p1,	// U16 V, raw Bayer mosaic
 	};
 	enum class format_t {
 		rgba_32,// 'original' RGBA 'float'
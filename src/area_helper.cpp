@@ -7,12 +7,28 @@
  *
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
 
 #include "area_helper.h"
 #include "mt.h"
 #include "system.h"
 
+#if defined(Q_CC_GNU) && (defined(__x86_64__) || defined(__i386__))
+	#define AREA_HELPER_F16C
+	#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__)
+	#define AREA_HELPER_SSE2
+	#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 //------------------------------------------------------------------------------
@@ -212,36 +228,407 @@ void AreaHelper::f_convert_mt(class SubFlow *subflow) {
 	float f_scale = task->f_scale;
 
 	// TODO: for export - apply color background for 3 bytes RGB format
-	int y;
-	while((y = task->y_flow->fetch_add(1)) < y_max) {
-		for(int x = 0; x < x_max; ++x) {
-			const int l = ((y + y_off) * in_width + (x + x_off)) * 4;
-			int k = 0;
-			switch(rotation) {
-			case 0:
-				k = ((y + pos_y) * out_width + (x + pos_x)) * out_step;
-				break;
-			case 90:
-				k = ((x + pos_y) * out_width + (out_width - (y + pos_x) - 1)) * out_step;
-				break;
-			case 180:
-				k = ((out_height - (y + pos_y) - 1) * out_width + (out_width - (x + pos_x) - 1)) * out_step;
-				break;
-			case 270:
-				k = ((out_height - (x + pos_y) - 1) * out_width + (y + pos_x)) * out_step;
-				break;
-			};
-			for(int c = 0; c < out_step; ++c) {
-				auto v = int32_t(in[l + c] * f_scale);
-				if(v > i_scale)	v = i_scale;
-				else if(v < 0x00)	v = 0x00;
-				if(out_is_16)
-					out_16[k + index_table[c]] = v;
-				else
-					out_8[k + index_table[c]] = (v >> 8);
+	subflow->for_rows(task->y_flow, y_max, [&](int y_begin, int y_end) {
+		for(int y = y_begin; y < y_end; ++y) {
+			for(int x = 0; x < x_max; ++x) {
+				const int l = ((y + y_off) * in_width + (x + x_off)) * 4;
+				int k = 0;
+				switch(rotation) {
+				case 0:
+					k = ((y + pos_y) * out_width + (x + pos_x)) * out_step;
+					break;
+				case 90:
+					k = ((x + pos_y) * out_width + (out_width - (y + pos_x) - 1)) * out_step;
+					break;
+				case 180:
+					k = ((out_height - (y + pos_y) - 1) * out_width + (out_width - (x + pos_x) - 1)) * out_step;
+					break;
+				case 270:
+					k = ((out_height - (x + pos_y) - 1) * out_width + (y + pos_x)) * out_step;
+					break;
+				};
+				for(int c = 0; c < out_step; ++c) {
+					auto v = int32_t(in[l + c] * f_scale);
+					if(v > i_scale)	v = i_scale;
+					else if(v < 0x00)	v = 0x00;
+					if(out_is_16)
+						out_16[k + index_table[c]] = v;
+					else
+						out_8[k + index_table[c]] = (v >> 8);
+				}
+			}
+		}
+	});
+}
+
+//------------------------------------------------------------------------------
+// Half float conversion, with F16C if available; software versions are with rounding to nearest even.
+static inline uint16_t half_from_float_sw(float f) {
+	uint32_t x;
+	std::memcpy(&x, &f, sizeof(x));
+	const uint32_t sign = (x >> 16) & 0x8000;
+	uint32_t v = x & 0x7FFFFFFF;
+	if(v >= 0x7F800000)	// Inf or NaN
+		return sign | 0x7C00 | ((v > 0x7F800000) ? 0x0200 : 0x0000);
+	if(v >= 0x477FF000)	// overflow, >= 65520.0f
+		return sign | 0x7C00;
+	if(v < 0x38800000) {	// denormal or zero, < 2^-14; with ULP of 0.5f equal to 2^-24
+		float d;
+		std::memcpy(&d, &v, sizeof(d));
+		d += 0.5f;
+		std::memcpy(&v, &d, sizeof(v));
+		return sign | (v - 0x3F000000);
+	}
+	// rebias exponent from 127 to 15, and round
+	v += 0xC8000FFF + ((v >> 13) & 1);
+	return sign | (v >> 13);
+}
+
+static inline float half_to_float_sw(uint16_t h) {
+	const uint32_t v = h & 0x7FFF;
+	uint32_t x;
+	if(v >= 0x7C00) {	// Inf or NaN
+		x = 0x7F800000 | ((v & 0x03FF) << 13);
+	} else if(v >= 0x0400) {
+		x = (v << 13) + 0x38000000;
+	} else {	// denormal or zero
+		float d = float(v) * (1.0f / 16777216.0f);
+		std::memcpy(&x, &d, sizeof(x));
+	}
+	x |= uint32_t(h & 0x8000) << 16;
+	float f;
+	std::memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+#ifdef AREA_HELPER_F16C
+__attribute__((target("avx,f16c")))
+static void half_from_float_f16c(uint16_t *out, const float *in, int count) {
+	int i = 0;
+	for(; i + 8 <= count; i += 8)
+		_mm_storeu_si128((__m128i *)&out[i], _mm256_cvtps_ph(_mm256_loadu_ps(&in[i]), _MM_FROUND_TO_NEAREST_INT));
+	for(; i < count; ++i)
+		out[i] = half_from_float_sw(in[i]);
+}
+
+__attribute__((target("avx,f16c")))
+static void half_to_float_f16c(float *out, const uint16_t *in, int count) {
+	int i = 0;
+	for(; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(&out[i], _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)&in[i])));
+	for(; i < count; ++i)
+		out[i] = half_to_float_sw(in[i]);
+}
+#endif
+
+void AreaHelper::half_from_float(uint16_t *out, const float *in, int count) {
+#ifdef AREA_HELPER_F16C
+	if(System::instance()->cpu_f16c()) {
+		half_from_float_f16c(out, in, count);
+		return;
+	}
+#endif
+	for(int i = 0; i < count; ++i)
+		out[i] = half_from_float_sw(in[i]);
+}
+
+void AreaHelper::half_to_float(float *out, const uint16_t *in, int count) {
+#ifdef AREA_HELPER_F16C
+	if(System::instance()->cpu_f16c()) {
+		half_to_float_f16c(out, in, count);
+		return;
+	}
+#endif
+	for(int i = 0; i < count; ++i)
+		out[i] = half_to_float_sw(in[i]);
+}
+
+//------------------------------------------------------------------------------
+class AreaHelper::mt_half_task_t {
+public:
+	Area *area_in;
+	Area *area_out;
+	bool to_half;
+	// offset of 'area_out' in 'area_in', in pixels
+	int x_offset;
+	int y_offset;
+
+	std::atomic_int *y_flow;
+};
+
+std::unique_ptr<Area> AreaHelper::convert_to_half(SubFlow *subflow, Area *area_in) {
+	std::unique_ptr<Area> area_out;
+	std::unique_ptr<mt_half_task_t> task_holder;
+	std::unique_ptr<std::atomic_int> y_flow;
+
+	if(subflow->sync_point_pre()) {
+		// keep edges and position as is
+		area_out = std::unique_ptr<Area>(new Area(area_in->dimensions(), Area::type_t::half_p4));
+		y_flow = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
+		mt_half_task_t *task = new mt_half_task_t;
+		task_holder.reset(task);
+		task->area_in = area_in;
+		task->area_out = area_out.get();
+		task->to_half = true;
+		task->x_offset = 0;
+		task->y_offset = 0;
+		task->y_flow = y_flow.get();
+		for(int i = 0; i < subflow->threads_count(); ++i)
+			subflow->set_private(task, i);
+	}
+	subflow->sync_point_post();
+
+	f_half_mt(subflow);
+	subflow->sync_point();
+
+	return area_out;
+}
+
+std::unique_ptr<Area> AreaHelper::convert_to_float(SubFlow *subflow, Area *area_in, const Area::t_dimensions *rect) {
+	std::unique_ptr<Area> area_out;
+	std::unique_ptr<mt_half_task_t> task_holder;
+	std::unique_ptr<std::atomic_int> y_flow;
+
+	if(subflow->sync_point_pre()) {
+		const Area::t_dimensions *d_in = area_in->dimensions();
+		int x1 = 0;
+		int x2 = d_in->size.w;
+		int y1 = 0;
+		int y2 = d_in->size.h;
+		if(rect != nullptr) {
+			// coordinates of the first pixel in memory, including edges
+			const double px_x = d_in->position.px_size_x;
+			const double px_y = d_in->position.px_size_y;
+			const double in_x = d_in->position.x - px_x * d_in->edges.x1;
+			const double in_y = d_in->position.y - px_y * d_in->edges.y1;
+			// keep a few pixels more for interpolation
+			const double r_px_x = rect->position.px_size_x;
+			const double r_px_y = rect->position.px_size_y;
+			const double r_x1 = rect->position.x - r_px_x * (rect->edges.x1 + 2);
+			const double r_y1 = rect->position.y - r_px_y * (rect->edges.y1 + 2);
+			const double r_x2 = r_x1 + r_px_x * (rect->size.w + 3);
+			const double r_y2 = r_y1 + r_px_y * (rect->size.h + 3);
+			x1 = std::max(x1, int(std::floor((r_x1 - in_x) / px_x)) - 2);
+			y1 = std::max(y1, int(std::floor((r_y1 - in_y) / px_y)) - 2);
+			x2 = std::min(x2, int(std::ceil((r_x2 - in_x) / px_x)) + 3);
+			y2 = std::min(y2, int(std::ceil((r_y2 - in_y) / px_y)) + 3);
+			if(x2 <= x1 || y2 <= y1) {
+				x1 = 0;
+				x2 = d_in->size.w;
+				y1 = 0;
+				y2 = d_in->size.h;
 			}
 		}
+		Area::t_dimensions d_out = *d_in;
+		d_out.size.w = x2 - x1;
+		d_out.size.h = y2 - y1;
+		d_out.edges.x1 = std::max(0, d_in->edges.x1 - x1);
+		d_out.edges.y1 = std::max(0, d_in->edges.y1 - y1);
+		d_out.edges.x2 = std::max(0, d_in->edges.x2 - (d_in->size.w - x2));
+		d_out.edges.y2 = std::max(0, d_in->edges.y2 - (d_in->size.h - y2));
+		d_out.position.x = d_in->position.x + d_in->position.px_size_x * (x1 + d_out.edges.x1 - d_in->edges.x1);
+		d_out.position.y = d_in->position.y + d_in->position.px_size_y * (y1 + d_out.edges.y1 - d_in->edges.y1);
+		area_out = std::unique_ptr<Area>(new Area(&d_out, Area::type_t::float_p4));
+		y_flow = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
+		mt_half_task_t *task = new mt_half_task_t;
+		task_holder.reset(task);
+		task->area_in = area_in;
+		task->area_out = area_out.get();
+		task->to_half = false;
+		task->x_offset = x1;
+		task->y_offset = y1;
+		task->y_flow = y_flow.get();
+		for(int i = 0; i < subflow->threads_count(); ++i)
+			subflow->set_private(task, i);
+	}
+	subflow->sync_point_post();
+
+	f_half_mt(subflow);
+	subflow->sync_point();
+
+	return area_out;
+}
+
+void AreaHelper::f_half_mt(SubFlow *subflow) {
+	mt_half_task_t *task = (mt_half_task_t *)subflow->get_private();
+	const int in_width = task->area_in->mem_width();
+	const int out_width = task->area_out->mem_width();
+	const int out_height = task->area_out->mem_height();
+	const int x_offset = task->x_offset;
+	const int y_offset = task->y_offset;
+
+	if(task->to_half) {
+		const float *in = (const float *)task->area_in->ptr();
+		uint16_t *out = (uint16_t *)task->area_out->ptr();
+		subflow->for_rows(task->y_flow, out_height, [&](int y_begin, int y_end) {
+			for(int y = y_begin; y < y_end; ++y)
+				half_from_float(&out[y * out_width * 4], &in[((y + y_offset) * in_width + x_offset) * 4], out_width * 4);
+		});
+	} else {
+		const uint16_t *in = (const uint16_t *)task->area_in->ptr();
+		float *out = (float *)task->area_out->ptr();
+		subflow->for_rows(task->y_flow, out_height, [&](int y_begin, int y_end) {
+			for(int y = y_begin; y < y_end; ++y)
+				half_to_float(&out[y * out_width * 4], &in[((y + y_offset) * in_width + x_offset) * 4], out_width * 4);
+		});
 	}
 }
 
 //------------------------------------------------------------------------------
+void AreaHelper::resample_table_t::push(int first_index, const float *w, int count) {
+	index.push_back(first_index);
+	weights.insert(weights.end(), w, w + count);
+	offset.push_back(int(weights.size()));
+}
+
+static float lanczos3(float x) {
+	if(x == 0.0f)
+		return 1.0f;
+	if(x <= -3.0f || x >= 3.0f)
+		return 0.0f;
+	const float px = M_PI * x;
+	return 3.0f * std::sin(px) * std::sin(px / 3.0f) / (px * px);
+}
+
+void AreaHelper::resample_table_lanczos3(resample_table_t *table, float center, float delta, int in_min, int in_size, int out_size) {
+	// at downscale kernel is stretched to cover the whole window of output pixel
+	const float stretch = std::max(1.0f, delta);
+	const float support = 3.0f * stretch;
+	std::vector<float> w;
+	for(int i = 0; i < out_size; ++i) {
+		const float c = center + delta * i;
+		const int n1 = std::max(0, int(std::ceil(c - support)));
+		const int n2 = std::min(in_size - 1, int(std::floor(c + support)));
+		w.clear();
+		float w_sum = 0.0f;
+		for(int n = n1; n <= n2; ++n) {
+			w.push_back(lanczos3((n - c) / stretch));
+			w_sum += w.back();
+		}
+		if(std::abs(w_sum) > 1.0e-6f) {
+			for(auto &el : w)
+				el /= w_sum;
+		} else {
+			w.clear();
+		}
+		table->push(in_min + (w.empty() ? 0 : n1), w.data(), w.size());
+	}
+}
+
+class AreaHelper::mt_resample_task_t {
+public:
+	Area *area_in;
+	Area *area_out;
+	const resample_table_t *table_x;
+	const resample_table_t *table_y;
+	int rows_cache_size; // the biggest count of input rows for an output row
+
+	std::atomic_int *y_flow;
+};
+
+void AreaHelper::resample_separable(SubFlow *subflow, Area *area_in, Area *area_out, const resample_table_t *table_x, const resample_table_t *table_y) {
+	std::unique_ptr<mt_resample_task_t> task_holder;
+	std::unique_ptr<std::atomic_int> y_flow;
+
+	if(subflow->sync_point_pre()) {
+		int rows_cache_size = 1;
+		for(int j = 0; j < table_y->size(); ++j)
+			rows_cache_size = std::max(rows_cache_size, table_y->offset[j + 1] - table_y->offset[j]);
+		y_flow = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
+		mt_resample_task_t *task = new mt_resample_task_t;
+		task_holder.reset(task);
+		task->area_in = area_in;
+		task->area_out = area_out;
+		task->table_x = table_x;
+		task->table_y = table_y;
+		task->rows_cache_size = rows_cache_size;
+		task->y_flow = y_flow.get();
+		for(int i = 0; i < subflow->threads_count(); ++i)
+			subflow->set_private(task, i);
+	}
+	subflow->sync_point_post();
+
+	f_resample_mt(subflow);
+	subflow->sync_point();
+}
+
+// Rows of input are resampled horizontally into a small ring buffer, where they are reused by the next output rows
+// of the same block (and of the next blocks of the same thread); the ring is big enough for all input rows of one output row.
+void AreaHelper::f_resample_mt(SubFlow *subflow) {
+	mt_resample_task_t *task = (mt_resample_task_t *)subflow->get_private();
+	const resample_table_t *table_x = task->table_x;
+	const resample_table_t *table_y = task->table_y;
+	const int out_w = table_x->size();
+	const int out_h = table_y->size();
+	const int in_width = task->area_in->mem_width();
+	const int out_width = task->area_out->mem_width();
+	const int out_x1 = task->area_out->dimensions()->edges.x1;
+	const int out_y1 = task->area_out->dimensions()->edges.y1;
+	const int rows_cache_size = task->rows_cache_size;
+	const float *in = (const float *)task->area_in->ptr();
+	float *out = (float *)task->area_out->ptr();
+
+	// one ring per thread - of the calling one, and of each helper that takes blocks of it;
+	// input is the same for all blocks, so cached rows are valid till return
+	class ring_t {
+	public:
+		std::vector<float> rows;
+		std::vector<int> rows_y;
+	};
+	std::mutex rings_lock;
+	std::map<std::thread::id, ring_t> rings;
+	subflow->for_rows(task->y_flow, out_h, [&](int y_begin, int y_end) {
+		rings_lock.lock();
+		ring_t &ring = rings[std::this_thread::get_id()];
+		rings_lock.unlock();
+		if(ring.rows.empty()) {
+			ring.rows.resize(size_t(rows_cache_size) * out_w * 4);
+			ring.rows_y.assign(rows_cache_size, -1);
+		}
+		float *rows_cache = ring.rows.data();
+		int *rows_cache_y = ring.rows_y.data();
+		for(int j = y_begin; j < y_end; ++j) {
+			float *out_row = &out[((j + out_y1) * out_width + out_x1) * 4];
+			for(int i = 0; i < out_w * 4; ++i)
+				out_row[i] = 0.0f;
+			const float *w_y = &table_y->weights[table_y->offset[j]];
+			const int count_y = table_y->offset[j + 1] - table_y->offset[j];
+			for(int k = 0; k < count_y; ++k) {
+				// horizontal
+				const int y = table_y->index[j] + k;
+				float *row = &rows_cache[size_t(y % rows_cache_size) * out_w * 4];
+				if(rows_cache_y[y % rows_cache_size] != y) {
+					rows_cache_y[y % rows_cache_size] = y;
+					const float *in_row = &in[y * in_width * 4];
+					for(int i = 0; i < out_w; ++i) {
+						const float *px = &in_row[table_x->index[i] * 4];
+						const float *w = &table_x->weights[table_x->offset[i]];
+						const int count = table_x->offset[i + 1] - table_x->offset[i];
+#ifdef AREA_HELPER_SSE2
+						__m128 v_sum = _mm_setzero_ps();
+						for(int l = 0; l < count; ++l)
+							v_sum = _mm_add_ps(v_sum, _mm_mul_ps(_mm_loadu_ps(&px[l * 4]), _mm_set1_ps(w[l])));
+						_mm_storeu_ps(&row[i * 4], v_sum);
+#else
+						float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+						for(int l = 0; l < count; ++l)
+							for(int c = 0; c < 4; ++c)
+								sum[c] += px[l * 4 + c] * w[l];
+						for(int c = 0; c < 4; ++c)
+							row[i * 4 + c] = sum[c];
+#endif
+					}
+				}
+				// vertical
+				int i = 0;
+#ifdef AREA_HELPER_SSE2
+				const __m128 v_w = _mm_set1_ps(w_y[k]);
+				for(; i < out_w * 4; i += 4)
+					_mm_storeu_ps(&out_row[i], _mm_add_ps(_mm_loadu_ps(&out_row[i]), _mm_mul_ps(_mm_loadu_ps(&row[i]), v_w)));
+#endif
+				for(; i < out_w * 4; ++i)
+					out_row[i] += row[i] * w_y[k];
+			}
+		}
+	});
+}
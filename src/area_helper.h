@@ -9,6 +9,8 @@
  *
  */
 
+#include <vector>
+
 #include "area.h"
 
 //------------------------------------------------------------------------------
@@ -17,8 +19,37 @@ public:
 	static std::unique_ptr<Area> convert(class Area *in, Area::format_t out_format, int rotation);
 	static std::unique_ptr<Area> convert_mt(class SubFlow *subflow, class Area *in, Area::format_t out_format, int rotation, class Area *tiled_area = nullptr, int pos_x = 0, int pos_y = 0);
 
+	// 'half_p4' storage of 'float_p4' areas; filters should process 'float_p4' ones
+	static std::unique_ptr<Area> convert_to_half(class SubFlow *subflow, class Area *in);
+	// with 'rect', convert only the part of area that covers 'rect' (like 'dimensions_pre' of a tile)
+	static std::unique_ptr<Area> convert_to_float(class SubFlow *subflow, class Area *in, const Area::t_dimensions *rect = nullptr);
+	static void half_from_float(uint16_t *out, const float *in, int count);
+	static void half_to_float(float *out, const uint16_t *in, int count);
+
+	// weights of separable resampling, for output pixel 'i': input pixels from 'index[i]' (in memory of input area,
+	// i.e. with edges) with weights 'weights[offset[i]]' till 'weights[offset[i + 1]]'; pixel w/o weights is zero
+	class resample_table_t {
+	public:
+		resample_table_t(void) : offset(1, 0) {}
+		int size(void) const {return int(index.size());}
+		void push(int first_index, const float *w, int count);
+		std::vector<int> index;
+		std::vector<int> offset;
+		std::vector<float> weights;
+	};
+	// Lanczos-3 weights: output pixel 'i' is centered at 'center + delta * i' in pixels of input w/o edges, with pixel 'n' centered at 'n';
+	// taps out of input area are dropped, and the rest are normalized
+	static void resample_table_lanczos3(resample_table_t *table, float center, float delta, int in_min, int in_size, int out_size);
+	// axis-aligned resampling of 'float_p4' area: horizontal pass with 'table_x', then vertical with 'table_y',
+	// to pixels of 'area_out' w/o edges; called by all threads of subflow
+	static void resample_separable(class SubFlow *subflow, class Area *area_in, class Area *area_out, const resample_table_t *table_x, const resample_table_t *table_y);
+
 protected:
 	class mt_task_t;
+	class mt_half_task_t;
+	class mt_resample_task_t;
+	static void f_half_mt(class SubFlow *subflow);
+	static void f_resample_mt(class SubFlow *subflow);
 	static void f_convert_mt(class SubFlow *subflow);
 	static void f_crop_mt(class SubFlow *subflow);
 };
@@ -14,7 +14,9 @@
     - add signals from Process::process to update partial status of photo processing;
 */
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "batch.h"
 #include "batch_dialog.h"
@@ -22,6 +24,9 @@
 #include "config.h"
 #include "process_h.h"
 #include "edit.h"
+#include "import.h"
+#include "memory.h"
+#include "metadata.h"
 #include "system.h"
 #include "widgets.h"
 
@@ -29,6 +34,11 @@
 
 using namespace std;
 
+// photos in pipeline at once, in 'auto' mode
+#define BATCH_PHOTOS_MAX 4
+// photos waiting between stages of pipeline
+#define BATCH_PIPELINE_DEPTH 1
+
 //------------------------------------------------------------------------------
 Batch::Batch(QWidget *parent, class Process *_process, class Edit *_edit, class Browser *_browser) {
 	process = _process;
@@ -45,6 +55,9 @@ Batch::Batch(QWidget *parent, class Process *_process, class Edit *_edit, class
 	to_pause = false;
 	c_done = 0;
 	c_total = 0;
+	photos_max = 1;
+	photos_in_flight = 0;
+	photo_mem_peak = 0;
 	widget = nullptr;
 	// setup destination dir
 	bool flag = Config::instance()->get(CONFIG_SECTION_BATCH, "destination_dir", destination_dir);
@@ -58,8 +71,11 @@ Batch::~Batch() {
 	// save destination dir
 	Config::instance()->set(CONFIG_SECTION_BATCH, "destination_dir", destination_dir);
 	if(run_thread != nullptr) {
+		task_list_lock.lock();
 		to_leave = true;
 		task_wait.notify_all();
+		photos_wait.notify_all();
+		task_list_lock.unlock();
 		run_thread->join();
 		delete run_thread;
 	}
@@ -155,6 +171,7 @@ void Batch::do_abort(void) {
 	task_list.erase(task_list.begin(), task_list.end());
 	// to update status if was on the pause
 	task_wait.notify_all();
+	photos_wait.notify_all();
 	task_list_lock.unlock();
 }
 
@@ -339,35 +356,13 @@ void Batch::run(void) {
 		long _c_total = c_total;
 		// show "0 / total" at start
 		emit signal_status(c_done, _c_total, false);
-		while(true) {
-			task_list_lock.lock();
-			if(task_list.begin() == task_list.end()) {
-				task_list_lock.unlock();
-				break;
-			}
-			Batch::task_t task = *task_list.begin();
-			task_list.pop_front();
-			_c_total = c_total;
-			task_list_lock.unlock();
-//cerr << "batch process: import: " << task.photo_id.get_export_file_name() << endl;
-//cerr << "               export: " << task.fname_export << endl;
-			// synchronous call here
-			process->process_export(task.photo_id, task.fname_export, &task.ep);
-			if(to_leave) {
-				break;
-			}
-			task_list_lock.lock();
-			c_done++;
-			long _c_done = c_done;
-			_c_total = c_total;
-			task_list_lock.unlock();
-			// emit signal to update status
-			emit signal_status(_c_done, _c_total, (_c_total - _c_done) <= 1 && !to_pause);
-			if(to_pause) {
-				button_pause_as_continue();
-				break;
-			}
-		}
+		// in 'auto' mode, import and save of each photo take one core, the rest of cores are left for filters of the photo in processing
+		int c_photos = 0;
+		Config::instance()->get(CONFIG_SECTION_BATCH, "photos_in_flight", c_photos);
+		photos_max = (c_photos > 0) ? c_photos : std::min(BATCH_PHOTOS_MAX, std::max(2, System::instance()->cores() / 2));
+		run_pipeline();
+		if(to_pause && !to_leave)
+			button_pause_as_continue();
 cerr << endl << "batch process: DONE" << endl << endl;
 		if(to_leave)
 			break;
@@ -386,6 +381,152 @@ cerr << endl << "batch process: DONE" << endl << endl;
 //cerr << "leave!!!" << endl;
 }
 
+//------------------------------------------------------------------------------
+class pipeline_item_t {
+public:
+	Batch::task_t task;
+	std::unique_ptr<Export_job_t> job;
+	size_t mem_reserved = 0;
+};
+
+// Bounded queue between stages of pipeline.
+class pipeline_queue_t {
+public:
+	pipeline_queue_t(size_t _depth) : depth(_depth) {}
+	// block while queue is full
+	void push(std::unique_ptr<pipeline_item_t> item);
+	// block while queue is empty; return 'false' when queue is closed and empty
+	bool pop(std::unique_ptr<pipeline_item_t> &item);
+	void close(void);
+
+protected:
+	std::mutex lock;
+	std::condition_variable cv;
+	std::list<std::unique_ptr<pipeline_item_t>> items;
+	size_t depth;
+	bool closed = false;
+};
+
+void pipeline_queue_t::push(std::unique_ptr<pipeline_item_t> item) {
+	std::unique_lock<std::mutex> locker(lock);
+	cv.wait(locker, [this]{ return items.size() < depth; });
+	items.push_back(std::move(item));
+	cv.notify_all();
+}
+
+bool pipeline_queue_t::pop(std::unique_ptr<pipeline_item_t> &item) {
+	std::unique_lock<std::mutex> locker(lock);
+	cv.wait(locker, [this]{ return closed || !items.empty(); });
+	if(items.empty())
+		return false;
+	item = std::move(items.front());
+	items.pop_front();
+	cv.notify_all();
+	return true;
+}
+
+void pipeline_queue_t::close(void) {
+	std::unique_lock<std::mutex> locker(lock);
+	closed = true;
+	cv.notify_all();
+}
+
+// Until the first photo is done: raw data, input and output of demosaic.
+static size_t pipeline_mem_import_estimate(Photo_ID photo_id) {
+	Metadata metadata;
+	if(!Import::load_metadata(photo_id.get_file_name(), &metadata))
+		return 0;
+	return size_t(metadata.width) * metadata.height * Area::type_to_sizeof(Area::type_t::float_p4) * 3;
+}
+
+// Three stages: import, processing and save, with bounded queues in between. Import and save are single-threaded,
+// so each one is done by 'photos_max' workers, for a few photos at once; processing is done by one thread, as only
+// one Flow is running at a time and it takes all cores. So import and save of other photos are hidden behind
+// the processing of the current one. Pause or abort stop import of new photos, photos already in pipeline are finished.
+// Photos in pipeline are limited with 'photos_limit()', and memory budget for each one is reserved before import.
+void Batch::run_pipeline(void) {
+	pipeline_queue_t queue_process(BATCH_PIPELINE_DEPTH);
+	pipeline_queue_t queue_save(BATCH_PIPELINE_DEPTH);
+	std::thread thread_process([&]{
+		std::unique_ptr<pipeline_item_t> item;
+		while(queue_process.pop(item)) {
+			if(!to_leave)
+				process->export_process(item->job.get());
+			queue_save.push(std::move(item));
+		}
+		queue_save.close();
+	});
+	std::vector<std::thread> threads_save;
+	for(int i = 0; i < photos_max; ++i) {
+		threads_save.push_back(std::thread([&]{
+			std::unique_ptr<pipeline_item_t> item;
+			while(queue_save.pop(item)) {
+				const long mem_peak = item->job->process_task.mem_peak;
+				if(!to_leave)
+					process->export_save(item->job.get());
+				const size_t mem_reserved = item->mem_reserved;
+				item.reset();
+				MemBudget::instance()->release(mem_reserved);
+				task_list_lock.lock();
+				photos_in_flight--;
+				photo_mem_peak = std::max(photo_mem_peak, mem_peak);
+				c_done++;
+				long _c_done = c_done;
+				long _c_total = c_total;
+				const bool _to_leave = to_leave;
+				task_list_lock.unlock();
+				photos_wait.notify_all();
+				if(!_to_leave)
+					emit signal_status(_c_done, _c_total, (_c_total - _c_done) <= 1 && !to_pause);
+			}
+		}));
+	}
+	std::vector<std::thread> threads_import;
+	for(int i = 0; i < photos_max; ++i) {
+		threads_import.push_back(std::thread([&]{
+			while(true) {
+				std::unique_lock<std::mutex> locker(task_list_lock);
+				photos_wait.wait(locker, [this]{ return to_leave || to_pause || task_list.empty() || photos_in_flight < photos_limit(); });
+				if(to_leave || to_pause || task_list.empty())
+					break;
+				std::unique_ptr<pipeline_item_t> item(new pipeline_item_t);
+				item->task = *task_list.begin();
+				task_list.pop_front();
+				photos_in_flight++;
+				const long mem_peak = photo_mem_peak;
+				locker.unlock();
+				// wait for budget here, while photos in pipeline are going on; processing reserves only the rest if any
+				item->mem_reserved = (mem_peak > 0) ? size_t(mem_peak) : pipeline_mem_import_estimate(item->task.photo_id);
+				MemBudget::instance()->acquire(item->mem_reserved);
+				item->job = process->export_load(item->task.photo_id, item->task.fname_export, &item->task.ep);
+				item->job->process_task.mem_reserved = item->mem_reserved;
+				queue_process.push(std::move(item));
+			}
+		}));
+	}
+	for(auto &el : threads_import)
+		el.join();
+	queue_process.close();
+	thread_process.join();
+	for(auto &el : threads_save)
+		el.join();
+}
+
+// Should be called with locked 'task_list_lock'. Until the first photo is done there is nothing known about
+// memory usage, so start with one photo; then as many as fit into the memory budget, or half of physical memory,
+// but no more than 'photos_max'.
+int Batch::photos_limit(void) {
+	if(photo_mem_peak <= 0)
+		return 1;
+	size_t mem = MemBudget::instance()->limit();
+	if(mem == 0)
+		mem = System::instance()->mem_physical() / 2;
+	if(mem == 0)
+		return photos_max;
+	const long limit = long(mem / size_t(photo_mem_peak));
+	return int(std::max(1L, std::min(long(photos_max), limit)));
+}
+
 //------------------------------------------------------------------------------
 void Batch::load_default_ep(export_parameters_t *ep) {
 	Config::instance()->get(CONFIG_SECTION_BATCH, "process_asap", ep->process_asap);
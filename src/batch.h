@@ -82,6 +82,15 @@ protected:
 	void run_batch(void);
 	void run(void);
 	std::thread *run_thread = nullptr;
+	// few photos are in pipeline at once, as many as fit into the memory budget, but no more than half of cores in auto mode
+	int photos_limit(void);
+	int photos_max;
+	int photos_in_flight;
+	long photo_mem_peak;
+	std::condition_variable photos_wait;
+	// pipeline of photos: import of the next one, processing and save of the previous one at the same time
+	void run_pipeline(void);
+	friend class pipeline_item_t;
 	void load_default_ep(export_parameters_t *ep);
 	void save_default_ep(export_parameters_t *ep);
 
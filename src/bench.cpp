@@ -0,0 +1,754 @@
+/*
+ * bench.cpp
+ *
+ * This source code is a part of 'DDRoom' project.
+ * (C) 2015-2017 Mykhailo Malyshko a.k.a. Spectr.
+ * License: LGPL version 3.
+ *
+ */
+
+/*
+ Reproducible benchmark of processing pipeline, w/o GUI and w/o camera files: raw photos are synthetic
+ Bayer and X-Trans mosaics, generated with fixed seed. Timed stages:
+   import   - raw data to 'Area', as after decoding with DCRaw;
+   process  - the whole export processing, with each demosaic path, and the peak of memory used by it;
+   filter   - each filter of export processing, summed time of all threads and tiles;
+   scale    - Area::scale() with threads, and Area::scale() to fit;
+   convert  - AreaHelper::convert_mt() to 8 and 16 bits RGB;
+   half     - 'float_p4' to 'half_p4' cache and back, with size of areas;
+   cm       - CM_Convert::convert() and convert_n() of color models, with check of difference between them;
+   gp       - supersampling kernel of geometry filters, scalar and SSE2, with check of difference between them;
+   encoder  - each export format.
+ Results are printed as CSV or JSON. Exit code is '1' if some check of difference fails.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#include "area.h"
+#include "area_helper.h"
+#include "cm.h"
+#include "dcraw.h"
+#include "ddr_math.h"
+#include "export.h"
+#include "filter.h"
+#include "filter_gp.h"
+#include "import_raw.h"
+#include "memory.h"
+#include "metadata.h"
+#include "mt.h"
+#include "photo.h"
+#include "process_h.h"
+#include "system.h"
+
+#include <exiv2/xmp.hpp>
+#include <exiv2/error.hpp>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+class bench_record_t {
+public:
+	string sensor;
+	double megapixels;
+	int threads;
+	string stage;
+	string name;
+	double ms;
+	double memory_mb;
+};
+
+class bench_options_t {
+public:
+	vector<int> sizes = {12, 24};
+	vector<int> threads;
+	int repeat = 3;
+	bool json = false;
+	string output;
+	string folder;
+	bool sensor_bayer = true;
+	bool sensor_xtrans = true;
+};
+
+class bench_input_t {
+public:
+	string sensor;
+	bool xtrans;
+	int width;
+	int height;
+	double megapixels;
+	std::unique_ptr<DCRaw> dcraw;
+	std::vector<uint16_t> dcraw_raw;
+};
+
+// variant of filters settings, as "F_Name key=value ..." lines
+class bench_settings_t {
+public:
+	string name;
+	bool xtrans;
+	vector<string> filters;
+};
+
+static std::vector<bench_record_t> bench_records;
+static bool bench_failed = false;
+
+//------------------------------------------------------------------------------
+static void Exiv2_emptyHandler(int level, const char* s) {
+}
+
+static void bench_init_libraries(void) {
+	Filter_Store::instance();
+	Exiv2::XmpParser::initialize();
+	Exiv2::LogMsg::setHandler(Exiv2_emptyHandler);
+	CM::initialize();
+	compression_function(1.0, 1.0);
+}
+
+static double bench_ms(std::chrono::steady_clock::time_point time_start) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - time_start).count() / 1000.0;
+}
+
+// the best time of 'repeat' calls
+static double bench_best(int repeat, std::function<void(void)> f) {
+	double best = 0.0;
+	for(int i = 0; i < repeat; ++i) {
+		auto time_start = std::chrono::steady_clock::now();
+		f();
+		const double ms = bench_ms(time_start);
+		if(i == 0 || ms < best)
+			best = ms;
+	}
+	return best;
+}
+
+static void bench_record(const bench_input_t *input, int threads, string stage, string name, double ms, double memory_mb = 0.0) {
+	bench_records.push_back(bench_record_t{input->sensor, input->megapixels, threads, stage, name, ms, memory_mb});
+	cerr << "bench: " << input->sensor << " " << input->megapixels << " Mpx, " << threads << " threads: " << stage << " \"" << name << "\" " << ms << " ms";
+	if(memory_mb != 0.0)
+		cerr << ", " << memory_mb << " Mb";
+	cerr << endl;
+}
+
+static double bench_mb(size_t bytes) {
+	return std::round(double(bytes) / (1024.0 * 1024.0) * 10.0) / 10.0;
+}
+
+//------------------------------------------------------------------------------
+static void bench_import(const bench_input_t *input, int threads, int repeat) {
+	const double ms = bench_best(repeat, [&]{
+		Import_Raw import_raw("");
+		Metadata metadata;
+		std::unique_ptr<Area> area = import_raw.image(input->dcraw.get(), input->dcraw_raw.data(), &metadata);
+	});
+	bench_record(input, threads, "import", input->xtrans ? "load_xtrans" : "dcraw_to_area", ms);
+}
+
+//------------------------------------------------------------------------------
+static string bench_write_settings(const bench_options_t *options, const bench_settings_t *settings) {
+	string file_name = options->folder + "/" + settings->name + ".ddr";
+	std::ofstream ofs(file_name, std::ios_base::out | std::ios_base::trunc);
+	ofs << "<ddr>" << endl;
+	ofs << "<version index=\"1\">" << endl;
+	ofs << "<global_fields><cw_rotation angle=\"0\"/></global_fields>" << endl;
+	ofs << "<filters>" << endl;
+	for(auto line : settings->filters) {
+		QStringList fields = QString::fromStdString(line).split(" ", QString::SkipEmptyParts);
+		ofs << "<" << fields[0].toStdString();
+		for(int i = 1; i < fields.size(); ++i) {
+			QStringList kv = fields[i].split("=");
+			ofs << " " << kv[0].toStdString() << "=\"" << kv[1].toStdString() << "\"";
+		}
+		ofs << "/>" << endl;
+	}
+	ofs << "</filters>" << endl;
+	ofs << "</version>" << endl;
+	ofs << "</ddr>" << endl;
+	return file_name;
+}
+
+class bench_export_t {
+public:
+	double ms_process = 0.0;
+	double ms_save = 0.0;
+	long mem_peak = 0;
+	std::map<string, double> ms_filters;
+};
+
+// whole export of imported synthetic photo; filters time is collected from trace spans
+static bool bench_export_once(Process *process, std::shared_ptr<Photo_t> photo, Photo_ID photo_id, string fname_export, string fname_ps, export_parameters_t *ep, bench_export_t &result) {
+	// drop cached results of 'whole' filters from the previous run
+	photo->ps_state = "";
+	std::map<string, long> us_filters;
+	Trace::sink_set([&](const char *category, const string &name, long duration) {
+		if(string(category) == "filter")
+			us_filters[name] += duration;
+	});
+	auto time_start = std::chrono::steady_clock::now();
+	std::unique_ptr<Export_job_t> job = process->export_load(photo_id, fname_export, ep, fname_ps, photo);
+	process->export_process(job.get());
+	result.ms_process = bench_ms(time_start);
+	result.mem_peak = job->process_task.mem_peak;
+	time_start = std::chrono::steady_clock::now();
+	const bool ok = process->export_save(job.get());
+	result.ms_save = bench_ms(time_start);
+	Trace::sink_set(nullptr);
+	result.ms_filters.clear();
+	for(auto el : us_filters)
+		result.ms_filters[el.first] = el.second / 1000.0;
+	QFile::remove(QString::fromStdString(fname_export));
+	return ok;
+}
+
+static bench_export_t bench_export(Process *process, std::shared_ptr<Photo_t> photo, const bench_options_t *options, string fname_ps, export_parameters_t *ep) {
+	bench_export_t best;
+	const string fname_export = photo->photo_id.get_export_file_name() + export_parameters_t::image_type_to_ext(ep->image_type);
+	for(int i = 0; i < options->repeat; ++i) {
+		bench_export_t result;
+		if(!bench_export_once(process, photo, photo->photo_id, fname_export, fname_ps, ep, result)) {
+			cerr << "bench: export of \"" << fname_export << "\" failed" << endl;
+			continue;
+		}
+		if(i == 0 || result.ms_process < best.ms_process)
+			best.ms_process = result.ms_process;
+		if(i == 0 || result.ms_save < best.ms_save)
+			best.ms_save = result.ms_save;
+		best.mem_peak = std::max(best.mem_peak, result.mem_peak);
+		for(auto el : result.ms_filters) {
+			auto it = best.ms_filters.find(el.first);
+			if(it == best.ms_filters.end() || el.second < (*it).second)
+				best.ms_filters[el.first] = el.second;
+		}
+	}
+	return best;
+}
+
+static void bench_process(Process *process, const bench_input_t *input, const bench_options_t *options, int threads, bool with_encoders) {
+	// photo with imported synthetic raw data, as it was kept warm between exports
+	std::shared_ptr<Photo_t> photo(new Photo_t());
+	photo->photo_id = Photo_ID(options->folder + "/synthetic_" + input->sensor + ".raw", 1);
+	photo->metadata = new Metadata;
+	Import_Raw import_raw("");
+	photo->area_raw = import_raw.image(input->dcraw.get(), input->dcraw_raw.data(), photo->metadata);
+
+	// demosaic paths; with 'filters' variant - the most of filters are enabled
+	const vector<bench_settings_t> variants = {
+		{"demosaic DG", false, {}},
+		{"demosaic DG with CA", false, {"F_Demosaic enabled_CA=true enabled_RC=true enabled_BY=true scale_RC=1.0005 scale_BY=0.9995"}},
+		{"demosaic X-Trans 1 pass", true, {"F_Demosaic XTrans_passes=1"}},
+		{"demosaic X-Trans 3 passes", true, {"F_Demosaic XTrans_passes=3"}},
+		{"filters", input->xtrans, {
+			"F_Shift enabled=true angle_v=2.0 angle_h=1.0",
+			"F_Projection enabled=true strength=0.5",
+			"F_Rotation enabled=true rotation_angle=1.5",
+			"F_CM_Lightness enabled=true enabled_gamma=true gamma=1.2",
+			"F_CM_Rainbow enabled=true",
+			"F_CM_Sepia enabled=true",
+			"F_CM_Colors saturation_enabled=true saturation=1.2",
+			"F_Unsharp enabled=true amount=1.0 radius=1.0 local_contrast_enabled=true",
+			"F_Soften enabled=true strength=0.5 radius=1.0"}},
+	};
+	export_parameters_t ep;
+	ep.image_type = export_parameters_t::image_type_jpeg;
+	ep.process_single = false;
+	ep.process_asap = false;
+	for(auto variant : variants) {
+		if(variant.xtrans != input->xtrans)
+			continue;
+		const string fname_ps = bench_write_settings(options, &variant);
+		bench_export_t result = bench_export(process, photo, options, fname_ps, &ep);
+		bench_record(input, threads, "process", variant.name, result.ms_process, bench_mb(result.mem_peak));
+		if(result.ms_process > 0.0)
+			cerr << "bench: " << variant.name << " " << input->megapixels * 1000.0 / result.ms_process << " Mpx/sec" << endl;
+		for(auto el : result.ms_filters)
+			bench_record(input, threads, "filter", variant.name + ": " + el.first, el.second);
+		QFile::remove(QString::fromStdString(fname_ps));
+	}
+	if(!with_encoders)
+		return;
+
+	// encoders, with the default settings of filters
+	const bench_settings_t settings_default{"encoders", input->xtrans, {}};
+	const string fname_ps = bench_write_settings(options, &settings_default);
+	const vector<std::pair<string, int>> encoders = {{"jpeg", 8}, {"png", 8}, {"png", 16}, {"tiff", 8}, {"tiff", 16}};
+	for(auto encoder : encoders) {
+		export_parameters_t ep_encoder = ep;
+		ep_encoder.image_type = export_parameters_t::image_name_to_type(encoder.first);
+		ep_encoder.options_png.bits = encoder.second;
+		ep_encoder.options_tiff.bits = encoder.second;
+		bench_export_t result = bench_export(process, photo, options, fname_ps, &ep_encoder);
+		bench_record(input, threads, "encoder", encoder.first + " " + std::to_string(encoder.second) + " bits", result.ms_save);
+	}
+	QFile::remove(QString::fromStdString(fname_ps));
+}
+
+//------------------------------------------------------------------------------
+class bench_flow_t {
+public:
+	Area *area_in;
+	std::unique_ptr<Area> area_out;
+	float scale;
+	Area::format_t format;
+	const AreaHelper::resample_table_t *table_x;
+	const AreaHelper::resample_table_t *table_y;
+};
+
+static void bench_flow_scale(void *obj, SubFlow *subflow, void *data) {
+	bench_flow_t *task = (bench_flow_t *)data;
+	const int out_w = std::ceil(task->area_in->dimensions()->width() / task->scale);
+	const int out_h = std::ceil(task->area_in->dimensions()->height() / task->scale);
+	std::unique_ptr<Area> area_out = task->area_in->scale(subflow, out_w, out_h, task->scale, task->scale);
+	if(subflow->is_main())
+		task->area_out = std::move(area_out);
+}
+
+static void bench_flow_convert(void *obj, SubFlow *subflow, void *data) {
+	bench_flow_t *task = (bench_flow_t *)data;
+	std::unique_ptr<Area> area_out = AreaHelper::convert_mt(subflow, task->area_in, task->format, 0);
+	if(subflow->is_main())
+		task->area_out = std::move(area_out);
+}
+
+static void bench_flow_half(void *obj, SubFlow *subflow, void *data) {
+	bench_flow_t *task = (bench_flow_t *)data;
+	std::unique_ptr<Area> area_out;
+	if(task->area_in->type() == Area::type_t::half_p4)
+		area_out = AreaHelper::convert_to_float(subflow, task->area_in);
+	else
+		area_out = AreaHelper::convert_to_half(subflow, task->area_in);
+	if(subflow->is_main())
+		task->area_out = std::move(area_out);
+}
+
+static void bench_flow_resample(void *obj, SubFlow *subflow, void *data) {
+	bench_flow_t *task = (bench_flow_t *)data;
+	AreaHelper::resample_separable(subflow, task->area_in, task->area_out.get(), task->table_x, task->table_y);
+}
+
+static size_t bench_area_size(Area *area) {
+	return size_t(area->mem_width()) * area->mem_height() * area->type_to_sizeof();
+}
+
+static void bench_area(const bench_input_t *input, int threads, int repeat) {
+	// demosaiced-like photo: 'float_p4' area with gradients
+	std::unique_ptr<Area> area(new Area(input->width, input->height, Area::type_t::float_p4));
+	float *ptr = (float *)area->ptr();
+	const int mem_w = area->mem_width();
+	const int mem_h = area->mem_height();
+	for(int y = 0; y < mem_h; ++y) {
+		for(int x = 0; x < mem_w; ++x) {
+			float *px = &ptr[(y * mem_w + x) * 4];
+			px[0] = float(x) / mem_w;
+			px[1] = 0.5f * (float(x) / mem_w + float(y) / mem_h);
+			px[2] = float(y) / mem_h;
+			px[3] = 1.0f;
+		}
+	}
+	bench_flow_t task;
+	task.area_in = area.get();
+	for(float scale : {2.0f, 4.0f}) {
+		task.scale = scale;
+		const double ms = bench_best(repeat, [&]{
+			Flow flow(Flow::priority_offline, &bench_flow_scale, nullptr, (void *)&task, threads);
+			flow.flow();
+			task.area_out.reset();
+		});
+		bench_record(input, threads, "scale", "Area::scale() 1/" + std::to_string(int(scale)), ms);
+	}
+	if(threads == 1) {
+		const double ms = bench_best(repeat, [&]{
+			std::unique_ptr<Area> area_out = area->scale(input->width / 4, input->height / 4, true);
+		});
+		bench_record(input, threads, "scale", "Area::scale() to fit 1/4", ms);
+	}
+	for(auto format : {Area::format_t::rgb_8, Area::format_t::rgb_16}) {
+		task.format = format;
+		const double ms = bench_best(repeat, [&]{
+			Flow flow(Flow::priority_offline, &bench_flow_convert, nullptr, (void *)&task, threads);
+			flow.flow();
+			task.area_out.reset();
+		});
+		bench_record(input, threads, "convert", (format == Area::format_t::rgb_8) ? "AreaHelper::convert_mt() rgb_8" : "AreaHelper::convert_mt() rgb_16", ms);
+	}
+	// cache of 'whole' filters result: size and time to store it and to restore for processing
+	task.area_in = area.get();
+	double ms = bench_best(repeat, [&]{
+		Flow flow(Flow::priority_offline, &bench_flow_half, nullptr, (void *)&task, threads);
+		flow.flow();
+	});
+	bench_record(input, threads, "half", "AreaHelper::convert_to_half()", ms, bench_mb(bench_area_size(task.area_out.get())));
+	std::unique_ptr<Area> area_half = std::move(task.area_out);
+	task.area_in = area_half.get();
+	ms = bench_best(repeat, [&]{
+		Flow flow(Flow::priority_offline, &bench_flow_half, nullptr, (void *)&task, threads);
+		flow.flow();
+	});
+	bench_record(input, threads, "half", "AreaHelper::convert_to_float()", ms, bench_mb(bench_area_size(task.area_out.get())));
+	task.area_out.reset();
+}
+
+//------------------------------------------------------------------------------
+// max relative difference of SSE2 batch conversions with scalar ones; saturation of grays, to skip their hue
+#define BENCH_CM_DIFF	1.0e-5f
+#define BENCH_CM_GRAY	1.0e-3f
+
+static void bench_cm(const bench_input_t *input, int threads, int repeat) {
+	// up to 1 Mpx, the speed doesn't depend on size
+	const int count = std::min(input->width * input->height, 1024 * 1024);
+	std::vector<float> XYZ(count * 4);
+	for(int i = 0; i < count; ++i) {
+		XYZ[i * 4 + 0] = float(i % 4096) / 4095.0f;
+		XYZ[i * 4 + 1] = float((i / 64) % 4096) / 4095.0f;
+		XYZ[i * 4 + 2] = float((i / 4096) % 4096) / 4095.0f;
+		XYZ[i * 4 + 3] = 1.0f;
+	}
+	std::vector<float> Jsh(count * 4);
+	std::vector<float> out_1(count * 4);
+	std::vector<float> out_n(count * 4);
+	for(auto cm_type : CM::get_types_list()) {
+		const string cm_name = CM::get_type_name(cm_type);
+		std::unique_ptr<CM> cm_in(CM::new_CM(cm_type, CS_White("D65"), CS_White("E")));
+		std::unique_ptr<CM> cm_out(CM::new_CM(cm_type, CS_White("E"), CS_White("D65")));
+		const std::vector<std::pair<CM_Convert *, const float *>> converts = {
+			{cm_in->get_convert_XYZ_to_Jsh(), &XYZ[0]},
+			{cm_out->get_convert_Jsh_to_XYZ(), &Jsh[0]}};
+		for(size_t c = 0; c < converts.size(); ++c) {
+			CM_Convert *cm_convert = converts[c].first;
+			const float *in = converts[c].second;
+			const string name = cm_name + ((c == 0) ? " XYZ to Jsh" : " Jsh to XYZ");
+			double ms = bench_best(repeat, [&]{
+				for(int i = 0; i < count; ++i)
+					cm_convert->convert(&out_1[i * 4], &in[i * 4]);
+			});
+			bench_record(input, threads, "cm", name + " convert()", ms);
+			ms = bench_best(repeat, [&]{
+				cm_convert->convert_n(&out_n[0], in, count);
+			});
+			bench_record(input, threads, "cm", name + " convert_n()", ms);
+			// hue is periodic, and undefined for grays
+			float diff = 0.0f;
+			for(int i = 0; i < count; ++i) {
+				for(int k = 0; k < 3; ++k) {
+					if(c == 0 && k == 2 && out_1[i * 4 + 1] < BENCH_CM_GRAY)
+						continue;
+					float d = std::abs(out_1[i * 4 + k] - out_n[i * 4 + k]) / std::max(1.0f, std::abs(out_1[i * 4 + k]));
+					if(c == 0 && k == 2)
+						d = std::min(d, 1.0f - d);
+					if(d > diff)
+						diff = d;
+				}
+			}
+			cerr << "bench: " << name << " convert_n() max difference: " << diff << endl;
+			if(!(diff <= BENCH_CM_DIFF)) {
+				cerr << "bench: FAILED: " << name << " convert_n() max difference " << diff << " is above " << BENCH_CM_DIFF << endl;
+				bench_failed = true;
+			}
+			if(c == 0)
+				std::copy(out_1.begin(), out_1.end(), Jsh.begin());
+		}
+	}
+}
+
+// max difference of Lanczos-3 resampling of constant area with input, and of resampling with scale 1:1
+#define BENCH_LANCZOS_DIFF	1.0e-5f
+
+static void bench_lanczos(const bench_input_t *input, int threads, int repeat) {
+	const int width = 1024;
+	const int height = 768;
+	std::unique_ptr<Area> area_ramp(new Area(width, height, Area::type_t::float_p4));
+	std::unique_ptr<Area> area_flat(new Area(width, height, Area::type_t::float_p4));
+	float *ptr_ramp = (float *)area_ramp->ptr();
+	float *ptr_flat = (float *)area_flat->ptr();
+	for(int i = 0; i < width * height; ++i) {
+		const int x = i % width;
+		const int y = i / width;
+		ptr_ramp[i * 4 + 0] = float(x) / width;
+		ptr_ramp[i * 4 + 1] = float((x * 7 + y * 13) % 17) / 16.0f;
+		ptr_ramp[i * 4 + 2] = float(y) / height;
+		ptr_ramp[i * 4 + 3] = 1.0f;
+		for(int c = 0; c < 4; ++c)
+			ptr_flat[i * 4 + c] = 0.5f;
+	}
+	bench_flow_t task;
+	float diff = 0.0f;
+	for(float scale : {1.0f, 0.5f, 2.0f, 4.0f}) {
+		const int out_w = int(width / scale);
+		const int out_h = int(height / scale);
+		AreaHelper::resample_table_t table_x;
+		AreaHelper::resample_table_t table_y;
+		AreaHelper::resample_table_lanczos3(&table_x, (scale - 1.0f) * 0.5f, scale, 0, width, out_w);
+		AreaHelper::resample_table_lanczos3(&table_y, (scale - 1.0f) * 0.5f, scale, 0, height, out_h);
+		task.table_x = &table_x;
+		task.table_y = &table_y;
+		// 1:1 should keep any input, other scales - constant one
+		Area *area_in = (scale == 1.0f) ? area_ramp.get() : area_flat.get();
+		task.area_in = area_in;
+		const double ms = bench_best(repeat, [&]{
+			task.area_out.reset(new Area(out_w, out_h, Area::type_t::float_p4));
+			Flow flow(Flow::priority_offline, &bench_flow_resample, nullptr, (void *)&task, threads);
+			flow.flow();
+		});
+		const float *in = (const float *)area_in->ptr();
+		const float *out = (const float *)task.area_out->ptr();
+		for(int i = 0; i < out_w * out_h * 4; ++i)
+			diff = std::max(diff, std::abs(out[i] - ((scale == 1.0f) ? in[i] : 0.5f)));
+		task.area_out.reset();
+		if(scale != 1.0f)
+			bench_record(input, threads, "scale", "resample_separable() Lanczos-3 " + ((scale < 1.0f) ? std::string("2/1") : "1/" + std::to_string(int(scale))), ms);
+	}
+	cerr << "bench: Lanczos-3 resampling max difference: " << diff << endl;
+	if(!(diff <= BENCH_LANCZOS_DIFF)) {
+		cerr << "bench: FAILED: Lanczos-3 resampling max difference " << diff << " is above " << BENCH_LANCZOS_DIFF << endl;
+		bench_failed = true;
+	}
+}
+
+// max relative difference of SSE2 supersampling kernel with scalar one
+#define BENCH_GP_SAMPLING_DIFF	1.0e-5f
+
+// windows of supersampling as at 'FilterProcess_GP_Wrapper::process_sampling()'
+class bench_gp_window_t {
+public:
+	int ix1, ix2, iy1, iy2;
+	float wy, ly;
+	int weights_offset;
+	int channel;
+};
+
+static void bench_gp_sampling(const bench_input_t *input, int threads, int repeat) {
+	// input area with edges, windows are partially out of it from each side, scales from upsampling to downsampling
+	const int edge = 2;
+	const int width = 512;
+	const int height = 512;
+	const int mem_width = width + edge * 2;
+	const int mem_height = height + edge * 2;
+	unsigned state = 1;
+	auto random = [&](void) {
+		state = state * 1664525u + 1013904223u;
+		return float(state >> 8) / float(1 << 24);
+	};
+	std::vector<float> in(mem_width * mem_height * 4);
+	for(int i = 0; i < mem_width * mem_height; ++i) {
+		for(int c = 0; c < 3; ++c)
+			in[i * 4 + c] = random();
+		in[i * 4 + 3] = 1.0f;
+	}
+	const int count = 256 * 1024;
+	std::vector<bench_gp_window_t> windows(count);
+	std::vector<float> weights;
+	for(int j = 0; j < count; ++j) {
+		bench_gp_window_t &w = windows[j];
+		const float scale = std::pow(2.0f, random() * 5.0f - 2.0f);
+		const float xst = random() * (mem_width - 2.0f);
+		const float yst = random() * (mem_height - 2.0f);
+		const float lx = std::max(scale, 1.0f);
+		w.ly = std::max(scale, 1.0f);
+		w.ix1 = int(std::floor(xst));
+		w.ix2 = int(std::floor(xst + lx));
+		w.wy = 1.0f - (yst - std::floor(yst));
+		w.iy1 = int(yst);
+		w.iy2 = int(yst + w.ly);
+		w.weights_offset = weights.size();
+		float w_x = 1.0f - (xst - std::floor(xst));
+		float l_x = lx;
+		for(int i = w.ix1; i <= w.ix2; ++i) {
+			weights.push_back(w_x);
+			l_x -= w_x;
+			w_x = (l_x > 1.0f) ? 1.0f : l_x;
+		}
+		// per channel sums are used with coordinates of each channel
+		w.channel = (j % 4) - 1;
+	}
+	std::vector<float> out_scalar(count * 6);
+	std::vector<float> out_sse2(count * 6);
+	for(bool sse2 : {false, true}) {
+		std::vector<float> &out = sse2 ? out_sse2 : out_scalar;
+		const double ms = bench_best(repeat, [&]{
+			for(int j = 0; j < count; ++j) {
+				const bench_gp_window_t &w = windows[j];
+				float *rez = &out[j * 6];
+				FilterProcess_GP_Wrapper::sampling_sum(rez, rez[4], rez[5], &in[0], mem_width, edge, edge + width, edge, edge + height,
+					w.ix1, w.ix2, w.iy1, w.iy2, &weights[w.weights_offset], w.wy, w.ly, w.channel, sse2);
+			}
+		});
+		bench_record(input, threads, "gp", sse2 ? "sampling_sum() SSE2" : "sampling_sum() scalar", ms);
+	}
+#ifdef FILTER_GP_SSE2
+	float diff = 0.0f;
+	for(int j = 0; j < count; ++j) {
+		for(int k = 0; k < 6; ++k) {
+			if(k < 3 && windows[j].channel >= 0 && windows[j].channel != k)
+				continue;
+			if(k == 3)
+				continue;
+			const float a = out_scalar[j * 6 + k];
+			const float b = out_sse2[j * 6 + k];
+			const float d = std::abs(a - b) / std::max(1.0f, std::abs(a));
+			if(d > diff)
+				diff = d;
+		}
+	}
+	cerr << "bench: sampling_sum() SSE2 max difference: " << diff << endl;
+	if(!(diff <= BENCH_GP_SAMPLING_DIFF)) {
+		cerr << "bench: FAILED: sampling_sum() SSE2 max difference " << diff << " is above " << BENCH_GP_SAMPLING_DIFF << endl;
+		bench_failed = true;
+	}
+#endif
+}
+
+//------------------------------------------------------------------------------
+static void bench_write(std::ostream &os, bool json) {
+	if(json) {
+		os << "[" << endl;
+		for(size_t i = 0; i < bench_records.size(); ++i) {
+			const bench_record_t &r = bench_records[i];
+			os << "{\"sensor\":\"" << r.sensor << "\",\"megapixels\":" << r.megapixels << ",\"threads\":" << r.threads;
+			os << ",\"stage\":\"" << r.stage << "\",\"name\":\"" << r.name << "\",\"ms\":" << r.ms << ",\"memory_mb\":" << r.memory_mb << "}";
+			os << ((i + 1 < bench_records.size()) ? "," : "") << endl;
+		}
+		os << "]" << endl;
+	} else {
+		os << "sensor,megapixels,threads,stage,name,ms,memory_mb" << endl;
+		for(auto r : bench_records)
+			os << r.sensor << "," << r.megapixels << "," << r.threads << "," << r.stage << ",\"" << r.name << "\"," << r.ms << "," << r.memory_mb << endl;
+	}
+}
+
+static void bench_help(void) {
+	cerr << "usage: ddroom_bench [options]" << endl;
+	cerr << "  --sizes <N,...>         sizes of synthetic photos in megapixels, '12,24' by default" << endl;
+	cerr << "  --threads <N,...>       threads counts, '1' and all cores by default" << endl;
+	cerr << "  --sensor <bayer|xtrans> only one type of sensor" << endl;
+	cerr << "  --repeat <N>            repeat each measure and keep the best time, '3' by default" << endl;
+	cerr << "  --format <csv|json>     results format, 'csv' by default" << endl;
+	cerr << "  -o, --output <file>     results file, by default standard output" << endl;
+	cerr << "  --work <folder>         folder for temporary files, by default the system temporary folder" << endl;
+}
+
+static bool bench_list(string value, vector<int> &list) {
+	list.clear();
+	for(auto el : QString::fromStdString(value).split(",", QString::SkipEmptyParts)) {
+		bool ok = false;
+		const int v = el.toInt(&ok);
+		if(!ok || v <= 0)
+			return false;
+		list.push_back(v);
+	}
+	return !list.empty();
+}
+
+static bool bench_parse_arguments(int argc, char *argv[], bench_options_t &options) {
+	for(int i = 1; i < argc; ++i) {
+		const string arg = argv[i];
+		if(arg == "--help" || arg == "-h") {
+			bench_help();
+			return false;
+		}
+		if(i + 1 >= argc) {
+			cerr << "missed value of option \"" << arg << "\"" << endl;
+			return false;
+		}
+		const string value = argv[++i];
+		bool ok = true;
+		if(arg == "--sizes") {
+			ok = bench_list(value, options.sizes);
+		} else if(arg == "--threads") {
+			ok = bench_list(value, options.threads);
+		} else if(arg == "--sensor") {
+			options.sensor_bayer = (value == "bayer");
+			options.sensor_xtrans = (value == "xtrans");
+			ok = options.sensor_bayer || options.sensor_xtrans;
+		} else if(arg == "--repeat") {
+			options.repeat = QString::fromStdString(value).toInt(&ok);
+			ok = ok && options.repeat > 0;
+		} else if(arg == "--format") {
+			options.json = (value == "json");
+			ok = (value == "json" || value == "csv");
+		} else if(arg == "-o" || arg == "--output") {
+			options.output = value;
+		} else if(arg == "--work") {
+			options.folder = value;
+			ok = QDir(QString::fromStdString(value)).exists();
+		} else {
+			cerr << "unknown option \"" << arg << "\"" << endl;
+			bench_help();
+			return false;
+		}
+		if(!ok) {
+			cerr << "wrong value \"" << value << "\" of option \"" << arg << "\"" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+	QCoreApplication application(argc, argv);
+	qRegisterMetaType<std::string>("std::string");
+	bench_options_t options;
+	if(!bench_parse_arguments(argc, argv, options))
+		return 2;
+	bench_init_libraries();
+	if(options.threads.empty()) {
+		options.threads.push_back(1);
+		if(System::instance()->cores() > 1)
+			options.threads.push_back(System::instance()->cores());
+	}
+	if(options.folder == "")
+		options.folder = QDir::tempPath().toStdString();
+	const int threads_max = *std::max_element(options.threads.begin(), options.threads.end());
+
+	Process *process = new Process();
+	for(int megapixels : options.sizes) {
+		for(bool xtrans : {false, true}) {
+			if((xtrans && !options.sensor_xtrans) || (!xtrans && !options.sensor_bayer))
+				continue;
+			// 3:2 aspect ratio, size aligned to X-Trans pattern
+			bench_input_t input;
+			input.xtrans = xtrans;
+			input.sensor = xtrans ? "xtrans" : "bayer";
+			input.width = int(std::sqrt(megapixels * 1000000.0 * 1.5) / 6) * 6;
+			input.height = int(input.width / 1.5 / 6) * 6;
+			input.megapixels = std::round(double(input.width) * input.height / 100000.0) / 10.0;
+			input.dcraw.reset(Import_Raw::synthetic_raw(input.width, input.height, xtrans, input.dcraw_raw));
+			for(int threads : options.threads) {
+				System::instance()->set_cores(threads);
+				bench_import(&input, threads, options.repeat);
+				bench_process(process, &input, &options, threads, threads == threads_max);
+				bench_area(&input, threads, options.repeat);
+				if(threads == 1) {
+					bench_cm(&input, threads, options.repeat);
+					bench_gp_sampling(&input, threads, options.repeat);
+					bench_lanczos(&input, threads, options.repeat);
+				}
+			}
+		}
+	}
+	System::instance()->set_cores(0);
+	delete process;
+
+	if(options.output != "") {
+		std::ofstream ofs(options.output, std::ios_base::out | std::ios_base::trunc);
+		bench_write(ofs, options.json);
+	} else {
+		bench_write(cout, options.json);
+	}
+	return bench_failed ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
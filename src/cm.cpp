@@ -78,7 +78,78 @@ using namespace std;
 #endif
 
 
+#if defined(__SSE2__) && !defined(USE_HUE_QUADRANT)
+	#define CM_SSE2
+	#include <emmintrin.h>
+#endif
+
 #define CIELAB_TABLES_SIZE	32768
+//------------------------------------------------------------------------------
+void CM_Convert::convert_n(float *to, const float *from, int count) {
+	for(int i = 0; i < count; ++i)
+		convert(&to[i * 4], &from[i * 4]);
+}
+
+#ifdef CM_SSE2
+static inline __m128 cm_abs_4(__m128 v) {
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+static inline __m128 cm_select_4(__m128 mask, __m128 v_true, __m128 v_false) {
+	return _mm_or_ps(_mm_and_ps(mask, v_true), _mm_andnot_ps(mask, v_false));
+}
+
+static inline __m128 cm_tf_4(TableFunction *tf, __m128 v) {
+	float f[4];
+	_mm_storeu_ps(f, v);
+	tf->eval_n(f, f, 4);
+	return _mm_loadu_ps(f);
+}
+
+// sin and cos with reduction to [-pi/4, pi/4] and minimax polynomials; abs error < 1e-6 for |x| < 100
+static inline void cm_sincos_4(__m128 x, __m128 &s, __m128 &c) {
+	const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(float(2.0 / M_PI))));
+	const __m128 qf = _mm_cvtepi32_ps(q);
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5707963705062866f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(-4.37113900018624283e-8f)));
+	const __m128 r2 = _mm_mul_ps(r, r);
+	__m128 ps = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(-1.9515295891e-4f)), _mm_set1_ps(8.3321608736e-3f));
+	ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(-1.6666654611e-1f));
+	ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+	__m128 pc = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(2.443315711809948e-5f)), _mm_set1_ps(-1.388731625493765e-3f));
+	pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(4.166664568298827e-2f));
+	pc = _mm_mul_ps(_mm_mul_ps(pc, r2), r2);
+	pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+	// quadrants: swap sin and cos for odd, and fix signs
+	const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	const __m128 sign_s = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+	const __m128 sign_c = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+	s = _mm_xor_ps(cm_select_4(swap, pc, ps), sign_s);
+	c = _mm_xor_ps(cm_select_4(swap, ps, pc), sign_c);
+}
+
+// atan2 with polynomial at [0, 1]; abs error < 1e-6
+static inline __m128 cm_atan2_4(__m128 y, __m128 x) {
+	const __m128 ax = cm_abs_4(x);
+	const __m128 ay = cm_abs_4(y);
+	const __m128 mx = _mm_max_ps(ax, ay);
+	const __m128 mn = _mm_min_ps(ax, ay);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 a = _mm_and_ps(_mm_div_ps(mn, mx), _mm_cmpgt_ps(mx, zero));
+	const __m128 a2 = _mm_mul_ps(a, a);
+	__m128 r = _mm_set1_ps(-0.01172120f);
+	r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(0.05265332f));
+	r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(-0.11643287f));
+	r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(0.19354346f));
+	r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(-0.33262347f));
+	r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(0.99997726f));
+	r = _mm_mul_ps(r, a);
+	r = cm_select_4(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(float(M_PI * 0.5)), r), r);
+	r = cm_select_4(_mm_cmplt_ps(x, zero), _mm_sub_ps(_mm_set1_ps(float(M_PI)), r), r);
+	return _mm_or_ps(r, _mm_and_ps(y, _mm_set1_ps(-0.0f)));
+}
+#endif
+
 //------------------------------------------------------------------------------
 float h_to_H_quadrant(float h) {
 	h *= 360.0f;
@@ -219,6 +290,7 @@ protected:
 class CIELab_XYZ_to_Jsh : public CM_Convert {
 public:
 	void convert(float *Jsh, const float *XYZ);
+	void convert_n(float *Jsh, const float *XYZ, int count);
 	float CAT[9];
 	class TF_CIELab *tf_lab;
 };
@@ -256,9 +328,39 @@ void CIELab_XYZ_to_Jsh::convert(float *Jsh, const float *XYZ) {
 #endif
 }
 
+void CIELab_XYZ_to_Jsh::convert_n(float *Jsh, const float *XYZ, int count) {
+	int i = 0;
+#ifdef CM_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for(; i + 4 <= count; i += 4) {
+		__m128 c0, c1, c2, c3;
+		cm_load_4(&XYZ[i * 4], c0, c1, c2, c3);
+		__m128 XYZa[3];
+		cm_m3_v3_mult_4(XYZa, CAT, c0, c1, c2);
+		const __m128 fX = cm_tf_4(tf_lab, XYZa[0]);
+		const __m128 fY = cm_tf_4(tf_lab, XYZa[1]);
+		const __m128 fZ = cm_tf_4(tf_lab, XYZa[2]);
+		const __m128 J = _mm_sub_ps(_mm_mul_ps(fY, _mm_set1_ps(1.16f)), _mm_set1_ps(0.16f));
+		const __m128 a = _mm_mul_ps(_mm_sub_ps(fX, fY), _mm_set1_ps(5.0f));
+		const __m128 b = _mm_mul_ps(_mm_sub_ps(fY, fZ), _mm_set1_ps(2.0f));
+		const __m128 C = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)));
+		__m128 h = _mm_mul_ps(cm_atan2_4(b, a), _mm_set1_ps(float(0.5 / M_PI)));
+		h = _mm_add_ps(h, _mm_and_ps(_mm_cmplt_ps(h, zero), one));
+		const __m128 J_mask = _mm_cmpgt_ps(J, _mm_set1_ps(0.00001f));
+		__m128 s = _mm_div_ps(C, _mm_mul_ps(_mm_set1_ps(0.1f), _mm_sqrt_ps(_mm_and_ps(J, J_mask))));
+		s = _mm_and_ps(_mm_sqrt_ps(_mm_and_ps(s, J_mask)), J_mask);
+		cm_store_3(&Jsh[i * 4], J, s, h);
+	}
+#endif
+	for(; i < count; ++i)
+		convert(&Jsh[i * 4], &XYZ[i * 4]);
+}
+
 class CIELab_Jsh_to_XYZ : public CIELab_Convert {
 public:
 	void convert(float *XYZ, const float *Jsh);
+	void convert_n(float *XYZ, const float *Jsh, int count);
 	float CAT[9];
 };
 
@@ -305,6 +407,28 @@ void CIELab_Jsh_to_XYZ::convert(float *XYZ, const float *Jsh) {
 	m3_v3_mult(XYZ, CAT, XYZa);
 }
 
+void CIELab_Jsh_to_XYZ::convert_n(float *XYZ, const float *Jsh, int count) {
+	int i = 0;
+#ifdef CM_SSE2
+	for(; i + 4 <= count; i += 4) {
+		__m128 L, s, h, c3;
+		cm_load_4(&Jsh[i * 4], L, s, h, c3);
+		h = _mm_mul_ps(h, _mm_set1_ps(float(2.0 * M_PI)));
+		const __m128 C = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(s, s), _mm_set1_ps(0.1f)), _mm_sqrt_ps(L));
+		__m128 sin_h, cos_h;
+		cm_sincos_4(h, sin_h, cos_h);
+		const __m128 Y = _mm_div_ps(_mm_add_ps(L, _mm_set1_ps(0.16f)), _mm_set1_ps(1.16f));
+		const __m128 X = _mm_add_ps(Y, _mm_div_ps(_mm_mul_ps(C, cos_h), _mm_set1_ps(5.0f)));
+		const __m128 Z = _mm_sub_ps(Y, _mm_div_ps(_mm_mul_ps(C, sin_h), _mm_set1_ps(2.0f)));
+		__m128 v[3];
+		cm_m3_v3_mult_4(v, CAT, _mm_mul_ps(_mm_mul_ps(X, X), X), _mm_mul_ps(_mm_mul_ps(Y, Y), Y), _mm_mul_ps(_mm_mul_ps(Z, Z), Z));
+		cm_store_3(&XYZ[i * 4], v[0], v[1], v[2]);
+	}
+#endif
+	for(; i < count; ++i)
+		convert(&XYZ[i * 4], &Jsh[i * 4]);
+}
+
 //--------------------------------------------------------------------------
 class TF_CIELab *CIELab::tf_CIELab = nullptr;
 
@@ -479,6 +603,7 @@ float CIECAM02_Convert::get_s_from_JCh(const float *JCh) {
 class CIECAM02_XYZ_to_Jsh : public CIECAM02_Convert {
 public:
 	void convert(float *XYZ, const float *Jsh);
+	void convert_n(float *Jsh, const float *XYZ, int count);
 	float cat02_matrix[9];
 	float _e_mult_const;
 	float _Nbb;
@@ -533,10 +658,50 @@ float CIECAM02_XYZ_to_Jsh::tf_tc(float tx) {
 		return powf(tx, 0.9);
 }
 
+void CIECAM02_XYZ_to_Jsh::convert_n(float *Jsh, const float *XYZ, int count) {
+	int i = 0;
+#ifdef CM_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	for(; i + 4 <= count; i += 4) {
+		__m128 c0, c1, c2, c3;
+		cm_load_4(&XYZ[i * 4], c0, c1, c2, c3);
+		__m128 HPE[3];
+		cm_m3_v3_mult_4(HPE, cat02_matrix, c0, c1, c2);
+		const __m128 Ra = cm_tf_4(tf_nonlinear_post_adaptation, HPE[0]);
+		const __m128 Ga = cm_tf_4(tf_nonlinear_post_adaptation, HPE[1]);
+		const __m128 Ba = cm_tf_4(tf_nonlinear_post_adaptation, HPE[2]);
+		const __m128 a = _mm_add_ps(_mm_sub_ps(Ra, _mm_mul_ps(Ga, _mm_set1_ps(12.0f / 11.0f))), _mm_div_ps(Ba, _mm_set1_ps(11.0f)));
+		const __m128 b = _mm_mul_ps(_mm_set1_ps(1.0f / 9.0f), _mm_sub_ps(_mm_add_ps(Ra, Ga), _mm_mul_ps(Ba, _mm_set1_ps(2.0f))));
+		__m128 h = cm_atan2_4(b, a);
+		__m128 sin_h, cos_h;
+		cm_sincos_4(_mm_add_ps(h, _mm_set1_ps(2.0f)), sin_h, cos_h);
+		const __m128 e = _mm_mul_ps(_mm_set1_ps(_e_mult_const), _mm_add_ps(cos_h, _mm_set1_ps(3.8f)));
+		__m128 t_div = _mm_add_ps(_mm_add_ps(Ra, Ga), _mm_mul_ps(Ba, _mm_set1_ps(21.0f / 20.0f)));
+		t_div = _mm_max_ps(t_div, _mm_set1_ps(0.000001f));
+		const __m128 t = _mm_div_ps(_mm_mul_ps(e, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)))), t_div);
+		__m128 A = _mm_add_ps(_mm_mul_ps(Ra, _mm_set1_ps(PERC_SCALE_R)), _mm_mul_ps(Ga, _mm_set1_ps(PERC_SCALE_G)));
+		A = _mm_add_ps(A, _mm_mul_ps(Ba, _mm_set1_ps(PERC_SCALE_B)));
+		A = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(A, _mm_set1_ps(0.305f)), _mm_set1_ps(_Nbb)), zero);
+		const __m128 J = cm_tf_4(tf_tJ, _mm_div_ps(A, _mm_set1_ps(cat02_Aw)));
+		float tc[4];
+		_mm_storeu_ps(tc, t);
+		for(int k = 0; k < 4; ++k)
+			tc[k] = tf_tc(tc[k]);
+		const __m128 s = _mm_sqrt_ps(_mm_div_ps(_mm_mul_ps(_mm_loadu_ps(tc), _mm_set1_ps(_C_pow_const)), _mm_set1_ps(cat02_s_const)));
+		h = _mm_add_ps(h, _mm_and_ps(_mm_cmplt_ps(h, zero), _mm_set1_ps(float(M_PI * 2.0))));
+		h = _mm_div_ps(h, _mm_set1_ps(float(M_PI * 2.0)));
+		cm_store_3(&Jsh[i * 4], J, s, h);
+	}
+#endif
+	for(; i < count; ++i)
+		convert(&Jsh[i * 4], &XYZ[i * 4]);
+}
+
 //------------------------------------------------------------------------------
 class CIECAM02_Jsh_to_XYZ : public CIECAM02_Convert {
 public:
 	void convert(float *XYZ, const float *Jsh);
+	void convert_n(float *XYZ, const float *Jsh, int count);
 	float _e_mult_const;
 //	float cat02_s_const;
 	float _t_pow_const;
@@ -627,6 +792,73 @@ float CIECAM02_Jsh_to_XYZ::tf_t(float tx) {
 		return powf(tx, 10.0f / 9.0f);
 	}
 }
+
+// The same as convert(), with the linear system solved for its third column only:
+// forward matrix rows 0 and 1 are '1 - X, -12/11 - X, 1/11 - X' and '1 - Y, 1 - Y, -2 - 21/20 * Y'.
+void CIECAM02_Jsh_to_XYZ::convert_n(float *XYZ, const float *Jsh, int count) {
+	int i = 0;
+#ifdef CM_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 pi = _mm_set1_ps(float(M_PI));
+	for(; i + 4 <= count; i += 4) {
+		__m128 J, s, h, c3;
+		cm_load_4(&Jsh[i * 4], J, s, h, c3);
+		h = _mm_mul_ps(h, _mm_set1_ps(float(2.0 * M_PI)));
+		J = _mm_max_ps(J, _mm_set1_ps(0.0001f));
+		__m128 sin_h, cos_h;
+		cm_sincos_4(_mm_add_ps(h, _mm_set1_ps(2.0f)), sin_h, cos_h);
+		const __m128 e = _mm_mul_ps(_mm_set1_ps(_e_mult_const), _mm_add_ps(cos_h, _mm_set1_ps(3.8f)));
+		const __m128 A = _mm_mul_ps(cm_tf_4(tf_tf, J), _mm_set1_ps(cat02_Aw));
+		float tx[4];
+		_mm_storeu_ps(tx, _mm_div_ps(_mm_mul_ps(_mm_mul_ps(s, s), _mm_set1_ps(cat02_s_const)), _mm_set1_ps(_t_pow_const)));
+		for(int k = 0; k < 4; ++k)
+			tx[k] = tf_t(tx[k]);
+		const __m128 t = _mm_loadu_ps(tx);
+		const __m128 v_in = _mm_add_ps(_mm_div_ps(A, _mm_set1_ps(_Nbb)), _mm_set1_ps(0.305f));
+		// signs and hue reduction to [0, pi]
+		const __m128 sign_a = cm_select_4(_mm_and_ps(_mm_cmpgt_ps(h, _mm_set1_ps(float(M_PI * 0.5))), _mm_cmplt_ps(h, _mm_set1_ps(float(M_PI * 1.5)))), _mm_set1_ps(-1.0f), one);
+		const __m128 h_mask = _mm_cmpgt_ps(h, pi);
+		const __m128 sign_b = cm_select_4(h_mask, _mm_set1_ps(-1.0f), one);
+		h = _mm_sub_ps(h, _mm_and_ps(h_mask, pi));
+		const __m128 b1 = _mm_or_ps(_mm_cmplt_ps(h, _mm_set1_ps(float(M_PI * 0.25))), _mm_cmpgt_ps(h, _mm_set1_ps(float(M_PI * 0.75))));
+		h = cm_select_4(b1, h, _mm_sub_ps(_mm_set1_ps(float(M_PI * 0.5)), h));
+		__m128 sin_hh, cos_hh;
+		cm_sincos_4(h, sin_hh, cos_hh);
+		const __m128 tn = cm_abs_4(_mm_div_ps(sin_hh, cos_hh));
+		// q == |(e / t) * sqrt(1 + tn^2)|
+		const __m128 q = cm_abs_4(_mm_mul_ps(_mm_div_ps(e, t), _mm_sqrt_ps(_mm_add_ps(one, _mm_mul_ps(tn, tn)))));
+		const __m128 X = _mm_div_ps(_mm_mul_ps(sign_a, cm_select_4(b1, one, tn)), q);
+		const __m128 Y = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(sign_b, _mm_set1_ps(9.0f)), cm_select_4(b1, tn, one)), q);
+		const __m128 m0 = _mm_sub_ps(one, X);
+		const __m128 m1 = _mm_sub_ps(_mm_set1_ps(-12.0f / 11.0f), X);
+		const __m128 m2 = _mm_sub_ps(_mm_set1_ps(1.0f / 11.0f), X);
+		const __m128 m3 = _mm_sub_ps(one, Y);
+		const __m128 m4 = m3;
+		const __m128 m5 = _mm_sub_ps(_mm_set1_ps(-2.0f), _mm_mul_ps(_mm_set1_ps(21.0f / 20.0f), Y));
+		const __m128 m6 = _mm_set1_ps(PERC_SCALE_R);
+		const __m128 m7 = _mm_set1_ps(PERC_SCALE_G);
+		const __m128 m8 = _mm_set1_ps(PERC_SCALE_B);
+		// third column of inverted matrix, multiplied by v_in
+		const __m128 r0 = _mm_sub_ps(_mm_mul_ps(m1, m5), _mm_mul_ps(m2, m4));
+		const __m128 r1 = _mm_sub_ps(_mm_mul_ps(m2, m3), _mm_mul_ps(m0, m5));
+		const __m128 r2 = _mm_sub_ps(_mm_mul_ps(m0, m4), _mm_mul_ps(m1, m3));
+		__m128 det = _mm_mul_ps(m0, _mm_sub_ps(_mm_mul_ps(m4, m8), _mm_mul_ps(m5, m7)));
+		det = _mm_sub_ps(det, _mm_mul_ps(m1, _mm_sub_ps(_mm_mul_ps(m8, m3), _mm_mul_ps(m5, m6))));
+		det = _mm_add_ps(det, _mm_mul_ps(m2, _mm_sub_ps(_mm_mul_ps(m3, m7), _mm_mul_ps(m4, m6))));
+		det = cm_select_4(_mm_cmpeq_ps(det, _mm_setzero_ps()), one, det);
+		const __m128 k = _mm_div_ps(v_in, det);
+		// reverse post adaptation compression to HPE, and to XYZ
+		const __m128 v0 = cm_tf_4(tf_inverse_nonlinear_post_adaptation, _mm_mul_ps(r0, k));
+		const __m128 v1 = cm_tf_4(tf_inverse_nonlinear_post_adaptation, _mm_mul_ps(r1, k));
+		const __m128 v2 = cm_tf_4(tf_inverse_nonlinear_post_adaptation, _mm_mul_ps(r2, k));
+		__m128 v[3];
+		cm_m3_v3_mult_4(v, cat02_matrix, v0, v1, v2);
+		cm_store_3(&XYZ[i * 4], v[0], v[1], v[2]);
+	}
+#endif
+	for(; i < count; ++i)
+		convert(&XYZ[i * 4], &Jsh[i * 4]);
+}
 //------------------------------------------------------------------------------
 class CM_Convert *CIECAM02_priv::get_convert_XYZ_to_Jsh(CAT02_t *cat02) {
 	CIECAM02_XYZ_to_Jsh *c = new CIECAM02_XYZ_to_Jsh();
@@ -15,6 +15,10 @@
 #include "cms_matrix.h"
 //#include "sgt.h"
 
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
 //------------------------------------------------------------------------------
 namespace cm {
 // TODO: remove that
@@ -27,6 +31,9 @@ class CM_Convert {
 public:
 	virtual ~CM_Convert(void) {};
 	virtual void convert(float *to, const float *from) = 0;
+	// convert 'count' pixels float[4] at once, 4th component of 'to' is untouched;
+	// vectorized versions are the same as convert() up to ~1e-5
+	virtual void convert_n(float *to, const float *from, int count);
 	virtual float get_C_from_Jsh(const float *Jsh) {return Jsh[1];}
 	virtual float get_s_from_JCh(const float *JCh) {return JCh[1];}
 };
@@ -127,5 +134,41 @@ protected:
 	CM_Convert *cm_convert;
 };
 
+//------------------------------------------------------------------------------
+#if defined(__SSE2__)
+// Helpers to process four pixels float[4] at once as vectors of components;
+// shared by SSE2 code of color conversions and color filters.
+inline void cm_load_4(const float *pixels, __m128 &c0, __m128 &c1, __m128 &c2, __m128 &c3) {
+	c0 = _mm_loadu_ps(&pixels[0]);
+	c1 = _mm_loadu_ps(&pixels[4]);
+	c2 = _mm_loadu_ps(&pixels[8]);
+	c3 = _mm_loadu_ps(&pixels[12]);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+}
+
+inline void cm_store_4(float *pixels, __m128 c0, __m128 c1, __m128 c2, __m128 c3) {
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	_mm_storeu_ps(&pixels[0], c0);
+	_mm_storeu_ps(&pixels[4], c1);
+	_mm_storeu_ps(&pixels[8], c2);
+	_mm_storeu_ps(&pixels[12], c3);
+}
+
+// keep 4th components of 'pixels'
+inline void cm_store_3(float *pixels, __m128 c0, __m128 c1, __m128 c2) {
+	cm_store_4(pixels, c0, c1, c2, _mm_setr_ps(pixels[3], pixels[7], pixels[11], pixels[15]));
+}
+
+// rez = m * (v0, v1, v2) for four pixels, 'm' is 3x3 matrix
+inline void cm_m3_v3_mult_4(__m128 *rez, const float *m, __m128 v0, __m128 v1, __m128 v2) {
+	for(int i = 0; i < 3; ++i) {
+		rez[i] = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(v0, _mm_set1_ps(m[i * 3 + 0])),
+			_mm_mul_ps(v1, _mm_set1_ps(m[i * 3 + 1]))),
+			_mm_mul_ps(v2, _mm_set1_ps(m[i * 3 + 2])));
+	}
+}
+#endif
+
 //------------------------------------------------------------------------------
 #endif // __H_CM__
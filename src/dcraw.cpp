@@ -485,8 +485,8 @@ int CLASS canon_s2is()
 
 unsigned CLASS getbithuff (int nbits, ushort *huff)
 {
-  static unsigned bitbuf=0;
-  static int vbits=0, reset=0;
+  unsigned &bitbuf = getbithuff_bitbuf;
+  int &vbits = getbithuff_vbits, &reset = getbithuff_reset;
   unsigned c;
 
   if (nbits > 25) return 0;
@@ -941,15 +941,18 @@ void CLASS ljpeg_idct (struct jhead *jh)
 {
   int c, i, j, len, skip, coef;
   float work[3][8][8];
-  static float cs[106] = { 0 };
+  // shared read-only table, thread-safe initialization
+  static const struct cs_table_t {
+    float v[106];
+    cs_table_t() { int c; FORC(106) v[c] = cos((c & 31)*M_PI/16)/2; }
+  } cs_table;
+  const float *cs = cs_table.v;
   static const uchar zigzag[80] =
   {  0, 1, 8,16, 9, 2, 3,10,17,24,32,25,18,11, 4, 5,12,19,26,33,
     40,48,41,34,27,20,13, 6, 7,14,21,28,35,42,49,56,57,50,43,36,
     29,22,15,23,30,37,44,51,58,59,52,45,38,31,39,46,53,60,61,54,
     47,55,62,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63 };
 
-  if (!cs[0])
-    FORC(106) cs[c] = cos((c & 31)*M_PI/16)/2;
   memset (work, 0, sizeof work);
   work[0][0][0] = jh->vpred[0] += ljpeg_diff (jh->huff[0]) * jh->quant[0];
   for (i=1; i < 64; i++ ) {
@@ -1590,8 +1593,8 @@ void CLASS phase_one_load_raw()
 
 unsigned CLASS ph1_bithuff (int nbits, ushort *huff)
 {
-  static UINT64 bitbuf=0;
-  static int vbits=0;
+  UINT64 &bitbuf = ph1_bithuff_bitbuf;
+  int &vbits = ph1_bithuff_vbits;
   unsigned c;
 
   if (nbits == -1)
@@ -1891,8 +1894,8 @@ void CLASS canon_rmf_load_raw()
 
 unsigned CLASS pana_bits (int nbits)
 {
-  static uchar buf[0x4000];
-  static int vbits;
+  uchar *buf = pana_bits_buf;
+  int &vbits = pana_bits_vbits;
   int byte;
 
   if (!nbits) return vbits=0;
@@ -2537,7 +2540,8 @@ void CLASS kodak_thumb_load_raw()
 
 void CLASS sony_decrypt (unsigned *data, int len, int start, int key)
 {
-  static unsigned pad[128], p;
+  unsigned *pad = sony_decrypt_pad;
+  unsigned &p = sony_decrypt_p;
 
   if (start) {
     for (p=0; p < 4; p++)
@@ -2923,7 +2927,7 @@ void CLASS redcine_load_raw()
 
 void CLASS foveon_decoder (unsigned size, unsigned code)
 {
-  static unsigned huff[1024];
+  unsigned *huff = foveon_decoder_huff;
   struct decode *cur;
   int i, len;
 
@@ -4515,14 +4519,21 @@ void CLASS ppg_interpolate()
 void CLASS cielab (ushort rgb[3], short lab[3])
 {
   int c, i, j, k;
-  float r, xyz[3];
-  static float cbrt[0x10000], xyz_cam[3][4];
+  float xyz[3];
+  // shared read-only table, thread-safe initialization
+  static const struct cbrt_table_t {
+    float v[0x10000];
+    cbrt_table_t() {
+      for (int i=0; i < 0x10000; i++) {
+        float r = i / 65535.0;
+        v[i] = r > 0.008856 ? pow(r,1/3.0) : 7.787*r + 16/116.0;
+      }
+    }
+  } cbrt_table;
+  const float *cbrt = cbrt_table.v;
+  float (*xyz_cam)[4] = cielab_xyz_cam;
 
   if (!rgb) {
-    for (i=0; i < 0x10000; i++) {
-      r = i / 65535.0;
-      cbrt[i] = r > 0.008856 ? pow(r,1/3.0) : 7.787*r + 16/116.0;
-    }
     for (i=0; i < 3; i++)
       for (j=0; j < colors; j++)
 	for (xyz_cam[i][j] = k=0; k < 3; k++)
@@ -183,7 +183,17 @@ struct jhead {
 
 bool _sensor_fuji_45;
 
-	~DCRaw();
+// state of decoders, kept in the instance instead of static local variables of 'dcraw.c' to decode few files at once
+unsigned getbithuff_bitbuf;
+int getbithuff_vbits, getbithuff_reset;
+UINT64 ph1_bithuff_bitbuf;
+int ph1_bithuff_vbits;
+uchar pana_bits_buf[0x4000];
+int pana_bits_vbits;
+unsigned sony_decrypt_pad[128], sony_decrypt_p;
+unsigned foveon_decoder_huff[1024];
+float cielab_xyz_cam[3][4];
+
 	float camera_primaries[12];
 	DCRaw(void) {
 		shot_select=0; multi_out=0;
@@ -227,6 +237,14 @@ bool _sensor_fuji_45;
 		iheight = 0;
 		//
 		_sensor_fuji_45 = false;
+		//
+		getbithuff_bitbuf = 0;
+		getbithuff_vbits = 0;
+		getbithuff_reset = 0;
+		ph1_bithuff_bitbuf = 0;
+		ph1_bithuff_vbits = 0;
+		pana_bits_vbits = 0;
+		sony_decrypt_p = 0;
 	};
 
 #define CLASS
@@ -445,6 +463,7 @@ int CLASS _main (int argc, const char **argv);
 	int file_cache_pos;
 	int file_cache_length;
 public:
+	~DCRaw();
 	static std::string get_version(void);
 
 };
@@ -0,0 +1,212 @@
+/*
+ * dcraw_test.cpp
+ *
+ * This source code is a part of 'DDRoom' project.
+ * (C) 2015-2017 Mykhailo Malyshko a.k.a. Spectr.
+ * License: LGPL version 3.
+ *
+ */
+
+/*
+ Stress test of concurrent raw imports: the same input is imported on N threads at once, and each
+ result should be bit-identical to the result of serial import. Inputs:
+   synthetic - Bayer and X-Trans mosaics from Import_Raw::synthetic_raw(), imported with own DCRaw per thread;
+   quicktake - file of Apple QuickTake 100 format with pseudo-random bitstream, decoded by DCRaw from file
+               with 'getbits()' - i.e. with the state of bit decoder, that was kept in statics before.
+ Exit code: 0 - all results are identical, 1 - some results differ or failed, 2 - wrong arguments.
+*/
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+#include "area.h"
+#include "dcraw.h"
+#include "import_raw.h"
+#include "metadata.h"
+#include "system.h"
+
+#include <exiv2/xmp.hpp>
+#include <exiv2/error.hpp>
+
+using namespace std;
+
+#define TEST_SYNTHETIC_WIDTH	1536
+#define TEST_SYNTHETIC_HEIGHT	1032
+#define TEST_QUICKTAKE_WIDTH	640
+#define TEST_QUICKTAKE_HEIGHT	480
+#define TEST_QUICKTAKE_OFFSET	736
+
+//------------------------------------------------------------------------------
+class test_options_t {
+public:
+	int threads = 0;
+	int repeat = 4;
+	string folder;
+};
+
+static void Exiv2_emptyHandler(int level, const char* s) {
+}
+
+// copy of area memory, to compare results
+static std::vector<char> test_area_data(const Area *area) {
+	if(area == nullptr)
+		return std::vector<char>();
+	Area *a = const_cast<Area *>(area);
+	const size_t size = size_t(a->mem_width()) * a->mem_height() * a->type_to_sizeof();
+	const char *ptr = (const char *)a->ptr();
+	return std::vector<char>(ptr, ptr + size);
+}
+
+// run 'import' serially once, then on all threads at once 'repeat' times; return count of different results
+static int test_concurrent(string name, const test_options_t *options, std::function<std::vector<char>(void)> import) {
+	const std::vector<char> reference = import();
+	if(reference.empty()) {
+		cerr << "test: " << name << ": serial import failed" << endl;
+		return 1;
+	}
+	std::atomic_int c_failed(0);
+	for(int r = 0; r < options->repeat; ++r) {
+		std::atomic_int c_ready(0);
+		std::vector<std::thread> threads;
+		for(int i = 0; i < options->threads; ++i) {
+			threads.push_back(std::thread([&]{
+				// start all imports at once
+				c_ready.fetch_add(1);
+				while(c_ready.load() < options->threads)
+					std::this_thread::yield();
+				if(import() != reference)
+					c_failed.fetch_add(1);
+			}));
+		}
+		for(auto &el : threads)
+			el.join();
+	}
+	const int imports = options->threads * options->repeat;
+	cerr << "test: " << name << ": " << imports - c_failed.load() << " of " << imports << " concurrent imports are identical to serial one" << endl;
+	return c_failed.load();
+}
+
+//------------------------------------------------------------------------------
+static int test_synthetic(const test_options_t *options, bool xtrans) {
+	return test_concurrent(xtrans ? "synthetic X-Trans" : "synthetic Bayer", options, [xtrans]{
+		std::vector<uint16_t> dcraw_raw;
+		std::unique_ptr<DCRaw> dcraw(Import_Raw::synthetic_raw(TEST_SYNTHETIC_WIDTH, TEST_SYNTHETIC_HEIGHT, xtrans, dcraw_raw));
+		Import_Raw import_raw("");
+		Metadata metadata;
+		std::unique_ptr<Area> area = import_raw.image(dcraw.get(), dcraw_raw.data(), &metadata);
+		return test_area_data(area.get());
+	});
+}
+
+// Header of QuickTake 100: signature, and big-endian height and width at offset 544; compressed data
+// at offset 736. Any bitstream is valid for that decoder, so use a fixed pseudo-random one.
+static bool test_write_quicktake(string file_name) {
+	std::vector<uint8_t> data(TEST_QUICKTAKE_OFFSET + TEST_QUICKTAKE_WIDTH * TEST_QUICKTAKE_HEIGHT, 0);
+	unsigned state = 1;
+	for(size_t i = TEST_QUICKTAKE_OFFSET; i < data.size(); ++i) {
+		state = state * 1664525u + 1013904223u;
+		data[i] = uint8_t(state >> 24);
+	}
+	std::memcpy(&data[0], "qktk", 4);
+	data[544] = TEST_QUICKTAKE_HEIGHT >> 8;
+	data[545] = TEST_QUICKTAKE_HEIGHT & 0xFF;
+	data[546] = TEST_QUICKTAKE_WIDTH >> 8;
+	data[547] = TEST_QUICKTAKE_WIDTH & 0xFF;
+	std::ofstream ofs(file_name, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+	ofs.write((const char *)&data[0], data.size());
+	return ofs.good();
+}
+
+static int test_quicktake(const test_options_t *options) {
+	const string file_name = options->folder + "/ddroom_dcraw_test.qtk";
+	if(!test_write_quicktake(file_name)) {
+		cerr << "test: can't write \"" << file_name << "\"" << endl;
+		return 1;
+	}
+	const int c_failed = test_concurrent("QuickTake 100 file", options, [file_name]{
+		Import_Raw import_raw(file_name);
+		Metadata metadata;
+		std::unique_ptr<Area> area = import_raw.image(&metadata);
+		return test_area_data(area.get());
+	});
+	QFile::remove(QString::fromStdString(file_name));
+	return c_failed;
+}
+
+//------------------------------------------------------------------------------
+static void test_help(void) {
+	cerr << "usage: ddroom_dcraw_test [options]" << endl;
+	cerr << "  --threads <N>           concurrent imports, all cores but at least 4 by default" << endl;
+	cerr << "  --repeat <N>            repeat concurrent imports, '4' by default" << endl;
+	cerr << "  --work <folder>         folder for temporary files, by default the system temporary folder" << endl;
+}
+
+static bool test_parse_arguments(int argc, char *argv[], test_options_t &options) {
+	for(int i = 1; i < argc; ++i) {
+		const string arg = argv[i];
+		if(arg == "--help" || arg == "-h") {
+			test_help();
+			return false;
+		}
+		if(i + 1 >= argc) {
+			cerr << "missed value of option \"" << arg << "\"" << endl;
+			return false;
+		}
+		const string value = argv[++i];
+		bool ok = true;
+		if(arg == "--threads") {
+			options.threads = QString::fromStdString(value).toInt(&ok);
+			ok = ok && options.threads > 0;
+		} else if(arg == "--repeat") {
+			options.repeat = QString::fromStdString(value).toInt(&ok);
+			ok = ok && options.repeat > 0;
+		} else if(arg == "--work") {
+			options.folder = value;
+			ok = QDir(QString::fromStdString(value)).exists();
+		} else {
+			cerr << "unknown option \"" << arg << "\"" << endl;
+			test_help();
+			return false;
+		}
+		if(!ok) {
+			cerr << "wrong value \"" << value << "\" of option \"" << arg << "\"" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+	QCoreApplication application(argc, argv);
+	test_options_t options;
+	if(!test_parse_arguments(argc, argv, options))
+		return 2;
+	Exiv2::XmpParser::initialize();
+	Exiv2::LogMsg::setHandler(Exiv2_emptyHandler);
+	if(options.threads == 0)
+		options.threads = std::max(4, System::instance()->cores());
+	if(options.folder == "")
+		options.folder = QDir::tempPath().toStdString();
+
+	int c_failed = 0;
+	c_failed += test_synthetic(&options, false);
+	c_failed += test_synthetic(&options, true);
+	c_failed += test_quicktake(&options);
+	cerr << "test: " << (c_failed == 0 ? "OK" : "FAILED") << endl;
+	return (c_failed == 0) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -14,6 +14,11 @@
 #include <math.h>
 #include <stdint.h>
 
+#if defined(__SSE2__)
+	#define DDR_MATH_SSE2
+	#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 #define _USE_ISNAN
@@ -73,6 +78,47 @@ float TableFunction::operator()(float x) {
 	float v2 = table[index + 1];
 	return (v1 + (v2 - v1) * part);
 }
+
+void TableFunction::eval_n(float *out, const float *in, int count) {
+	int i = 0;
+#ifdef DDR_MATH_SSE2
+	const __m128 v_x_min = _mm_set1_ps(x_min);
+	const __m128 v_x_max = _mm_set1_ps(x_max);
+	const __m128 v_scale = _mm_set1_ps(scale);
+	const __m128 v_size = _mm_set1_ps(float(table_size - 1));
+	const __m128i v_index_max = _mm_set1_epi32(table_size - 2);
+	for(; i + 4 <= count; i += 4) {
+		const __m128 x = _mm_loadu_ps(&in[i]);
+		// NaN is out of range too
+		const __m128 in_range = _mm_and_ps(_mm_cmpge_ps(x, v_x_min), _mm_cmple_ps(x, v_x_max));
+		const __m128 part = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(x, v_x_min), v_scale), v_size);
+		__m128i index = _mm_cvttps_epi32(_mm_and_ps(part, in_range));
+		// the last node: index == table_size - 1, use the previous one with fraction 1.0
+		const __m128i is_last = _mm_cmpgt_epi32(index, v_index_max);
+		index = _mm_or_si128(_mm_and_si128(is_last, v_index_max), _mm_andnot_si128(is_last, index));
+		int32_t idx[4];
+		_mm_storeu_si128((__m128i *)idx, index);
+		const __m128 v1 = _mm_setr_ps(table[idx[0]], table[idx[1]], table[idx[2]], table[idx[3]]);
+		const __m128 v2 = _mm_setr_ps(table[idx[0] + 1], table[idx[1] + 1], table[idx[2] + 1], table[idx[3] + 1]);
+		const __m128 fraction = _mm_sub_ps(part, _mm_cvtepi32_ps(index));
+		__m128 v = _mm_add_ps(v1, _mm_mul_ps(_mm_sub_ps(v2, v1), fraction));
+		v = _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(is_last), v2), _mm_andnot_ps(_mm_castsi128_ps(is_last), v));
+		const int mask = _mm_movemask_ps(in_range);
+		if(mask != 0x0F) {
+			float xs[4];
+			_mm_storeu_ps(xs, x);
+			_mm_storeu_ps(&out[i], v);
+			for(int k = 0; k < 4; ++k)
+				if((mask & (1 << k)) == 0)
+					out[i + k] = (*this)(xs[k]);
+		} else {
+			_mm_storeu_ps(&out[i], v);
+		}
+	}
+#endif
+	for(; i < count; ++i)
+		out[i] = (*this)(in[i]);
+}
 /*
 float TableFunction::function(float x) {
 	return x;
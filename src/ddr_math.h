@@ -24,6 +24,9 @@ class TableFunction {
 public:
 	virtual ~TableFunction();
 	float operator()(float x);
+	// the same as operator() for 'count' values, 'out' could be the same as 'in';
+	// vectorized, values out of table range are passed to function()
+	void eval_n(float *out, const float *in, int count);
 
 protected:
 	TableFunction(void);
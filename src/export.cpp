@@ -165,7 +165,7 @@ static void write_exif(string fname, int rotation, Metadata *metadata, int width
 	// NOTE: rewrite fields with real values - width and height, possibly other too...
 	Exiv2::Image::AutoPtr exif_image = Exiv2::ImageFactory::open(fname);
 	exif_image->readMetadata();
-	if(metadata != nullptr)
+	if(metadata != nullptr && metadata->_exif_image.get() != nullptr)
 		exif_image->setExifData(metadata->_exif_image->exifData());
 	Exiv2::ExifData& exif_data = exif_image->exifData();
 
@@ -276,7 +276,7 @@ Exif.Photo.PixelYDimension                   Short       1  1536
 	// write EXIF
 	Exiv2::Image::AutoPtr exif_image = Exiv2::ImageFactory::open(file_name);
 	exif_image->readMetadata();
-	if(metadata != nullptr)
+	if(metadata != nullptr && metadata->_exif_image.get() != nullptr)
 		exif_image->setExifData(metadata->_exif_image->exifData());
 	Exiv2::ExifData& exif_data = exif_image->exifData();
 	// reset thumbnail
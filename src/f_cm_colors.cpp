@@ -141,6 +141,8 @@ public:
 	// FilterProcess_CP
 	void filter_pre(fp_cp_args_t *args);
 	void filter(float *pixel, fp_cp_task_t *fp_cp_task);
+	void filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task);
+	bool lut_allowed(fp_cp_task_t *fp_cp_task) {return true;}
 	void filter_post(fp_cp_args_t *args);
 
 	// FilterProcess_2D
@@ -358,17 +360,15 @@ public:
 	FP_CM_Colors_Cache_t(void);
 	~FP_CM_Colors_Cache_t();
 
-	TF_JS_Spline *tf_js_spline;
+	// tasks keep own references, so table is alive for tiles in progress when it's replaced
+	std::shared_ptr<TF_JS_Spline> tf_js_spline;
 	QVector<QPointF> js_curve;
 };
 
 FP_CM_Colors_Cache_t::FP_CM_Colors_Cache_t(void) {
-	tf_js_spline = nullptr;
 }
 
 FP_CM_Colors_Cache_t::~FP_CM_Colors_Cache_t() {
-	if(tf_js_spline != nullptr)
-		delete tf_js_spline;
 }
 
 class FP_CM_Colors::task_t : public fp_cp_task_t {
@@ -376,7 +376,7 @@ public:
 	// CP
 	float saturation;
 	bool js_curve;
-	class FP_CM_Colors_Cache_t *fp_cache;
+	std::shared_ptr<TF_JS_Spline> tf_js_spline;
 
 	// 2D
 	Area *area_in;
@@ -420,9 +420,7 @@ void *FP_CM_Colors::get_ptr(bool process_thumb) {
 void FP_CM_Colors::fill_js_curve(FP_CM_Colors_Cache_t *fp_cache, PS_CM_Colors *ps) {
 	if(fp_cache->js_curve != ps->js_curve && ps->enabled_js_curve) {
 		fp_cache->js_curve = ps->js_curve;
-		if(fp_cache->tf_js_spline != nullptr)
-			delete fp_cache->tf_js_spline;
-		fp_cache->tf_js_spline = new TF_JS_Spline(&ps->js_curve);
+		fp_cache->tf_js_spline = std::shared_ptr<TF_JS_Spline>(new TF_JS_Spline(&ps->js_curve));
 	}
 }
 
@@ -475,7 +473,7 @@ void FP_CM_Colors::filter_pre(fp_cp_args_t *args) {
 		task->js_curve = ps->enabled_js_curve;
 		task->gamut_use = ps->gamut_use;
 		task->sg = sg;
-		task->fp_cache = fp_cache;
+		task->tf_js_spline = fp_cache->tf_js_spline;
 		args->vector_private[i] = std::unique_ptr<fp_cp_task_t>(task);
 	}
 }
@@ -496,19 +494,34 @@ void FP_CM_Colors::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 		ddr::clip(J);
 	}
 	if(task->js_curve)
-		scale *= (*task->fp_cache->tf_js_spline)(J);
+		scale *= (*task->tf_js_spline)(J);
 #else
 	if(task->gamut_use && task->sg != nullptr && task->js_curve) {
 		float J_edge, s_edge;
 		task->sg->lightness_edge_Js(J_edge, s_edge, pixel[2]);
 		float J = pixel[0] / J_edge;
 		ddr::clip(J);
-		scale *= (*task->fp_cache->tf_js_spline)(J);
+		scale *= (*task->tf_js_spline)(J);
 	}
 #endif
 	pixel[1] *= scale;
 }
 
+void FP_CM_Colors::filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task) {
+	task_t *task = (task_t *)fp_cp_task;
+	int i = 0;
+#ifdef FILTER_CP_SSE2
+	// w/o 'Js' curve it's a scaling of saturation only
+	if(!(task->gamut_use && task->sg != nullptr && task->js_curve)) {
+		const __m128 v_scale = _mm_set_ps(1.0f, 1.0f, task->saturation, 1.0f);
+		for(; i < count; ++i)
+			_mm_storeu_ps(&pixels[i * 4], _mm_mul_ps(_mm_loadu_ps(&pixels[i * 4]), v_scale));
+	}
+#endif
+	for(; i < count; ++i)
+		filter(&pixels[i * 4], fp_cp_task);
+}
+
 //------------------------------------------------------------------------------
 std::unique_ptr<Area> FP_CM_Colors::process(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj) {
 	SubFlow *subflow = mt_obj->subflow;
@@ -559,7 +572,7 @@ std::unique_ptr<Area> FP_CM_Colors::process(MT_t *mt_obj, Process_t *process_obj
 			task->js_curve = ps->enabled_js_curve;
 			task->sg = sg;
 			task->gamut_use = ps->gamut_use;
-			task->fp_cache = fp_cache;
+			task->tf_js_spline = fp_cache->tf_js_spline;
 			subflow->set_private(task, i);
 		}
 	}
@@ -594,51 +607,52 @@ void FP_CM_Colors::process_2d(SubFlow *subflow) {
 //	if(ps->enabled_saturation && ps->saturation != 1.0)
 //		ps_saturation = ps->saturation;
 		
-	int j;
-	while((j = task->y_flow->fetch_add(1)) < y_max) {
-		int in_index = ((j + in_my) * in_width + in_mx) * 4;
-		int out_index = ((j + out_my) * out_width + out_mx) * 4;
-		for(int i = 0; i < x_max; ++i) {
+	subflow->for_rows(task->y_flow, y_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			int in_index = ((j + in_my) * in_width + in_mx) * 4;
+			int out_index = ((j + out_my) * out_width + out_mx) * 4;
+			for(int i = 0; i < x_max; ++i) {
 /*
-			float *pixel = &in[in_index];
-			float scale = ps_saturation;
-			if(task->js_curve)
-				scale *= (*task->fp_cache->tf_js_spline)(pixel[0]);
-			out[out_index + 1] = pixel[1] * scale;
+				float *pixel = &in[in_index];
+				float scale = ps_saturation;
+				if(task->js_curve)
+					scale *= (*task->tf_js_spline)(pixel[0]);
+				out[out_index + 1] = pixel[1] * scale;
 */
 #if 1
-			float pixel[4];
-			pixel[0] = in[in_index + 0];
-			pixel[1] = in[in_index + 1];
-			pixel[2] = in[in_index + 2];
-			pixel[3] = in[in_index + 3];
-			filter(pixel, task);
-			out[out_index + 1] = pixel[1];
+				float pixel[4];
+				pixel[0] = in[in_index + 0];
+				pixel[1] = in[in_index + 1];
+				pixel[2] = in[in_index + 2];
+				pixel[3] = in[in_index + 3];
+				filter(pixel, task);
+				out[out_index + 1] = pixel[1];
 /*
-			out[out_index + 0] = pixel[0];
-			out[out_index + 1] = pixel[1];
-			out[out_index + 2] = pixel[2];
-			out[out_index + 3] = pixel[3];
+				out[out_index + 0] = pixel[0];
+				out[out_index + 1] = pixel[1];
+				out[out_index + 2] = pixel[2];
+				out[out_index + 3] = pixel[3];
 */
 #else
-			float *pixel = &in[in_index];
-			float scale = task->saturation;
-			float J = pixel[0];
-			if(task->gamut_use && task->sg != nullptr) {
-				float J_edge, s_edge;
-				task->sg->lightness_edge_Js(J_edge, s_edge, pixel[2]);
-				J = J / J_edge;
-				ddr::clip(J);
-			}
-			if(task->js_curve)
-				scale *= (*task->fp_cache->tf_js_spline)(J);
-			out[out_index + 1] = pixel[1] * scale;
+				float *pixel = &in[in_index];
+				float scale = task->saturation;
+				float J = pixel[0];
+				if(task->gamut_use && task->sg != nullptr) {
+					float J_edge, s_edge;
+					task->sg->lightness_edge_Js(J_edge, s_edge, pixel[2]);
+					J = J / J_edge;
+					ddr::clip(J);
+				}
+				if(task->js_curve)
+					scale *= (*task->tf_js_spline)(J);
+				out[out_index + 1] = pixel[1] * scale;
 #endif
-			//--
-			in_index += 4;
-			out_index += 4;
+				//--
+				in_index += 4;
+				out_index += 4;
+			}
 		}
-	}
+	});
 }
 
 //------------------------------------------------------------------------------
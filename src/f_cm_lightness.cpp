@@ -161,6 +161,8 @@ public:
 	bool is_enabled(const PS_Base *ps_base);
 	void filter_pre(fp_cp_args_t *args);
 	void filter(float *pixel, fp_cp_task_t *fp_cp_task);
+	void filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task);
+	bool lut_allowed(fp_cp_task_t *fp_cp_task);
 	void filter_post(fp_cp_args_t *args);
 	
 protected:
@@ -658,27 +660,22 @@ public:
 	FP_CM_Lightness_Cache_t(void);
 	~FP_CM_Lightness_Cache_t();
 
-	TF_Spline *tf_spline;
+	// tasks keep own references, so tables are alive for tiles in progress when they are replaced
+	std::shared_ptr<TF_Spline> tf_spline;
 	bool func_table_J_is_one;	// == true - table is linear 0.0 - 1.0 => 0.0 - 1.0
 
 	QVector<QPointF> points_J;
 
-	TF_Gamma *tf_gamma;
+	std::shared_ptr<TF_Gamma> tf_gamma;
 	double gamma;
 };
 
 FP_CM_Lightness_Cache_t::FP_CM_Lightness_Cache_t(void) {
-	tf_spline = nullptr;
 	func_table_J_is_one = true;
-	tf_gamma = nullptr;
 	gamma = 1.0;
 }
 
 FP_CM_Lightness_Cache_t::~FP_CM_Lightness_Cache_t() {
-	if(tf_spline != nullptr)
-		delete tf_spline;
-	if(tf_gamma != nullptr)
-		delete tf_gamma;
 }
 
 class FP_CM_Lightness::task_t : public fp_cp_task_t {
@@ -695,7 +692,9 @@ public:
 	std::vector<long> hist_in = std::vector<long>(0);
 	std::vector<long> hist_out = std::vector<long>(0);
 
-	class FP_CM_Lightness_Cache_t *fp_cache;
+	std::shared_ptr<TF_Spline> tf_spline;
+	bool func_table_J_is_one;
+	std::shared_ptr<TF_Gamma> tf_gamma;
 };
 
 //------------------------------------------------------------------------------
@@ -728,9 +727,7 @@ void FP_CM_Lightness::filter_pre(fp_cp_args_t *args) {
 	if(fp_cache->points_J != points_J) {
 		fp_cache->points_J = points_J;
 		if(!func_table_J_is_one) {
-			if(fp_cache->tf_spline != nullptr)
-				delete fp_cache->tf_spline;
-			fp_cache->tf_spline = new TF_Spline(&points_J);
+			fp_cache->tf_spline = std::shared_ptr<TF_Spline>(new TF_Spline(&points_J));
 		}
 		fp_cache->func_table_J_is_one = func_table_J_is_one;
 	}
@@ -760,8 +757,7 @@ void FP_CM_Lightness::filter_pre(fp_cp_args_t *args) {
 	if(ps->enabled_gamma && ps->gamma != 1.0) {
 		apply_gamma = true;
 		if(fp_cache->gamma != ps->gamma) {
-			if(fp_cache->tf_gamma != nullptr) delete fp_cache->tf_gamma;
-			fp_cache->tf_gamma = new TF_Gamma(1.0 / ps->gamma);
+			fp_cache->tf_gamma = std::shared_ptr<TF_Gamma>(new TF_Gamma(1.0 / ps->gamma));
 			fp_cache->gamma = ps->gamma;
 		}
 	}
@@ -791,7 +787,9 @@ void FP_CM_Lightness::filter_pre(fp_cp_args_t *args) {
 
 	for(int i = 0; i < args->threads_count; ++i) {
 		task_t *task = new task_t;
-		task->fp_cache = fp_cache;
+		task->tf_spline = fp_cache->tf_spline;
+		task->func_table_J_is_one = fp_cache->func_table_J_is_one;
+		task->tf_gamma = fp_cache->tf_gamma;
 		if(do_histograms) {
 			task->hist_in.resize(HIST_SIZE, 0);
 			task->hist_out.resize(HIST_SIZE, 0);
@@ -836,7 +834,7 @@ void FP_CM_Lightness::filter_post(fp_cp_args_t *args) {
 void FP_CM_Lightness::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 	task_t *task = (task_t *)fp_cp_task;
 
-	bool func_table_J_is_one = task->fp_cache->func_table_J_is_one;
+	bool func_table_J_is_one = task->func_table_J_is_one;
 
 	// here is no vectorization - so no profit from SSE2
 	float alpha = pixel[3];
@@ -861,12 +859,12 @@ void FP_CM_Lightness::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 			pixel[0] = value;
 		}
 		if(!func_table_J_is_one) {
-			pixel[0] = (*task->fp_cache->tf_spline)(pixel[0]);
+			pixel[0] = (*task->tf_spline)(pixel[0]);
 		}
 	}
 	// apply gamma if necessary
 	if(task->apply_gamma)
-		pixel[0] = (*task->fp_cache->tf_gamma)(pixel[0]);
+		pixel[0] = (*task->tf_gamma)(pixel[0]);
 	//--
 	float h_in = original;
 	float h_out = pixel[0];
@@ -900,4 +898,63 @@ void FP_CM_Lightness::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 	}
 }
 
+bool FP_CM_Lightness::lut_allowed(fp_cp_task_t *fp_cp_task) {
+	// histograms need real pixels
+	task_t *task = (task_t *)fp_cp_task;
+	return (task->hist_in.size() == 0 && task->hist_out.size() == 0);
+}
+
+void FP_CM_Lightness::filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task) {
+	task_t *task = (task_t *)fp_cp_task;
+	// w/o gamut limit and histograms, J of chunk of pixels goes through levels and tables at once
+	const bool apply_gamut = (task->gamut_strength != 0.0 && task->sg != nullptr);
+	const bool do_histograms = (task->hist_in.size() != 0 || task->hist_out.size() != 0);
+	if(apply_gamut || do_histograms) {
+		for(int i = 0; i < count; ++i)
+			filter(&pixels[i * 4], fp_cp_task);
+		return;
+	}
+	const bool levels = task->apply_curve && task->levels;
+	const bool apply_table = task->apply_curve && !task->func_table_J_is_one;
+	const int chunk = 64;
+	float J[chunk];
+	for(int i = 0; i < count; i += chunk) {
+		float *pixel = &pixels[i * 4];
+		const int n = (count - i < chunk) ? count - i : chunk;
+		int k = 0;
+#ifdef FILTER_CP_SSE2
+		const __m128 v_zero = _mm_setzero_ps();
+		const __m128 v_one = _mm_set1_ps(1.0f);
+		const __m128 v_a = _mm_set1_ps(task->a);
+		const __m128 v_b = _mm_set1_ps(task->b);
+		for(; k + 4 <= n; k += 4) {
+			const float *p = &pixel[k * 4];
+			__m128 v = _mm_min_ps(_mm_setr_ps(p[0], p[4], p[8], p[12]), v_one);
+			if(levels)
+				v = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(v_a, v), v_b), v_zero), v_one);
+			_mm_storeu_ps(&J[k], v);
+		}
+#endif
+		for(; k < n; ++k) {
+			float v = pixel[k * 4];
+			if(v > 1.0f)
+				v = 1.0f;
+			if(levels) {
+				v = task->a * v + task->b;
+				if(v < 0.0f)	v = 0.0f;
+				if(v > 1.0f)	v = 1.0f;
+			}
+			J[k] = v;
+		}
+		if(apply_table)
+			task->tf_spline->eval_n(J, J, n);
+		if(task->apply_gamma)
+			task->tf_gamma->eval_n(J, J, n);
+		// keep J > 1.0 as is
+		for(k = 0; k < n; ++k)
+			if(!(pixel[k * 4] > 1.0f))
+				pixel[k * 4] = J[k];
+	}
+}
+
 //------------------------------------------------------------------------------
@@ -138,6 +138,8 @@ public:
 	bool is_enabled(const PS_Base *ps_base);
 	void filter_pre(fp_cp_args_t *args);
 	void filter(float *pixel, fp_cp_task_t *fp_cp_task);
+	void filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task);
+	bool lut_allowed(fp_cp_task_t *fp_cp_task) {return true;}
 	void filter_post(fp_cp_args_t *args);
 	
 protected:
@@ -500,23 +502,23 @@ public:
 	FP_CM_Rainbow_Cache_t(void);
 	~FP_CM_Rainbow_Cache_t();
 
-	TF_Rainbow *tf_rainbow;
-	bool tf_rainbow_is_one;	// == true - table is linear 0.0 - 1.0 => 0.0 - 1.0
+	// tasks keep own references, so table is alive for tiles in progress when it's replaced
+	std::shared_ptr<TF_Rainbow> tf_rainbow;
+	// settings used for tf_rainbow; table is rebuilt only when they change, so tiles processed in parallel could share it
+	QVector<bool> color_enabled;
+	QVector<double> color_saturation;
 };
 
 FP_CM_Rainbow_Cache_t::FP_CM_Rainbow_Cache_t(void) {
-	tf_rainbow = nullptr;
-	tf_rainbow_is_one = true;
 }
 
 FP_CM_Rainbow_Cache_t::~FP_CM_Rainbow_Cache_t() {
-	if(tf_rainbow != nullptr)
-		delete tf_rainbow;
 }
 
 class FP_CM_Rainbow::task_t : public fp_cp_task_t {
 public:
-	class FP_CM_Rainbow_Cache_t *fp_cache;
+	std::shared_ptr<TF_Rainbow> tf_rainbow;
+	bool tf_rainbow_is_one;	// == true - table is linear 0.0 - 1.0 => 0.0 - 1.0
 	bool apply_rainbow;
 };
 
@@ -553,14 +555,18 @@ void FP_CM_Rainbow::filter_pre(fp_cp_args_t *args) {
 		if(ps->color_saturation[i] != 1.0)
 			tf_rainbow_is_one = false;
 	}
-	fp_cache->tf_rainbow_is_one = tf_rainbow_is_one;
-	fp_cache->tf_rainbow = nullptr;
-	if(!tf_rainbow_is_one)
-		fp_cache->tf_rainbow = new TF_Rainbow(ps->color_enabled, ps->color_saturation);
+	if(!tf_rainbow_is_one) {
+		if(fp_cache->tf_rainbow == nullptr || fp_cache->color_enabled != ps->color_enabled || fp_cache->color_saturation != ps->color_saturation) {
+			fp_cache->tf_rainbow = std::shared_ptr<TF_Rainbow>(new TF_Rainbow(ps->color_enabled, ps->color_saturation));
+			fp_cache->color_enabled = ps->color_enabled;
+			fp_cache->color_saturation = ps->color_saturation;
+		}
+	}
 	//--
 	for(int i = 0; i < args->threads_count; ++i) {
 		task_t *task = new task_t;
-		task->fp_cache = fp_cache;
+		task->tf_rainbow = fp_cache->tf_rainbow;
+		task->tf_rainbow_is_one = tf_rainbow_is_one;
 		args->vector_private[i] = std::unique_ptr<fp_cp_task_t>(task);
 	}
 }
@@ -570,11 +576,21 @@ void FP_CM_Rainbow::filter_post(fp_cp_args_t *args) {
 
 void FP_CM_Rainbow::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 	task_t *task = (task_t *)fp_cp_task;
-	bool tf_rainbow_is_one = task->fp_cache->tf_rainbow_is_one;
+	bool tf_rainbow_is_one = task->tf_rainbow_is_one;
 	if(tf_rainbow_is_one == false) {
-		float scale = (*task->fp_cache->tf_rainbow)(pixel[2]);
+		float scale = (*task->tf_rainbow)(pixel[2]);
 		pixel[1] *= scale;
 	}
 }
 
+void FP_CM_Rainbow::filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task) {
+	task_t *task = (task_t *)fp_cp_task;
+	if(task->tf_rainbow_is_one)
+		return;
+	// lookup of table is per pixel anyway
+	TF_Rainbow *tf_rainbow = task->tf_rainbow.get();
+	for(int i = 0; i < count; ++i)
+		pixels[i * 4 + 1] *= (*tf_rainbow)(pixels[i * 4 + 2]);
+}
+
 //------------------------------------------------------------------------------
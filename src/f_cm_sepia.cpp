@@ -95,6 +95,8 @@ public:
 	bool is_enabled(const PS_Base *ps_base);
 	void filter_pre(fp_cp_args_t *args);
 	void filter(float *pixel, fp_cp_task_t *fp_cp_task);
+	void filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task);
+	bool lut_allowed(fp_cp_task_t *fp_cp_task) {return true;}
 	void filter_post(fp_cp_args_t *args);
 	
 protected:
@@ -359,4 +361,23 @@ void FP_CM_Sepia::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 	pixel[1] *= task->sepia_saturation;
 }
 
+void FP_CM_Sepia::filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task) {
+	task_t *task = (task_t *)fp_cp_task;
+	int i = 0;
+#ifdef FILTER_CP_SSE2
+	// w/o saturation limit: replace hue and scale saturation
+	if(!(task->sepia_strength > 0.0)) {
+		const __m128 v_scale = _mm_set_ps(1.0f, 1.0f, task->sepia_saturation, 1.0f);
+		const __m128 v_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, -1, -1));
+		const __m128 v_hue = _mm_set_ps(0.0f, task->sepia_hue, 0.0f, 0.0f);
+		for(; i < count; ++i) {
+			__m128 v = _mm_mul_ps(_mm_loadu_ps(&pixels[i * 4]), v_scale);
+			_mm_storeu_ps(&pixels[i * 4], _mm_or_ps(_mm_and_ps(v, v_mask), v_hue));
+		}
+	}
+#endif
+	for(; i < count; ++i)
+		filter(&pixels[i * 4], fp_cp_task);
+}
+
 //------------------------------------------------------------------------------
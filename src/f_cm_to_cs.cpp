@@ -56,8 +56,17 @@ public:
 	// FilterProcess_CP
 	void filter_pre(fp_cp_args_t *args);
 	void filter(float *pixel, fp_cp_task_t *fp_cp_task);
+	void filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task);
+	bool lut_rgb_output(void) {return true;}
+	bool lut_allowed(fp_cp_task_t *fp_cp_task) {return true;}
 	void filter_post(fp_cp_args_t *args);
 
+protected:
+	// normalize and compress 'pixel' before conversion to XYZ
+	void filter_normalize(float *pixel, task_t *task);
+
+public:
+
 	// FilterProcess_2D
 	std::unique_ptr<Area> process(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj);
 
@@ -274,8 +283,7 @@ void FP_CM_to_CS::task_release(std::vector<class task_t *> tasks, int threads_co
 	}
 }
 
-void FP_CM_to_CS::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
-	task_t *task = (task_t *)fp_cp_task;
+void FP_CM_to_CS::filter_normalize(float *pixel, task_t *task) {
 //	if(task->to_skip)
 //		return;
 	// CIECAM02 to XYZ
@@ -314,6 +322,11 @@ void FP_CM_to_CS::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 		if(pixel[0] > J_max)
 			pixel[0] = J_max + (pixel[0] - J_max) * (1.0 - compress_strength);
 	}
+}
+
+void FP_CM_to_CS::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
+	task_t *task = (task_t *)fp_cp_task;
+	filter_normalize(pixel, task);
 	float XYZ[3];
 	task->cm_convert->convert(XYZ, pixel);
 	//-------------------
@@ -324,6 +337,41 @@ void FP_CM_to_CS::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 		pixel[i] = (*task->gamma)(pixel[i]);
 }
 
+void FP_CM_to_CS::filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task) {
+	task_t *task = (task_t *)fp_cp_task;
+	// CM to XYZ for chunk of pixels at once, then XYZ to RGB
+	const int chunk = 64;
+	float XYZ[4 * chunk] = {};
+	for(int i = 0; i < count; i += chunk) {
+		float *pixel = &pixels[i * 4];
+		const int n = (count - i < chunk) ? count - i : chunk;
+		for(int k = 0; k < n; ++k)
+			filter_normalize(&pixel[k * 4], task);
+		task->cm_convert->convert_n(XYZ, pixel, n);
+		// XYZ to RGB in place, and gamma for all components at once
+		int k = 0;
+#ifdef FILTER_CP_SSE2
+		for(; k + 4 <= n; k += 4) {
+			__m128 c0, c1, c2, c3;
+			cm_load_4(&XYZ[k * 4], c0, c1, c2, c3);
+			__m128 v[3];
+			cm_m3_v3_mult_4(v, task->cmatrix, c0, c1, c2);
+			cm_store_4(&XYZ[k * 4], v[0], v[1], v[2], c3);
+		}
+#endif
+		for(; k < n; ++k) {
+			float RGB[3];
+			m3_v3_mult(RGB, task->cmatrix, &XYZ[k * 4]);
+			for(int c = 0; c < 3; ++c)
+				XYZ[k * 4 + c] = RGB[c];
+		}
+		task->gamma->eval_n(XYZ, XYZ, n * 4);
+		for(k = 0; k < n; ++k)
+			for(int c = 0; c < 3; ++c)
+				pixel[k * 4 + c] = XYZ[k * 4 + c];
+	}
+}
+
 //------------------------------------------------------------------------------
 std::unique_ptr<Area> FP_CM_to_CS::process(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj) {
 	SubFlow *subflow = mt_obj->subflow;
@@ -379,48 +427,49 @@ std::unique_ptr<Area> FP_CM_to_CS::process(MT_t *mt_obj, Process_t *process_obj,
 	const int in_width = task->area_in->mem_width();
 	const int out_width = task->area_out->mem_width();
 
-	int y;
 	// pass 1: collect information, get histogram;
-	while((y = task->y_flow_p1->fetch_add(1)) < y_max) {
-		int in_index = ((y + in_my) * in_width + in_mx) * 4;
-		int out_index = ((y + out_my) * out_width + out_mx) * 4;
-		for(int x = 0; x < x_max; ++x) {
-			float *pixel = &in[in_index];
-			//--
-			if(pixel[0] > 1.0)	pixel[0] = 1.0;
-			if(pixel[2] >= 1.0)	pixel[2] -= 1.0;
-			if(pixel[2] < 0.0)	pixel[2] += 1.0;
-			if(task->sg != nullptr && pixel[3] > 0.01) {
-				// compress saturation
-				float J_edge, s_edge;
-				task->sg->lightness_edge_Js(J_edge, s_edge, pixel[2]);
-				float s_max = s_edge;
-				if(pixel[0] <= J_edge)
-					s_max = task->sg->saturation_limit(pixel[0], pixel[2]);
-				// TODO: check histograms
-				int index = 0;
-				float _J = (pixel[0] < J_edge) ? pixel[0] : J_edge;
-//				index = ((J_edge - _J) / J_edge) * 100 + 1;
-//				if(index > 0 && index <= 100) {
-				index = ((J_edge - _J) / J_edge) * (SMAX_LENGTH - 1) + 1;
-				if(index > 0 && index <= (SMAX_LENGTH - 1)) {
-//				ddr::clip(index, 0, 100);
+	subflow->for_rows_own(task->y_flow_p1, y_max, [&](int y_begin, int y_end) {
+		for(int y = y_begin; y < y_end; ++y) {
+			int in_index = ((y + in_my) * in_width + in_mx) * 4;
+			int out_index = ((y + out_my) * out_width + out_mx) * 4;
+			for(int x = 0; x < x_max; ++x) {
+				float *pixel = &in[in_index];
+				//--
+				if(pixel[0] > 1.0)	pixel[0] = 1.0;
+				if(pixel[2] >= 1.0)	pixel[2] -= 1.0;
+				if(pixel[2] < 0.0)	pixel[2] += 1.0;
+				if(task->sg != nullptr && pixel[3] > 0.01) {
+					// compress saturation
+					float J_edge, s_edge;
+					task->sg->lightness_edge_Js(J_edge, s_edge, pixel[2]);
+					float s_max = s_edge;
+					if(pixel[0] <= J_edge)
+						s_max = task->sg->saturation_limit(pixel[0], pixel[2]);
+					// TODO: check histograms
+					int index = 0;
+					float _J = (pixel[0] < J_edge) ? pixel[0] : J_edge;
+//					index = ((J_edge - _J) / J_edge) * 100 + 1;
+//					if(index > 0 && index <= 100) {
+					index = ((J_edge - _J) / J_edge) * (SMAX_LENGTH - 1) + 1;
+					if(index > 0 && index <= (SMAX_LENGTH - 1)) {
+//					ddr::clip(index, 0, 100);
 /*
-				if(pixel[0] < J_edge) {
-					index = ((J_edge - pixel[0]) / J_edge) * 100 + 1;
-					if(index > 100)	index = 100;
-				}
+					if(pixel[0] < J_edge) {
+						index = ((J_edge - pixel[0]) / J_edge) * 100 + 1;
+						if(index > 100)	index = 100;
+					}
 */
-					++task->smax_count[index];
-					if(task->smax_value[index] < pixel[1] / s_max)
-						task->smax_value[index] = pixel[1] / s_max;
-					++task->pixels_count;
+						++task->smax_count[index];
+						if(task->smax_value[index] < pixel[1] / s_max)
+							task->smax_value[index] = pixel[1] / s_max;
+						++task->pixels_count;
+					}
 				}
+				in_index += 4;
+				out_index += 4;
 			}
-			in_index += 4;
-			out_index += 4;
 		}
-	}
+	});
 
 	// master thread: analyze information, determine compression factor
 	if(subflow->sync_point_pre()) {
@@ -447,21 +496,23 @@ std::unique_ptr<Area> FP_CM_to_CS::process(MT_t *mt_obj, Process_t *process_obj,
 
 	// pass 2: apply compression with CP process function
 	task = (task_t *)subflow->get_private();
-	while((y = task->y_flow_p2->fetch_add(1)) < y_max) {
-		int in_index = ((y + in_my) * in_width + in_mx) * 4;
-		int out_index = ((y + out_my) * out_width + out_mx) * 4;
-		for(int x = 0; x < x_max; ++x) {
-			float *pixel = &in[in_index];
-			filter(pixel, task);
-			out[out_index + 0] = in[in_index + 0];
-			out[out_index + 1] = in[in_index + 1];
-			out[out_index + 2] = in[in_index + 2];
-			out[out_index + 3] = in[in_index + 3];
-//			out[out_index + 1] = 0.0;
-			in_index += 4;
-			out_index += 4;
+	subflow->for_rows_own(task->y_flow_p2, y_max, [&](int y_begin, int y_end) {
+		for(int y = y_begin; y < y_end; ++y) {
+			int in_index = ((y + in_my) * in_width + in_mx) * 4;
+			int out_index = ((y + out_my) * out_width + out_mx) * 4;
+			for(int x = 0; x < x_max; ++x) {
+				float *pixel = &in[in_index];
+				filter(pixel, task);
+				out[out_index + 0] = in[in_index + 0];
+				out[out_index + 1] = in[in_index + 1];
+				out[out_index + 2] = in[in_index + 2];
+				out[out_index + 3] = in[in_index + 3];
+//				out[out_index + 1] = 0.0;
+				in_index += 4;
+				out_index += 4;
+			}
 		}
-	}
+	});
 
 	// clean up
 	if(subflow->sync_point_pre()) {
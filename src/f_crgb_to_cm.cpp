@@ -67,6 +67,9 @@ public:
 	bool is_enabled(const PS_Base *ps_base);
 	void filter_pre(fp_cp_args_t *args);
 	void filter(float *pixel, fp_cp_task_t *fp_cp_task);
+	void filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task);
+	bool lut_rgb_input(void) {return true;}
+	bool lut_allowed(fp_cp_task_t *fp_cp_task) {return true;}
 	void filter_post(fp_cp_args_t *args);
 	
 protected:
@@ -497,4 +500,28 @@ void FP_cRGB_to_CM::filter(float *pixel, fp_cp_task_t *fp_cp_task) {
 #endif
 }
 
+void FP_cRGB_to_CM::filter_span(float *pixels, int count, fp_cp_task_t *fp_cp_task) {
+	task_t *task = (task_t *)fp_cp_task;
+	// cRGB to XYZ for chunk of pixels, then XYZ to CM at once
+	const int chunk = 64;
+	float XYZ[4 * chunk];
+	for(int i = 0; i < count; i += chunk) {
+		float *pixel = &pixels[i * 4];
+		const int n = (count - i < chunk) ? count - i : chunk;
+		int k = 0;
+#ifdef FILTER_CP_SSE2
+		for(; k + 4 <= n; k += 4) {
+			__m128 c0, c1, c2, c3;
+			cm_load_4(&pixel[k * 4], c0, c1, c2, c3);
+			__m128 v[3];
+			cm_m3_v3_mult_4(v, task->cmatrix, c0, c1, c2);
+			cm_store_4(&XYZ[k * 4], v[0], v[1], v[2], c3);
+		}
+#endif
+		for(; k < n; ++k)
+			m3_v3_mult(&XYZ[k * 4], task->cmatrix, &pixel[k * 4]);
+		task->cm_convert->convert_n(pixel, XYZ, n);
+	}
+}
+
 //------------------------------------------------------------------------------
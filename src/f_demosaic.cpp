@@ -582,6 +582,31 @@ std::unique_ptr<Area> FP_Demosaic::process(MT_t *mt_obj, Process_t *process_obj,
 	}
 	const int threads_count = subflow->threads_count();
 
+	// -- 'uint16_p1' mosaic with black level from import
+	std::unique_ptr<Area> bayer_float;
+	if(!flag_process_xtrans && area_in->type() == Area::type_t::uint16_p1) {
+		std::unique_ptr<task_raw_t> task_raw;
+		std::unique_ptr<std::atomic_int> y_flow;
+		if(subflow->sync_point_pre()) {
+			bayer_float = std::unique_ptr<Area>(new Area(area_in->dimensions(), Area::type_t::float_p1));
+			y_flow = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
+			task_raw = std::unique_ptr<task_raw_t>(new task_raw_t);
+			task_raw->area_in = area_in;
+			task_raw->area_out = bayer_float.get();
+			task_raw->raw_scale = metadata->demosaic_raw_scale;
+			task_raw->raw_black = metadata->demosaic_raw_black;
+			task_raw->y_flow = y_flow.get();
+			for(int i = 0; i < threads_count; ++i)
+				subflow->set_private(task_raw.get(), i);
+		}
+		subflow->sync_point_post();
+
+		process_raw_to_float(subflow);
+		area_in = ((task_raw_t *)subflow->get_private())->area_out;
+
+		subflow->sync_point();
+	}
+
 	// -- chromatic aberration
 	std::unique_ptr<Area> bayer_ca;
 	double scale_red = 1.0;
@@ -851,6 +876,28 @@ cerr << "edges:   x == " << d->position.x - d->position.px_size_x * 0.5 << " - "
 	return area_out;
 }
 
+//------------------------------------------------------------------------------
+void FP_Demosaic::process_raw_to_float(class SubFlow *subflow) {
+	task_raw_t *task = (task_raw_t *)subflow->get_private();
+	const uint16_t *in = (const uint16_t *)task->area_in->ptr();
+	float *out = (float *)task->area_out->ptr();
+	const int width = task->area_in->mem_width();
+	const int height = task->area_in->mem_height();
+	// mosaic starts after the edges of 2px, so parity of positions is the same
+	const float *raw_scale = task->raw_scale;
+	const uint16_t *raw_black = task->raw_black;
+
+	subflow->for_rows(task->y_flow, height, [&](int y_begin, int y_end) {
+		for(int y = y_begin; y < y_end; ++y) {
+			const float scale[2] = {raw_scale[(y % 2) * 2 + 0], raw_scale[(y % 2) * 2 + 1]};
+			const float black[2] = {float(raw_black[(y % 2) * 2 + 0]), float(raw_black[(y % 2) * 2 + 1])};
+			const int k = y * width;
+			for(int x = 0; x < width; ++x)
+				out[k + x] = scale[x % 2] * (float(in[k + x]) - black[x % 2]);
+		}
+	});
+}
+
 //------------------------------------------------------------------------------
 void FP_Demosaic::fuji_45_rotate(class SubFlow *subflow) {
 	task_t *task = (task_t *)subflow->get_private();
@@ -220,29 +220,35 @@ void FP_Demosaic::process_AHD(class SubFlow *subflow) {
 	subflow->sync_point_post();
 
 	//== calculate Lab
+	// curve is applied to the whole row at once
+	std::vector<float> row_XYZ((x_max > x_min) ? (x_max - x_min) * 3 : 0);
 	for(int y = y_min; y < y_max; ++y) {
-		for(int x = x_min; x < x_max; ++x) {
-//			float c1, c2, c3, c4, g, g1, g2, g3, g4;
-			int k3 = ((width + 4) * (y + 2) + x + 2) * 3;
-			int k4 = ((width + 4) * (y + 2) + x + 2) * 4;
-//			int s = __bayer_pos_to_c(x, y);
-			// calculate Lab
-			for(int n = 0; n < 2; ++n) {
-				float *f = mf[n];
-				float *l = ml[n];
+		for(int n = 0; n < 2; ++n) {
+			float *f = mf[n];
+			float *l = ml[n];
+			for(int x = x_min; x < x_max; ++x) {
+				int k4 = ((width + 4) * (y + 2) + x + 2) * 4;
 				float rgb[3];
 				rgb[0] = f[k4 + 0];
 				rgb[1] = f[k4 + 1];
 				rgb[2] = f[k4 + 2];
-				float *lab = &l[k3];
-				float XYZ[3];
+				float *XYZ = &row_XYZ[(x - x_min) * 3];
 				// to XYZ
 				// NOTE: check cRGB_to_XYZ matrix converted to D50
 				m3_v3_mult(XYZ, task->cRGB_to_XYZ, rgb);
-				// wrong Von Kries transform D50, curve
-				float fX = tf_cielab(XYZ[0] / 0.96422);
-				float fY = tf_cielab(XYZ[1] / 1.00000);
-				float fZ = tf_cielab(XYZ[2] / 0.82521);
+				// wrong Von Kries transform D50
+				XYZ[0] = XYZ[0] / 0.96422;
+				XYZ[2] = XYZ[2] / 0.82521;
+			}
+			if(row_XYZ.size() != 0)
+				tf_cielab.eval_n(&row_XYZ[0], &row_XYZ[0], row_XYZ.size());
+			for(int x = x_min; x < x_max; ++x) {
+				int k3 = ((width + 4) * (y + 2) + x + 2) * 3;
+				float *lab = &l[k3];
+				const float *fXYZ = &row_XYZ[(x - x_min) * 3];
+				const float fX = fXYZ[0];
+				const float fY = fXYZ[1];
+				const float fZ = fXYZ[2];
 				lab[0] = (116.0 * fY - 16.0);
 				lab[1] = 500.0 * (fX - fY);
 				lab[2] = 200.0 * (fY - fZ);
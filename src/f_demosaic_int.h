@@ -46,6 +46,7 @@ protected:
 	void edges_from_CA(int &edge_x, int &edge_y, int width, int height, const class PS_Demosaic *ps);
 
 	class task_t;
+	void process_raw_to_float(class SubFlow *);
 	void process_bayer_CA(class SubFlow *);
 	void process_bayer_CA_sinc1(class SubFlow *);
 	void process_bayer_CA_sinc2(class SubFlow *);
@@ -127,6 +128,16 @@ public:
 	std::atomic_int *fuji_45_flow;
 };
 
+//------------------------------------------------------------------------------
+class task_raw_t {
+public:
+	Area *area_in;
+	Area *area_out;
+	const float *raw_scale;
+	const uint16_t *raw_black;
+	std::atomic_int *y_flow;
+};
+
 //------------------------------------------------------------------------------
 class task_ca_t {
 public:
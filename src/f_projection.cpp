@@ -42,6 +42,10 @@ public:
 	virtual float forward(const float &x) {return x;}
 	virtual float backward(const float &y) {return y;}
 	virtual float backward_tf(const float &y) {return y;} // with use of 'table function'
+	virtual void backward_tf_n(float *y, int count) { // in place
+		for(int i = 0; i < count; ++i)
+			y[i] = backward_tf(y[i]);
+	}
 };
 
 //------------------------------------------------------------------------------
@@ -88,6 +92,7 @@ public:
 	virtual float forward(const float &x);
 	virtual float backward(const float &y);
 	virtual float backward_tf(const float &y);
+	virtual void backward_tf_n(float *y, int count);
 
 protected:
 	float radians_per_pixel;
@@ -118,6 +123,10 @@ float FP_Projection_Gnomonic::backward_tf(const float &y) {
 	return (*backward_tf_obj)(y);
 }
 
+void FP_Projection_Gnomonic::backward_tf_n(float *y, int count) {
+	backward_tf_obj->eval_n(y, y, count);
+}
+
 //------------------------------------------------------------------------------
 namespace FP_Projection_Stereographic_ns {
 
@@ -182,6 +191,7 @@ public:
 	virtual float forward(const float &x);
 	virtual float backward(const float &y);
 	virtual float backward_tf(const float &y);
+	virtual void backward_tf_n(float *y, int count);
 
 protected:
 	float radians_per_pixel;
@@ -213,6 +223,10 @@ float FP_Projection_Stereographic::backward_tf(const float &y) {
 	return (*backward_tf_obj)(y);
 }
 
+void FP_Projection_Stereographic::backward_tf_n(float *y, int count) {
+	backward_tf_obj->eval_n(y, y, count);
+}
+
 //------------------------------------------------------------------------------
 class FP_Projection : public FilterProcess_GP {
 public:
@@ -229,18 +243,17 @@ public:
 	~FP_Projection_Cache(void);
 	float radians_per_pixel;
 	float focal_length_px;
-	FP_Projection_Function *fp_projection;
+	std::mutex lock;
+	// FP_GP objects keep own references, so function is alive for tiles in progress when it's replaced
+	std::shared_ptr<FP_Projection_Function> fp_projection;
 };
 
 FP_Projection_Cache::FP_Projection_Cache(void) {
 	radians_per_pixel = 0.0;
 	focal_length_px = 0.0;
-	fp_projection = nullptr;
 }
 
 FP_Projection_Cache::~FP_Projection_Cache(void) {
-	if(fp_projection != nullptr)
-		delete fp_projection;
 }
 
 class FP_GP_Projection : public FP_GP {
@@ -248,9 +261,10 @@ public:
 	FP_GP_Projection(const class Metadata *metadata, double strength, FP_Projection_Cache *cache);
 	void process_forward(const float &in_x, const float &in_y, float &out_x, float &out_y);
 	void process_backward(float &in_x, float &in_y, const float &out_x, const float &out_y);
+	void process_backward_n(float *xy, int count);
 
 protected:
-	FP_Projection_Function *fp_projection;
+	std::shared_ptr<FP_Projection_Function> fp_projection;
 	float diagonal_scale;
 };
 
@@ -277,9 +291,8 @@ FP_GP_Projection::FP_GP_Projection(const class Metadata *metadata, double streng
 	const double mh = 0.5l * metadata->height;
 	const double len = sqrt(mw * mw + mh * mh) * 1.2;
 
+	std::unique_lock<std::mutex> lock(cache->lock);
 	if(cache->fp_projection == nullptr || (cache->radians_per_pixel != radians_per_pixel || cache->focal_length_px != focal_length_px)) {
-		if(cache->fp_projection != nullptr)
-			delete cache->fp_projection;
 #if 0
 cerr << "radians_per_pixel == " << radians_per_pixel << endl;
 cerr << "  focal_length_px == " << focal_length_px << endl;
@@ -287,11 +300,12 @@ cerr << "              min == " << -len << endl;
 cerr << "              max == " <<  len << endl;
 #endif
 //		cache->fp_projection = new FP_Projection_Gnomonic(radians_per_pixel, focal_length_px, -len, len);
-		cache->fp_projection = new FP_Projection_Stereographic(radians_per_pixel, focal_length_px, -len, len);
+		cache->fp_projection = std::shared_ptr<FP_Projection_Function>(new FP_Projection_Stereographic(radians_per_pixel, focal_length_px, -len, len));
 		cache->radians_per_pixel = radians_per_pixel;
 		cache->focal_length_px = focal_length_px;
 	}
 	fp_projection = cache->fp_projection;
+	lock.unlock();
 
 	const float h2 = 0.5f * metadata->height;
 	// check diagonal length
@@ -322,6 +336,20 @@ void FP_GP_Projection::process_backward(float &in_x, float &in_y, const float &o
 	in_y = fp_projection->backward_tf(out_y * diagonal_scale);
 }
 
+// 'x' and 'y' are processed with the same function, so do it at once for the whole array of pairs
+void FP_GP_Projection::process_backward_n(float *xy, int count) {
+	count *= 2;
+	int i = 0;
+#ifdef FILTER_GP_SSE2
+	const __m128 v_scale = _mm_set1_ps(diagonal_scale);
+	for(; i + 4 <= count; i += 4)
+		_mm_storeu_ps(&xy[i], _mm_mul_ps(_mm_loadu_ps(&xy[i]), v_scale));
+#endif
+	for(; i < count; ++i)
+		xy[i] *= diagonal_scale;
+	fp_projection->backward_tf_n(xy, count);
+}
+
 FP_Projection::FP_Projection(void) : FilterProcess_GP() {
 	_name = "F_Projection";
 }
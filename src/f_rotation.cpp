@@ -46,6 +46,7 @@ public:
 	FP_GP_Rotation(float angle);
 	void process_forward(const float &in_x, const float &in_y, float &out_x, float &out_y);
 	void process_backward(float &in_x, float &in_y, const float &out_x, const float &out_y);
+	void process_backward_n(float *xy, int count);
 
 protected:
 	float a_sin;
@@ -71,6 +72,26 @@ void FP_GP_Rotation::process_backward(float &in_x, float &in_y, const float &out
 	in_y = b_sin * out_x + b_cos * out_y;
 }
 
+void FP_GP_Rotation::process_backward_n(float *xy, int count) {
+	int i = 0;
+#ifdef FILTER_GP_SSE2
+	const __m128 v_cos = _mm_set1_ps(b_cos);
+	const __m128 v_sin = _mm_set1_ps(b_sin);
+	for(; i + 4 <= count; i += 4) {
+		__m128 x, y;
+		gp_load_xy_4(&xy[i * 2], x, y);
+		const __m128 in_x = _mm_sub_ps(_mm_mul_ps(v_cos, x), _mm_mul_ps(v_sin, y));
+		const __m128 in_y = _mm_add_ps(_mm_mul_ps(v_sin, x), _mm_mul_ps(v_cos, y));
+		gp_store_xy_4(&xy[i * 2], in_x, in_y);
+	}
+#endif
+	for(; i < count; ++i) {
+		const float x = xy[i * 2 + 0];
+		const float y = xy[i * 2 + 1];
+		process_backward(xy[i * 2 + 0], xy[i * 2 + 1], x, y);
+	}
+}
+
 //------------------------------------------------------------------------------
 FP_Rotation::FP_Rotation(void) : FilterProcess_GP() {
 	_name = "F_Rotation";
@@ -38,6 +38,7 @@ public:
 	FP_GP_Shift(const class Metadata *metadata, double angle_v, double angle_h, double angle_r);
 	void process_forward(const float &in_x, const float &in_y, float &out_x, float &out_y);
 	void process_backward(float &in_x, float &in_y, const float &out_x, const float &out_y);
+	void process_backward_n(float *xy, int count);
 protected:
 	float z_0;
 	// matrix of photo plane rotation, and inverted
@@ -156,6 +157,31 @@ void FP_GP_Shift::process_backward(float &in_x, float &in_y, const float &out_x,
 	in_y = (p_3d[1] * z_0) / p_3d[2];
 }
 
+void FP_GP_Shift::process_backward_n(float *xy, int count) {
+	int i = 0;
+#ifdef FILTER_GP_SSE2
+	const float *m = m3_plane_rotation;
+	const __m128 v_z_0 = _mm_set1_ps(z_0);
+	for(; i + 4 <= count; i += 4) {
+		__m128 x, y;
+		gp_load_xy_4(&xy[i * 2], x, y);
+		// 'z' of 2D point is zero
+		const __m128 p_x = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[0])), _mm_mul_ps(y, _mm_set1_ps(m[1])));
+		const __m128 p_y = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[3])), _mm_mul_ps(y, _mm_set1_ps(m[4])));
+		__m128 p_z = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[6])), _mm_mul_ps(y, _mm_set1_ps(m[7])));
+		p_z = _mm_add_ps(p_z, v_z_0);
+		const __m128 in_x = _mm_div_ps(_mm_mul_ps(p_x, v_z_0), p_z);
+		const __m128 in_y = _mm_div_ps(_mm_mul_ps(p_y, v_z_0), p_z);
+		gp_store_xy_4(&xy[i * 2], in_x, in_y);
+	}
+#endif
+	for(; i < count; ++i) {
+		const float x = xy[i * 2 + 0];
+		const float y = xy[i * 2 + 1];
+		process_backward(xy[i * 2 + 0], xy[i * 2 + 1], x, y);
+	}
+}
+
 //------------------------------------------------------------------------------
 class PS_Shift : public PS_Base {
 public:
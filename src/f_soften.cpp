@@ -424,48 +424,49 @@ void FP_Soften::process(class SubFlow *subflow) {
 	}
 	float s_normalize = s_sharp + s_blur;
 
-	int j = 0;
-	while((j = task->y_flow->fetch_add(1)) < y_max) {
-		for(int i = 0; i < x_max; ++i) {
-			int l = ((j + in_y_offset) * in_width + (i + in_x_offset)) * 4;
-			int k = ((j + out_y_offset) * out_width + (i + out_x_offset)) * 4;
-
-			out[k + 3] = in[l + 3];
-			if(in[l + 3] <= 0.0) {
-				out[k + 0] = in[l + 0];
-				out[k + 1] = in[l + 1];
-				out[k + 2] = in[l + 2];
-				continue;
-			}
-			for(int ci = 0; ci < 3; ++ci) {
-				float v_blur = 0.0;
-				float blur_w = 0.0;
-				for(int y = 0; y < kernel_length; ++y) {
-					for(int x = 0; x < kernel_length; ++x) {
-						const int in_x = i + x + kernel_offset + in_x_offset;
-						const int in_y = j + y + kernel_offset + in_y_offset;
-						if(in_x >= 0 && in_x < in_w && in_y >= 0 && in_y < in_h) {
-							float alpha = in[(in_y * in_width + in_x) * 4 + 3];
-//							if(alpha == 1.0) {
-							if(alpha > 0.95) {
-								float v_in = in[(in_y * in_width + in_x) * 4 + ci];
-								float kv = kernel->value(x, y);
-								v_blur += v_in * kv;
-								blur_w += kv;
+	subflow->for_rows(task->y_flow, y_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			for(int i = 0; i < x_max; ++i) {
+				int l = ((j + in_y_offset) * in_width + (i + in_x_offset)) * 4;
+				int k = ((j + out_y_offset) * out_width + (i + out_x_offset)) * 4;
+
+				out[k + 3] = in[l + 3];
+				if(in[l + 3] <= 0.0) {
+					out[k + 0] = in[l + 0];
+					out[k + 1] = in[l + 1];
+					out[k + 2] = in[l + 2];
+					continue;
+				}
+				for(int ci = 0; ci < 3; ++ci) {
+					float v_blur = 0.0;
+					float blur_w = 0.0;
+					for(int y = 0; y < kernel_length; ++y) {
+						for(int x = 0; x < kernel_length; ++x) {
+							const int in_x = i + x + kernel_offset + in_x_offset;
+							const int in_y = j + y + kernel_offset + in_y_offset;
+							if(in_x >= 0 && in_x < in_w && in_y >= 0 && in_y < in_h) {
+								float alpha = in[(in_y * in_width + in_x) * 4 + 3];
+//								if(alpha == 1.0) {
+								if(alpha > 0.95) {
+									float v_in = in[(in_y * in_width + in_x) * 4 + ci];
+									float kv = kernel->value(x, y);
+									v_blur += v_in * kv;
+									blur_w += kv;
+								}
 							}
 						}
 					}
-				}
-				if(blur_w == 0.0) {
-					out[k + 0] = 0.0;
-					out[k + 3] = 0.0;
-				} else {
-					v_blur /= blur_w;
-					out[k + ci] = (in[l + ci] * s_sharp + v_blur * s_blur) / s_normalize;
+					if(blur_w == 0.0) {
+						out[k + 0] = 0.0;
+						out[k + 3] = 0.0;
+					} else {
+						v_blur /= blur_w;
+						out[k + ci] = (in[l + ci] * s_sharp + v_blur * s_blur) / s_normalize;
+					}
 				}
 			}
 		}
-	}
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -1124,38 +1124,39 @@ void FP_Unsharp::process_double_pass(class SubFlow *subflow) {
 //	const GaussianKernel *kernel = &k;
 
 	// horizontal pass - from input to temporal area
-	int j = 0;
 	auto y_flow_pass_1 = task->y_flow_pass_1;
-	while((j = y_flow_pass_1->fetch_add(1)) < t_y_max) {
-		for(int i = 0; i < t_x_max; ++i) {
-			const int i_temp = ((j + t_y_offset) * in_width + (i + t_x_offset));
-//			if(in[i_in + 3] <= 0.0)
-//				continue;
-			float v_blur = 0.0f;
-			float v_blur_w = 0.0f;
-			for(int x = 0; x < kernel_length; ++x) {
-//				const int in_x = i + x + kernel_offset + in_x_offset;
-				const int in_x = i + x + kernel_offset + t_x_offset;
-				if(in_x >= 0 && in_x < in_w) {
-					float alpha = in[((j + t_y_offset) * in_width + in_x) * 4 + 3];
-//					if(alpha == 1.0f) {
-					if(alpha > 0.05f) {
-						float v_in = in[((j + t_y_offset) * in_width + in_x) * 4 + 0];
-						if(v_in < 0.0f)
-							v_in = 0.0f;
-						float kv = kernel->value(x);
-						v_blur += v_in * kv;
-						v_blur_w += kv;
+	subflow->for_rows(y_flow_pass_1, t_y_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			for(int i = 0; i < t_x_max; ++i) {
+				const int i_temp = ((j + t_y_offset) * in_width + (i + t_x_offset));
+//				if(in[i_in + 3] <= 0.0)
+//					continue;
+				float v_blur = 0.0f;
+				float v_blur_w = 0.0f;
+				for(int x = 0; x < kernel_length; ++x) {
+//					const int in_x = i + x + kernel_offset + in_x_offset;
+					const int in_x = i + x + kernel_offset + t_x_offset;
+					if(in_x >= 0 && in_x < in_w) {
+						float alpha = in[((j + t_y_offset) * in_width + in_x) * 4 + 3];
+//						if(alpha == 1.0f) {
+						if(alpha > 0.05f) {
+							float v_in = in[((j + t_y_offset) * in_width + in_x) * 4 + 0];
+							if(v_in < 0.0f)
+								v_in = 0.0f;
+							float kv = kernel->value(x);
+							v_blur += v_in * kv;
+							v_blur_w += kv;
+						}
 					}
 				}
+				if(v_blur_w == 0.0f) {
+					temp[i_temp] = 0.0f;
+					continue;
+				}
+				temp[i_temp] = v_blur / v_blur_w;
 			}
-			if(v_blur_w == 0.0f) {
-				temp[i_temp] = 0.0f;
-				continue;
-			}
-			temp[i_temp] = v_blur / v_blur_w;
 		}
-	}
+	});
 
 	// temporary array barrier
 	subflow->sync_point();
@@ -1167,70 +1168,72 @@ void FP_Unsharp::process_double_pass(class SubFlow *subflow) {
 //	float threshold = task->threshold;
 	// vertical pass - from temporary to output area
 	auto y_flow_pass_2 = task->y_flow_pass_2;
-	while((j = y_flow_pass_2->fetch_add(1)) < y_max) {
-		for(int i = 0; i < x_max; ++i) {
-			const int i_in = ((j + in_y_offset) * in_width + (i + in_x_offset)) * 4; // k
-			const int i_out = ((j + out_y_offset) * out_width + (i + out_x_offset)) * 4; // l
-//			const int i_temp = j * temp_width + i;
-			out[i_out + 0] = in[i_in + 0];
-			out[i_out + 1] = in[i_in + 1];
-			out[i_out + 2] = in[i_in + 2];
-			out[i_out + 3] = in[i_in + 3];
-			if(in[i_in + 3] <= 0.0f)
-				continue;
-			float v_blur = 0.0f;
-			float v_blur_w = 0.0f;
-			for(int y = 0; y < kernel_length; ++y) {
-				const int in_y = j + y + kernel_offset + in_y_offset;
-				if(in_y >= 0 && in_y < in_h) {
-					float alpha = in[(in_y * in_width + i + in_x_offset) * 4 + 3];
-//					if(alpha == 1.0) {
-					if(alpha > 0.05f) {
-						float v_temp = temp[in_y * in_width + i + in_x_offset];
-						float kv = kernel->value(y);
-						v_blur += v_temp * kv;
-						v_blur_w += kv;
+	subflow->for_rows(y_flow_pass_2, y_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			for(int i = 0; i < x_max; ++i) {
+				const int i_in = ((j + in_y_offset) * in_width + (i + in_x_offset)) * 4; // k
+				const int i_out = ((j + out_y_offset) * out_width + (i + out_x_offset)) * 4; // l
+//				const int i_temp = j * temp_width + i;
+				out[i_out + 0] = in[i_in + 0];
+				out[i_out + 1] = in[i_in + 1];
+				out[i_out + 2] = in[i_in + 2];
+				out[i_out + 3] = in[i_in + 3];
+				if(in[i_in + 3] <= 0.0f)
+					continue;
+				float v_blur = 0.0f;
+				float v_blur_w = 0.0f;
+				for(int y = 0; y < kernel_length; ++y) {
+					const int in_y = j + y + kernel_offset + in_y_offset;
+					if(in_y >= 0 && in_y < in_h) {
+						float alpha = in[(in_y * in_width + i + in_x_offset) * 4 + 3];
+//						if(alpha == 1.0) {
+						if(alpha > 0.05f) {
+							float v_temp = temp[in_y * in_width + i + in_x_offset];
+							float kv = kernel->value(y);
+							v_blur += v_temp * kv;
+							v_blur_w += kv;
+						}
 					}
 				}
-			}
-			if(v_blur_w == 0.0f) {
-				out[i_out + 0] = 0.5f;
-				out[i_out + 3] = 0.0f;
-				continue;
-			}
-			v_blur /= v_blur_w;
+				if(v_blur_w == 0.0f) {
+					out[i_out + 0] = 0.5f;
+					out[i_out + 3] = 0.0f;
+					continue;
+				}
+				v_blur /= v_blur_w;
 
-//			out[i_out + 0] = v_blur;
-//			continue;
-			const float v_in = in[i_in + 0];
+//				out[i_out + 0] = v_blur;
+//				continue;
+				const float v_in = in[i_in + 0];
 #if 0
-			float v_out = v_in - v_blur;
-			// smooth amount increase for values under threshold to avoid coarsness
-			const float v_out_abs = ddr::abs(v_out);
-			if(v_out_abs < threshold)
-				v_out *= amount * (v_out_abs / threshold);
-			else
-				v_out *= amount;
-			v_out = v_out + v_in;
+				float v_out = v_in - v_blur;
+				// smooth amount increase for values under threshold to avoid coarsness
+				const float v_out_abs = ddr::abs(v_out);
+				if(v_out_abs < threshold)
+					v_out *= amount * (v_out_abs / threshold);
+				else
+					v_out *= amount;
+				v_out = v_out + v_in;
 #else
 #if 1
-			const float scale = amount * ((v_blur * 4.0f < 1.0f) ? v_blur * 4.0f : 1.0f);
-			float v_out = (v_in - v_blur) * scale + v_in;
+				const float scale = amount * ((v_blur * 4.0f < 1.0f) ? v_blur * 4.0f : 1.0f);
+				float v_out = (v_in - v_blur) * scale + v_in;
 #else
-			float v_out = (v_in - v_blur) * amount + v_in;
+				float v_out = (v_in - v_blur) * amount + v_in;
 #endif
 #endif
 #if 1
-//			ddr::clip(v_out, v_in * 0.4f, v_in + (1.0f - v_in) * 0.6f);
-			const float v_min = (lc_darken) ? v_in * 0.5f : v_in;
-			const float v_max = (lc_brighten) ? v_in * 0.5f + 0.5f : v_in;
-			ddr::clip(v_out, v_min, v_max);
+//				ddr::clip(v_out, v_in * 0.4f, v_in + (1.0f - v_in) * 0.6f);
+				const float v_min = (lc_darken) ? v_in * 0.5f : v_in;
+				const float v_max = (lc_brighten) ? v_in * 0.5f + 0.5f : v_in;
+				ddr::clip(v_out, v_min, v_max);
 #else
-			v_out = ddr::clip(v_out);
+				v_out = ddr::clip(v_out);
 #endif
-			out[i_out + 0] = v_out;
+				out[i_out + 0] = v_out;
+			}
 		}
-	}
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -1256,7 +1259,6 @@ void FP_Unsharp::process_single_pass(class SubFlow *subflow) {
 	const float threshold = task->threshold;
 	const float threshold_pt = threshold * 32.0f;
 
-	int j = 0;
 	const int kernel_length = task->kernel->width();
 	const int kernel_offset = task->kernel->offset_x();
 	const GaussianKernel *kernel = task->kernel;
@@ -1264,71 +1266,73 @@ void FP_Unsharp::process_single_pass(class SubFlow *subflow) {
 //	const GaussianKernel *kernel = &k;
 
 	auto y_flow = task->y_flow_pass_1;
-	while((j = y_flow->fetch_add(1)) < y_max) {
-		for(int i = 0; i < x_max; ++i) {
-			const int l = ((j + in_y_offset) * in_width + (i + in_x_offset)) * 4;
-			const int k = ((j + out_y_offset) * out_width + (i + out_x_offset)) * 4;
-			//--
-			out[k + 1] = in[l + 1];
-			out[k + 2] = in[l + 2];
-			out[k + 3] = in[l + 3];
-			if(in[l + 3] <= 0.0f) {
-				out[k + 0] = 0.5f;
-				continue;
-			}
-			// calculate blurred value
-			float v_blur = 0.0f;
-			float v_blur_w = 0.0f;
-			for(int y = 0; y < kernel_length; ++y) {
-				for(int x = 0; x < kernel_length; ++x) {
-					const int in_x = i + x + kernel_offset + in_x_offset;
-					const int in_y = j + y + kernel_offset + in_y_offset;
-					if(in_x >= 0 && in_x < in_w && in_y >= 0 && in_y < in_h) {
-						const float alpha = in[(in_y * in_width + in_x) * 4 + 3];
-//						if(alpha == 1.0) {
-						if(alpha > 0.05f) {
-							const float v_in = in[(in_y * in_width + in_x) * 4 + 0];
-							const float w = kernel->value(x, y);
-							v_blur += v_in * w;
-							v_blur_w += w;
+	subflow->for_rows(y_flow, y_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			for(int i = 0; i < x_max; ++i) {
+				const int l = ((j + in_y_offset) * in_width + (i + in_x_offset)) * 4;
+				const int k = ((j + out_y_offset) * out_width + (i + out_x_offset)) * 4;
+				//--
+				out[k + 1] = in[l + 1];
+				out[k + 2] = in[l + 2];
+				out[k + 3] = in[l + 3];
+				if(in[l + 3] <= 0.0f) {
+					out[k + 0] = 0.5f;
+					continue;
+				}
+				// calculate blurred value
+				float v_blur = 0.0f;
+				float v_blur_w = 0.0f;
+				for(int y = 0; y < kernel_length; ++y) {
+					for(int x = 0; x < kernel_length; ++x) {
+						const int in_x = i + x + kernel_offset + in_x_offset;
+						const int in_y = j + y + kernel_offset + in_y_offset;
+						if(in_x >= 0 && in_x < in_w && in_y >= 0 && in_y < in_h) {
+							const float alpha = in[(in_y * in_width + in_x) * 4 + 3];
+//							if(alpha == 1.0) {
+							if(alpha > 0.05f) {
+								const float v_in = in[(in_y * in_width + in_x) * 4 + 0];
+								const float w = kernel->value(x, y);
+								v_blur += v_in * w;
+								v_blur_w += w;
+							}
 						}
 					}
 				}
-			}
-			if(v_blur_w == 0.0f) {
-				out[k + 0] = 0.5f;
-				out[k + 3] = 0.0f;
-				continue;
-			}
-			v_blur /= v_blur_w;
+				if(v_blur_w == 0.0f) {
+					out[k + 0] = 0.5f;
+					out[k + 3] = 0.0f;
+					continue;
+				}
+				v_blur /= v_blur_w;
 
-			const float v_in = in[l + 0];
-			float v_out = v_in - v_blur;
-			// smooth amount increase for values under threshold to avoid coarsness
-//			const float v_out_abs = ddr::abs(v_out);
+				const float v_in = in[l + 0];
+				float v_out = v_in - v_blur;
+				// smooth amount increase for values under threshold to avoid coarsness
+//				const float v_out_abs = ddr::abs(v_out);
 #if 1
-			float scale = 1.0f;
-			if(threshold_pt > 0.0f) {
-				float vb = v_blur / threshold_pt;
-				scale = (vb < 1.0f) ? vb : 1.0f;
-			}
-			v_out *= amount * scale;
+				float scale = 1.0f;
+				if(threshold_pt > 0.0f) {
+					float vb = v_blur / threshold_pt;
+					scale = (vb < 1.0f) ? vb : 1.0f;
+				}
+				v_out *= amount * scale;
 #else
-			if(v_out_abs < threshold)
-				v_out *= amount * (v_out_abs / threshold);
-			else
-				v_out *= amount;
+				if(v_out_abs < threshold)
+					v_out *= amount * (v_out_abs / threshold);
+				else
+					v_out *= amount;
 #endif
-			v_out = v_in + v_out;
-			// limit changes
-//			ddr::clip(v_out, v_in * 0.4f, v_in + (1.0f - v_in) * 0.6f);
-			ddr::clip(v_out, v_in * 0.5f, v_in * 0.5f + 0.5f);
-//			ddr::clip(v_out, 0.0f, 1.0f);
-			//--
-//			v_out = ddr::clip(v_out);
-			out[k + 0] = v_out;
+				v_out = v_in + v_out;
+				// limit changes
+//				ddr::clip(v_out, v_in * 0.4f, v_in + (1.0f - v_in) * 0.6f);
+				ddr::clip(v_out, v_in * 0.5f, v_in * 0.5f + 0.5f);
+//				ddr::clip(v_out, 0.0f, 1.0f);
+				//--
+//				v_out = ddr::clip(v_out);
+				out[k + 0] = v_out;
+			}
 		}
-	}
+	});
 }
 
 //------------------------------------------------------------------------------
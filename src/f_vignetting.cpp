@@ -352,30 +352,27 @@ void FP_Vignetting::process(SubFlow *subflow) {
 	const float scale_x2 = task->scale_x2;
 	const float scale_x3 = task->scale_x3;
 
-	float pos_y = start_y;
-	int y;
-	int y_prev = 0;
-	while((y = task->y_flow->fetch_add(1)) < in_h) {
-		pos_y += delta_y * (y - y_prev);
-		y_prev = y;
-
-		float pos_x = start_x;
-		for(int x = 0; x < in_w; ++x) {
-			const int index_in = (in_mem_w * (in_off_y + y) + in_off_x + x) * 4;
-			const int index_out = (out_mem_w * (out_off_y + y) + out_off_x + x) * 4;
-
-			float s = 1.0f;
-			if(in[index_in + 3] > 0.0f) {
-				const float r = sqrtf(pos_x * pos_x + pos_y * pos_y) * scale;
-				s = 1.0f + r * r * scale_x2 + r * r * r * scale_x3;
+	subflow->for_rows(task->y_flow, in_h, [&](int y_begin, int y_end) {
+		for(int y = y_begin; y < y_end; ++y) {
+			const float pos_y = start_y + delta_y * y;
+			float pos_x = start_x;
+			for(int x = 0; x < in_w; ++x) {
+				const int index_in = (in_mem_w * (in_off_y + y) + in_off_x + x) * 4;
+				const int index_out = (out_mem_w * (out_off_y + y) + out_off_x + x) * 4;
+
+				float s = 1.0f;
+				if(in[index_in + 3] > 0.0f) {
+					const float r = sqrtf(pos_x * pos_x + pos_y * pos_y) * scale;
+					s = 1.0f + r * r * scale_x2 + r * r * r * scale_x3;
+				}
+				out[index_out + 0] = s * in[index_in + 0];
+				out[index_out + 1] = s * in[index_in + 1];
+				out[index_out + 2] = s * in[index_in + 2];
+				out[index_out + 3] =     in[index_in + 3];
+
+				pos_x += delta_x;
 			}
-			out[index_out + 0] = s * in[index_in + 0];
-			out[index_out + 1] = s * in[index_in + 1];
-			out[index_out + 2] = s * in[index_in + 2];
-			out[index_out + 3] =     in[index_in + 3];
-
-			pos_x += delta_x;
 		}
-	}
+	});
 }
 //------------------------------------------------------------------------------
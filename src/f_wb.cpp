@@ -1201,86 +1201,87 @@ void FP_WB::process_wb(SubFlow *subflow) {
 	const int out_off_x = task->area_out->dimensions()->edges.x1;
 	const int out_off_y = task->area_out->dimensions()->edges.y1;
 
-	int y;
-	while((y = task->y_flow->fetch_add(1)) < in_h) {
-		for(int x = 0; x < in_w; ++x) {
-			const int index_in = (in_mem_w * (in_off_y + y) + in_off_x + x) * 4;
-			const int index_out = (out_mem_w * (out_off_y + y) + out_off_x + x) * 4;
-//			float c_in[3];
-			const float *c_in = &in[index_in];
-			float c[3];
-			for(int i = 0; i < 3; ++i) {
-//				c_in[i] = in[index_in + i];// * task->c_scale[i];
-				c[i] = c_in[i] * task->scale_a[i] + task->scale_b[i];
-			}
-			if(task->hl_clip) {
-				const float limit = task->limit;
-				int indexes[3];
-				int counter = 0;
-				for(int k = 0; k < 3; ++k) {
-//					if(c[k] >= limit) {
-					if(c[k] > limit) {
-						indexes[counter++] = k;
-					}
-				}
-				if(counter == 3) {
-					c[0] = c[1] = c[2] = 1.0f;
-				}
-				if(counter == 1) {
-					int k = indexes[0];
-					float d = task->edge[k] - 1.0f;
-					float scale = (d <= 0.0f) ? 0.0f : ((c[k] - 1.0f) / d);
-					scale = (scale >= 0.0f) ? scale : -scale;
-					c[0] = c[0] + (1.0f - c[0]) * scale;
-					c[1] = c[1] + (1.0f - c[1]) * scale;
-					c[2] = c[2] + (1.0f - c[2]) * scale;
-					c[k] = 1.0f;
+	subflow->for_rows_own(task->y_flow, in_h, [&](int y_begin, int y_end) {
+		for(int y = y_begin; y < y_end; ++y) {
+			for(int x = 0; x < in_w; ++x) {
+				const int index_in = (in_mem_w * (in_off_y + y) + in_off_x + x) * 4;
+				const int index_out = (out_mem_w * (out_off_y + y) + out_off_x + x) * 4;
+//				float c_in[3];
+				const float *c_in = &in[index_in];
+				float c[3];
+				for(int i = 0; i < 3; ++i) {
+//					c_in[i] = in[index_in + i];// * task->c_scale[i];
+					c[i] = c_in[i] * task->scale_a[i] + task->scale_b[i];
 				}
-				if(counter == 2) {
-					// make 'continuity' of color scaling for k with smallest edge, s oa new one would connect smoothly
-					// to case with 'counter == 1'
-					int k1 = indexes[0];
-					int k2 = indexes[1];
-					int k = 0;
-					while(k == k1 || k == k2)
-						++k;
-					const float d1 = task->edge[k1] - 1.0f;
-					float scale1 = (d1 <= 0.0f) ? 0.0f : ((c[k1] - 1.0f) / d1);
-					const float d2 = task->edge[k2] - 1.0f;
-					float scale2 = (d2 <= 0.0f) ? 0.0f : ((c[k2] - 1.0f) / d2);
-					ddr::clip(scale1);
-					ddr::clip(scale2);
-//					float scale = (scale1 + scale2) * 0.5;
-					float scale = ddr::max(scale1, scale2);
-					ddr::clip(scale);
-					c[k] += std::max((1.0f - c[k]) * scale, 0.0f);
+				if(task->hl_clip) {
+					const float limit = task->limit;
+					int indexes[3];
+					int counter = 0;
+					for(int k = 0; k < 3; ++k) {
+//						if(c[k] >= limit) {
+						if(c[k] > limit) {
+							indexes[counter++] = k;
+						}
+					}
+					if(counter == 3) {
+						c[0] = c[1] = c[2] = 1.0f;
+					}
+					if(counter == 1) {
+						int k = indexes[0];
+						float d = task->edge[k] - 1.0f;
+						float scale = (d <= 0.0f) ? 0.0f : ((c[k] - 1.0f) / d);
+						scale = (scale >= 0.0f) ? scale : -scale;
+						c[0] = c[0] + (1.0f - c[0]) * scale;
+						c[1] = c[1] + (1.0f - c[1]) * scale;
+						c[2] = c[2] + (1.0f - c[2]) * scale;
+						c[k] = 1.0f;
+					}
+					if(counter == 2) {
+						// make 'continuity' of color scaling for k with smallest edge, s oa new one would connect smoothly
+						// to case with 'counter == 1'
+						int k1 = indexes[0];
+						int k2 = indexes[1];
+						int k = 0;
+						while(k == k1 || k == k2)
+							++k;
+						const float d1 = task->edge[k1] - 1.0f;
+						float scale1 = (d1 <= 0.0f) ? 0.0f : ((c[k1] - 1.0f) / d1);
+						const float d2 = task->edge[k2] - 1.0f;
+						float scale2 = (d2 <= 0.0f) ? 0.0f : ((c[k2] - 1.0f) / d2);
+						ddr::clip(scale1);
+						ddr::clip(scale2);
+//						float scale = (scale1 + scale2) * 0.5;
+						float scale = ddr::max(scale1, scale2);
+						ddr::clip(scale);
+						c[k] += std::max((1.0f - c[k]) * scale, 0.0f);
+					}
 				}
-			}
-			for(int k = 0; k < 3; ++k)
-				out[index_out + k] = ddr::clip(c[k]);
-			// update histograms
-			if(!task->hist_in.empty() && !task->hist_out.empty()) {
-				for(int k = 0; k < 3; ++k) {
-					int i_in = static_cast<int>(c_in[k] * 200.0f);
-					ddr::clip(i_in, 0, 255);
-					++task->hist_in[256 * k + i_in];
-
-					int i_out = static_cast<int>(c[k] * 200.0f);
-					ddr::clip(i_out, 0, 255);
-					++task->hist_out[256 * k + i_out];
-/*
-					int i_in = c_in[k] * 200.0f;
-					if(i_in >= 0 && i_in < 256)
+				for(int k = 0; k < 3; ++k)
+					out[index_out + k] = ddr::clip(c[k]);
+				// update histograms
+				if(!task->hist_in.empty() && !task->hist_out.empty()) {
+					for(int k = 0; k < 3; ++k) {
+						int i_in = static_cast<int>(c_in[k] * 200.0f);
+						ddr::clip(i_in, 0, 255);
 						++task->hist_in[256 * k + i_in];
-					int i_out = c[k] * 200.0f;
-					if(i_out >= 0 && i_out < 256)
+
+						int i_out = static_cast<int>(c[k] * 200.0f);
+						ddr::clip(i_out, 0, 255);
 						++task->hist_out[256 * k + i_out];
+/*
+						int i_in = c_in[k] * 200.0f;
+						if(i_in >= 0 && i_in < 256)
+							++task->hist_in[256 * k + i_in];
+						int i_out = c[k] * 200.0f;
+						if(i_out >= 0 && i_out < 256)
+							++task->hist_out[256 * k + i_out];
 */
+					}
 				}
+				out[index_out + 3] = in[index_in + 3];
 			}
-			out[index_out + 3] = in[index_in + 3];
 		}
-	}
+	});
 }
 
 void FP_WB::scale_histogram(QVector<float> &out, int out_1, uint32_t *in, int in_count, int in_1, float v_scale, float v_offset) {
@@ -7,13 +7,21 @@
  *
  */
 
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
+#include "dataset.h"
 #include "filter_cp.h"
 #include "process_h.h"
+#include "system.h"
 
 using namespace std;
 
+#define FILTER_CP_SPAN_MAX 256
+// nodes of 3D LUT per axis
+#define FILTER_CP_LUT_SIZE 33
+
 //------------------------------------------------------------------------------
 FilterProcess_CP::FilterProcess_CP(void) {
 	_name = "Unknown FilterProcess_CP";
@@ -30,6 +38,11 @@ void FilterProcess_CP::filter_pre(fp_cp_args_t *args) {
 void FilterProcess_CP::filter_post(fp_cp_args_t *args) {
 }
 
+void FilterProcess_CP::filter_span(float *pixels, int count, fp_cp_task_t *task) {
+	for(int i = 0; i < count; ++i)
+		filter(&pixels[i * 4], task);
+}
+
 //------------------------------------------------------------------------------
 FilterProcess_CP_Wrapper::FilterProcess_CP_Wrapper(const vector<class FP_CP_Wrapper_record_t> &_vector) {
 	fp_cp_vector = _vector;
@@ -40,6 +53,7 @@ FilterProcess_CP_Wrapper::FilterProcess_CP_Wrapper(const vector<class FP_CP_Wrap
 			_name += ", ";
 	}
 	allow_destructive = true;
+	lut_cache = nullptr;
 //cerr << "created CP_Wrapper: " << _name << endl;
 }
 
@@ -51,6 +65,10 @@ void FilterProcess_CP_Wrapper::set_destructive(bool v) {
 	allow_destructive = v;
 }
 
+void FilterProcess_CP_Wrapper::set_lut_cache(FP_CP_LUT_Cache_t *_lut_cache) {
+	lut_cache = _lut_cache;
+}
+
 bool FilterProcess_CP_Wrapper::is_enabled(const PS_Base *) {
 	return true;
 }
@@ -63,6 +81,8 @@ public:
 	std::atomic_int *y_flow;
 	bool destructive;
 	std::vector<std::unique_ptr<fp_cp_args_t>> *filter_args;
+	// 3D LUT to use instead of filters, if not null
+	const FP_CP_LUT_t *lut;
 };
 
 std::unique_ptr<Area> FilterProcess_CP_Wrapper::process(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj) {
@@ -75,6 +95,7 @@ std::unique_ptr<Area> FilterProcess_CP_Wrapper::process(MT_t *mt_obj, Process_t
 	std::vector<std::unique_ptr<fp_cp_args_t>> args(0);
 	std::unique_ptr<std::atomic_int> y_flow;
 	std::vector<std::unique_ptr<task_t>> tasks(0);
+	std::shared_ptr<const FP_CP_LUT_t> lut;
 
 	if(subflow->sync_point_pre()) {
 		Area *area_in = process_obj->area_in;
@@ -107,6 +128,33 @@ std::unique_ptr<Area> FilterProcess_CP_Wrapper::process(MT_t *mt_obj, Process_t
 			fp_cp_vector[i].fp_cp->filter_pre(arg);
 		}
 
+		// preview: use 3D LUT baked with the same settings, or bake a new one
+		bool use_lut = (lut_cache != nullptr && !filter_obj->is_offline && System::instance()->preview_lut() && filters_count > 0);
+		if(use_lut)
+			use_lut = fp_cp_vector[0].fp_cp->lut_rgb_input() && fp_cp_vector[filters_count - 1].fp_cp->lut_rgb_output();
+		for(int i = 0; i < filters_count && use_lut; ++i)
+			use_lut = fp_cp_vector[i].fp_cp->lut_allowed(args[i]->vector_private[0].get());
+		if(use_lut) {
+			std::string lut_key;
+			for(int i = 0; i < filters_count; ++i) {
+				DataSet dataset;
+				fp_cp_vector[i].ps_base->save(&dataset);
+				lut_key += fp_cp_vector[i].fp_cp->name() + "\n" + dataset.serialize();
+			}
+			if(process_obj->mutators != nullptr)
+				lut_key += process_obj->mutators->serialize();
+			if(process_obj->mutators_multipass != nullptr)
+				lut_key += process_obj->mutators_multipass->serialize();
+			// bake here, by 'main' thread only: standalone subflows of parallel tiles serialize that section,
+			// so the lock can't be held across sync points
+			std::lock_guard<std::mutex> lut_locker(lut_cache->lock);
+			if(lut_cache->lut == nullptr || lut_cache->key != lut_key) {
+				lut_cache->lut = lut_bake(args);
+				lut_cache->key = lut_key;
+			}
+			lut = lut_cache->lut;
+		}
+
 		y_flow = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
 		tasks.resize(threads_count);
 		for(int i = 0; i < threads_count; ++i) {
@@ -119,6 +167,7 @@ std::unique_ptr<Area> FilterProcess_CP_Wrapper::process(MT_t *mt_obj, Process_t
 			task->y_flow = y_flow.get();
 			task->destructive = destructive;
 			task->filter_args = &args;
+			task->lut = lut.get();
 
 			subflow->set_private(task, i);
 		}
@@ -137,6 +186,31 @@ std::unique_ptr<Area> FilterProcess_CP_Wrapper::process(MT_t *mt_obj, Process_t
 	return area_out;
 }
 
+// Evaluate filters at nodes of LUT, with rows of nodes along B axis as spans.
+std::shared_ptr<const FP_CP_LUT_t> FilterProcess_CP_Wrapper::lut_bake(const std::vector<std::unique_ptr<fp_cp_args_t>> &args) {
+	std::shared_ptr<FP_CP_LUT_t> lut(new FP_CP_LUT_t(FILTER_CP_LUT_SIZE));
+	const int size = lut->size;
+	const int filters_count = fp_cp_vector.size();
+	std::vector<float> nodes(size * 4);
+	for(int ir = 0; ir < size; ++ir) {
+		for(int ig = 0; ig < size; ++ig) {
+			for(int ib = 0; ib < size; ++ib) {
+				nodes[ib * 4 + 0] = FP_CP_LUT_t::node_value(ir, size);
+				nodes[ib * 4 + 1] = FP_CP_LUT_t::node_value(ig, size);
+				nodes[ib * 4 + 2] = FP_CP_LUT_t::node_value(ib, size);
+				nodes[ib * 4 + 3] = 1.0f;
+			}
+			for(int fi = 0; fi < filters_count; ++fi)
+				fp_cp_vector[fi].fp_cp->filter_span(&nodes[0], size, args[fi]->vector_private[0].get());
+			float *table = &lut->table[(ir * size + ig) * size * 3];
+			for(int ib = 0; ib < size; ++ib)
+				for(int c = 0; c < 3; ++c)
+					table[ib * 3 + c] = nodes[ib * 4 + c];
+		}
+	}
+	return lut;
+}
+
 void FilterProcess_CP_Wrapper::process(class SubFlow *subflow) {
 	task_t *task = (task_t *)subflow->get_private();
 
@@ -154,40 +228,104 @@ void FilterProcess_CP_Wrapper::process(class SubFlow *subflow) {
 	float *out = (float *)task->area_out->ptr();
 
 	const int filters_count = fp_cp_vector.size();
-	float mt[4];
-	const int flow_index = task->flow_index;
+	std::vector<fp_cp_task_t *> filter_tasks(filters_count);
+	for(int fi = 0; fi < filters_count; ++fi)
+		filter_tasks[fi] = (*(task->filter_args))[fi]->vector_private[task->flow_index].get();
 	const bool destructive = task->destructive;
-	int j;
 	auto y_flow = task->y_flow;
-	while((j = y_flow->fetch_add(1)) < y_max) {
-		int i_in = ((j + in_my1) * in_width + in_mx1) * 4;
-		if(destructive) {
-			for(int i = 0; i < x_max; ++i) {
-				if(in[i_in + 3] > 0.0)
-					for(int fi = 0; fi < filters_count; ++fi)
-						fp_cp_vector[fi].fp_cp->filter(&in[i_in], (*(task->filter_args))[fi]->vector_private[flow_index].get());
-				i_in += 4;
+	// filters keep per-thread state, so rows are processed by threads of flow only
+	subflow->for_rows_own(y_flow, y_max, [&](int y_begin, int y_end) {
+		for(int j = y_begin; j < y_end; ++j) {
+			float *row = &in[((j + in_my1) * in_width + in_mx1) * 4];
+			if(!destructive) {
+				float *row_out = &out[((j + out_my1) * out_width + out_mx1) * 4];
+				std::memcpy(row_out, row, sizeof(float) * 4 * x_max);
+				row = row_out;
 			}
-		} else {
-			int i_out = ((j + out_my1) * out_width + out_mx1) * 4;
-			for(int i = 0; i < x_max; ++i) {
-				if(in[i_in + 3] > 0.0) {
-					mt[0] = in[i_in + 0];
-					mt[1] = in[i_in + 1];
-					mt[2] = in[i_in + 2];
-					mt[3] = in[i_in + 3];
-					for(int fi = 0; fi < filters_count; ++fi)
-						fp_cp_vector[fi].fp_cp->filter(mt, ((*(task->filter_args))[fi]->vector_private[flow_index].get()));
-					out[i_out + 0] = mt[0];
-					out[i_out + 1] = mt[1];
-					out[i_out + 2] = mt[2];
-					out[i_out + 3] = mt[3];
-				}
-				i_in += 4;
-				i_out += 4;
+			// spans of opaque pixels, short enough to stay in L1 cache through all filters
+			int i = 0;
+			while(i < x_max) {
+				while(i < x_max && !(row[i * 4 + 3] > 0.0f))
+					++i;
+				const int span_start = i;
+				while(i < x_max && i - span_start < FILTER_CP_SPAN_MAX && row[i * 4 + 3] > 0.0f)
+					++i;
+				if(i != span_start)
+					process_span(&row[span_start * 4], i - span_start, task, filter_tasks);
 			}
 		}
+	});
+}
+
+void FilterProcess_CP_Wrapper::process_span(float *pixels, int count, task_t *task, const std::vector<fp_cp_task_t *> &filter_tasks) {
+	const int filters_count = fp_cp_vector.size();
+	if(task->lut == nullptr) {
+		for(int fi = 0; fi < filters_count; ++fi)
+			fp_cp_vector[fi].fp_cp->filter_span(pixels, count, filter_tasks[fi]);
+		return;
+	}
+	// pixels out of LUT range are processed with filters
+	int i = 0;
+	while(i < count) {
+		const int run_start = i;
+		const bool in_range = FP_CP_LUT_t::in_range(&pixels[i * 4]);
+		while(i < count && FP_CP_LUT_t::in_range(&pixels[i * 4]) == in_range)
+			++i;
+		if(in_range) {
+			for(int k = run_start; k < i; ++k)
+				task->lut->apply(&pixels[k * 4]);
+		} else {
+			for(int fi = 0; fi < filters_count; ++fi)
+				fp_cp_vector[fi].fp_cp->filter_span(&pixels[run_start * 4], i - run_start, filter_tasks[fi]);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+FP_CP_LUT_t::FP_CP_LUT_t(int _size) : size(_size) {
+	table.resize(size * size * size * 3);
+}
+
+void FP_CP_LUT_t::apply(float *pixel) const {
+	// position of pixel at grid of nodes
+	float f[3];
+	int n[3];
+	for(int c = 0; c < 3; ++c) {
+		const float v = std::sqrt(pixel[c]) * (size - 1);
+		n[c] = (v < size - 1) ? int(v) : size - 2;
+		f[c] = v - n[c];
+	}
+	const int s_r = size * size * 3;
+	const int s_g = size * 3;
+	const int s_b = 3;
+	const float *c000 = &table[n[0] * s_r + n[1] * s_g + n[2] * s_b];
+	const float *c111 = c000 + s_r + s_g + s_b;
+	const float fr = f[0];
+	const float fg = f[1];
+	const float fb = f[2];
+	// tetrahedron with the pixel: the walk from c000 to c111 along axes, in order of fractions
+	const float *p1;
+	const float *p2;
+	float w1, w2, w3;
+	if(fr >= fg) {
+		if(fg >= fb) {			// r, g, b
+			p1 = c000 + s_r;		p2 = p1 + s_g;		w1 = fr;	w2 = fg;	w3 = fb;
+		} else if(fr >= fb) {	// r, b, g
+			p1 = c000 + s_r;		p2 = p1 + s_b;		w1 = fr;	w2 = fb;	w3 = fg;
+		} else {				// b, r, g
+			p1 = c000 + s_b;		p2 = p1 + s_r;		w1 = fb;	w2 = fr;	w3 = fg;
+		}
+	} else {
+		if(fb >= fg) {			// b, g, r
+			p1 = c000 + s_b;		p2 = p1 + s_g;		w1 = fb;	w2 = fg;	w3 = fr;
+		} else if(fb >= fr) {	// g, b, r
+			p1 = c000 + s_g;		p2 = p1 + s_b;		w1 = fg;	w2 = fb;	w3 = fr;
+		} else {				// g, r, b
+			p1 = c000 + s_g;		p2 = p1 + s_r;		w1 = fg;	w2 = fr;	w3 = fb;
+		}
 	}
+	for(int c = 0; c < 3; ++c)
+		pixel[c] = c000[c] + w1 * (p1[c] - c000[c]) + w2 * (p2[c] - p1[c]) + w3 * (c111[c] - p2[c]);
 }
 
 //------------------------------------------------------------------------------
@@ -10,11 +10,18 @@
  */
 
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <iostream>
 
 #include "filter.h"
 
+#if defined(__SSE2__)
+	#define FILTER_CP_SSE2
+	#include <emmintrin.h>
+#endif
+
 //------------------------------------------------------------------------------
 // cp == color process 'per pixel'
 // per-pixel color filter initialization and processing
@@ -51,11 +58,44 @@ public:
 	//	pixel - float[4] - in and out pixel, rewritable
 	//	fp_cp_task_t *task - per-subflow data and cache
 	virtual void filter(float *pixel, fp_cp_task_t *task) {};
+	// do filtering of 'count' pixels in a row - float[4 * count]; all of them are with alpha > 0.0
+	// by default call filter() for each pixel
+	virtual void filter_span(float *pixels, int count, fp_cp_task_t *task);
 	// reconstruct histogram, clear cache and delete private task_t objects; called only with master subflow
 	virtual void filter_post(class fp_cp_args_t *args);
+
+	// Chain of filters from RGB to RGB could be baked into 3D LUT for preview, when each filter allows that:
+	// result depends only on the input pixel, w/o side effects like histograms.
+	virtual bool lut_rgb_input(void) {return false;}
+	virtual bool lut_rgb_output(void) {return false;}
+	virtual bool lut_allowed(fp_cp_task_t *task) {return false;}
 protected:
 };
 
+// 3D LUT with RGB for each node, R is the slowest index. Nodes are at squares of uniform grid,
+// for more precision at shadows of linear input.
+class FP_CP_LUT_t {
+public:
+	FP_CP_LUT_t(int size);
+	static float node_value(int index, int size) {const float v = float(index) / (size - 1); return v * v;}
+	static bool in_range(const float *pixel) {
+		return (pixel[0] >= 0.0f && pixel[0] <= 1.0f && pixel[1] >= 0.0f && pixel[1] <= 1.0f && pixel[2] >= 0.0f && pixel[2] <= 1.0f);
+	}
+	// tetrahedral interpolation; pixel should be in range
+	void apply(float *pixel) const;
+
+	const int size;
+	std::vector<float> table;
+};
+
+// Baked LUT kept with photo between processing requests, until settings are changed.
+class FP_CP_LUT_Cache_t {
+public:
+	std::mutex lock;
+	std::string key;
+	std::shared_ptr<const FP_CP_LUT_t> lut;
+};
+
 // 'frame' call FP_P3's chain to process each pixel, incapsulate 2D matrix iteration
 class FP_CP_Wrapper_record_t {
 public:
@@ -73,12 +113,17 @@ public:
 	std::unique_ptr<Area> process(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj);
 	bool is_enabled(const PS_Base *ps_base);
 	void set_destructive(bool);
+	// use 3D LUT instead of filters for preview, if possible
+	void set_lut_cache(class FP_CP_LUT_Cache_t *lut_cache);
 
 protected:
 	class task_t;
 	std::vector<class FP_CP_Wrapper_record_t> fp_cp_vector;
 	void process(class SubFlow *subflow);
+	void process_span(float *pixels, int count, task_t *task, const std::vector<fp_cp_task_t *> &filter_tasks);
+	std::shared_ptr<const FP_CP_LUT_t> lut_bake(const std::vector<std::unique_ptr<fp_cp_args_t>> &args);
 	bool allow_destructive;
+	class FP_CP_LUT_Cache_t *lut_cache;
 };
 
 //------------------------------------------------------------------------------
@@ -15,17 +15,28 @@
  *		drop with no visible image improvement but barely visible sharpness increase (and artifacts too).
  */	
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
+#include "area_helper.h"
 #include "filter_gp.h"
 #include "process_h.h"
 #include "ddr_math.h"
+#include "memory.h"
+#include "system.h"
 
 using namespace std;
 
 //#define MARK_CORNERS
 #undef MARK_CORNERS
 
+// the biggest allowed error of coordinates interpolated at grid, in input pixels
+#define GP_GRID_TOLERANCE 0.02f
+// limit of memory used by cached coordinates, in bytes; and, with the memory budget, part of it
+#define GP_COORDINATES_CACHE_SIZE (128 * 1024 * 1024)
+#define GP_COORDINATES_CACHE_BUDGET_PART 8
+
 //------------------------------------------------------------------------------
 bool FP_GP::is_rgb(void) {
 	return false;
@@ -55,6 +66,23 @@ void FP_GP::process_backward_rgb(float *in, const float *out) {
 		process_backward(in[i * 2 + 0], in[i * 2 + 1], out[i * 2 + 0], out[i * 2 + 1]);
 }
 
+void FP_GP::process_backward_n(float *xy, int count) {
+	for(int i = 0; i < count; ++i) {
+		const float x = xy[i * 2 + 0];
+		const float y = xy[i * 2 + 1];
+		process_backward(xy[i * 2 + 0], xy[i * 2 + 1], x, y);
+	}
+}
+
+void FP_GP::process_backward_rgb_n(float *xy, int count) {
+	for(int i = 0; i < count; ++i) {
+		float out[6];
+		for(int k = 0; k < 6; ++k)
+			out[k] = xy[i * 6 + k];
+		process_backward_rgb(&xy[i * 6], out);
+	}
+}
+
 //------------------------------------------------------------------------------
 FilterProcess_GP::FilterProcess_GP(void) {
 	_name = "Unknown FilterProcess_GP";
@@ -69,8 +97,52 @@ class FP_GP *FilterProcess_GP::get_new_FP_GP(const class FP_GP_data_t &data) {
 	return nullptr;
 }
 
+//------------------------------------------------------------------------------
+std::shared_ptr<Area> FP_GP_Coordinates_Cache_t::get(const std::string &key) {
+	std::lock_guard<std::mutex> locker(lock);
+	for(auto it = entries.begin(); it != entries.end(); ++it) {
+		if((*it).first == key) {
+			entries.splice(entries.begin(), entries, it);
+			return entries.front().second;
+		}
+	}
+	return std::shared_ptr<Area>();
+}
+
+// Cached coordinates are kept between requests out of their memory reservations, so the cache is
+// limited with a part of the memory budget, to leave the rest of it for processing.
+size_t FP_GP_Coordinates_Cache_t::size_limit(void) {
+	const size_t budget = MemBudget::instance()->limit();
+	if(budget == 0)
+		return GP_COORDINATES_CACHE_SIZE;
+	return std::min(size_t(GP_COORDINATES_CACHE_SIZE), budget / GP_COORDINATES_CACHE_BUDGET_PART);
+}
+
+void FP_GP_Coordinates_Cache_t::put(const std::string &key, std::shared_ptr<Area> area) {
+	const size_t area_size = size_t(area->mem_width()) * area->mem_height() * area->type_to_sizeof();
+	const size_t limit = size_limit();
+	if(area_size > limit)
+		return;
+	std::lock_guard<std::mutex> locker(lock);
+	for(auto it = entries.begin(); it != entries.end(); ++it) {
+		if((*it).first == key) {
+			mem_size -= size_t((*it).second->mem_width()) * (*it).second->mem_height() * (*it).second->type_to_sizeof();
+			entries.erase(it);
+			break;
+		}
+	}
+	while(entries.size() > 0 && mem_size + area_size > limit) {
+		Area *a = entries.back().second.get();
+		mem_size -= size_t(a->mem_width()) * a->mem_height() * a->type_to_sizeof();
+		entries.pop_back();
+	}
+	entries.push_front(std::pair<std::string, std::shared_ptr<Area>>(key, area));
+	mem_size += area_size;
+}
+
 //------------------------------------------------------------------------------
 FilterProcess_GP_Wrapper::FilterProcess_GP_Wrapper(const vector<class FP_GP_Wrapper_record_t> &_vector) {
+	coordinates_cache = nullptr;
 	fp_gp_vector = _vector;
 	if(fp_gp_vector.size() == 0) {
 		_name = "FP_GP_Wrapper for resampling";
@@ -95,7 +167,12 @@ bool FilterProcess_GP_Wrapper::is_enabled(const PS_Base *) {
 	return true;
 }
 
+void FilterProcess_GP_Wrapper::set_coordinates_cache(FP_GP_Coordinates_Cache_t *_coordinates_cache) {
+	coordinates_cache = _coordinates_cache;
+}
+
 void FilterProcess_GP_Wrapper::init_gp(class Metadata *metadata) {
+	std::lock_guard<std::mutex> locker(gp_lock);
 	if(gp_vector.size() == 0) {
 		for(size_t i = 0; i < fp_gp_vector.size(); ++i) {
 			FP_GP_data_t data;
@@ -105,6 +182,10 @@ void FilterProcess_GP_Wrapper::init_gp(class Metadata *metadata) {
 			data.ps_base = fp_gp_vector[i].ps_base.get();
 			data.cache = fp_gp_vector[i].cache;
 			gp_vector.push_back(fp_gp_vector[i].fp_gp->get_new_FP_GP(data));
+			// coordinates depend only on settings of filters, metadata is the same for the whole photo
+			DataSet dataset;
+			fp_gp_vector[i].ps_base->save(&dataset);
+			coordinates_key += fp_gp_vector[i].fp_gp->name() + "\n" + dataset.serialize();
 		}
 	}
 }
@@ -567,52 +648,52 @@ void FilterProcess_GP_Wrapper::process_copy(SubFlow *subflow) {
 	float *mark_lt_pixel = &color_pixel[4];
 	float *mark_rb_pixel = &color_pixel[8];
 #endif
-	int it_y;
-	auto y_flow = task->y_flow;
-	while((it_y = y_flow->fetch_add(1)) < out_y_max) {
-		for(int it_x = 0; it_x < out_x_max; ++it_x) {
-			float *const out = &_out[(it_y * out_width + it_x) << 2];
-			const int in_x = in_x_offset + it_x;
-			const int in_y = in_y_offset + it_y;
-			if(in_x < in_x_min || in_x >= in_x_max || in_y < in_y_min || in_y >= in_y_max) {
-				out[0] = empty_pixel[0];
-				out[1] = empty_pixel[1];
-				out[2] = empty_pixel[2];
-				out[3] = empty_pixel[3];
-			} else  {
-				float *const in = &_in[(in_y * in_width + in_x) << 2];
-//				float *in = &_in[((in_y_offset + it_y) * in_width + in_x_offset + it_x) * 4 + 0];
-				out[0] = in[0] * task->wb_a[0] + task->wb_b[0];
-				out[1] = in[1] * task->wb_a[1] + task->wb_b[1];
-				out[2] = in[2] * task->wb_a[2] + task->wb_b[2];
-//				out[3] = 1.0f;
-				out[3] = in[3];
-			}
+	subflow->for_rows(task->y_flow, out_y_max, [&](int y_begin, int y_end) {
+		for(int it_y = y_begin; it_y < y_end; ++it_y) {
+			for(int it_x = 0; it_x < out_x_max; ++it_x) {
+				float *const out = &_out[(it_y * out_width + it_x) << 2];
+				const int in_x = in_x_offset + it_x;
+				const int in_y = in_y_offset + it_y;
+				if(in_x < in_x_min || in_x >= in_x_max || in_y < in_y_min || in_y >= in_y_max) {
+					out[0] = empty_pixel[0];
+					out[1] = empty_pixel[1];
+					out[2] = empty_pixel[2];
+					out[3] = empty_pixel[3];
+				} else  {
+					float *const in = &_in[(in_y * in_width + in_x) << 2];
+//					float *in = &_in[((in_y_offset + it_y) * in_width + in_x_offset + it_x) * 4 + 0];
+					out[0] = in[0] * task->wb_a[0] + task->wb_b[0];
+					out[1] = in[1] * task->wb_a[1] + task->wb_b[1];
+					out[2] = in[2] * task->wb_a[2] + task->wb_b[2];
+//					out[3] = 1.0f;
+					out[3] = in[3];
+				}
 #ifdef MARK_CORNERS
-			// mark corners
-			const int mark_near = 2;
-			const int mark_far = 31;//15;
-			bool flag_mark_lt = false;
-			bool flag_mark_rb = false;
-			const int mx = out_x_max - 1;
-			const int my = out_y_max - 1;
-			if((it_y == 0 && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == 0))
-				flag_mark_lt = true;
-			if((it_y == 0 && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == 0))
-				flag_mark_lt = true;
-			if((it_y == my && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == mx))
-				flag_mark_rb = true;
-			if((it_y == my && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == mx))
-				flag_mark_rb = true;
-			if(flag_mark_lt)
-				for(int i = 0; i < 4; ++i)
-					out[i] = mark_lt_pixel[i];
-			if(flag_mark_rb)
-				for(int i = 0; i < 4; ++i)
-					out[i] = mark_rb_pixel[i];
+				// mark corners
+				const int mark_near = 2;
+				const int mark_far = 31;//15;
+				bool flag_mark_lt = false;
+				bool flag_mark_rb = false;
+				const int mx = out_x_max - 1;
+				const int my = out_y_max - 1;
+				if((it_y == 0 && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == 0))
+					flag_mark_lt = true;
+				if((it_y == 0 && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == 0))
+					flag_mark_lt = true;
+				if((it_y == my && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == mx))
+					flag_mark_rb = true;
+				if((it_y == my && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == mx))
+					flag_mark_rb = true;
+				if(flag_mark_lt)
+					for(int i = 0; i < 4; ++i)
+						out[i] = mark_lt_pixel[i];
+				if(flag_mark_rb)
+					for(int i = 0; i < 4; ++i)
+						out[i] = mark_rb_pixel[i];
 #endif
+			}
 		}
-	}
+	});
 }
 
 //==============================================================================
@@ -625,6 +706,8 @@ public:
 	float start_y;
 	float delta_x;
 	float delta_y;
+	bool coordinates_cached; // coordinates are taken from cache, skip tracing
+	bool separable; // resampling only, with weights for columns and rows instead of coordinates
 };
 
 class FilterProcess_GP_Wrapper::task_coordinates_t {
@@ -633,6 +716,12 @@ public:
 	Area *area_out;	// (write only) area with changed coordinates, nearer to demosaic
 	bool coordinates_rgb;
 	std::atomic_int *y_flow;
+
+	// coordinates at nodes of sparse grid, with interpolation between, if 'grid_step' > 0
+	int grid_step;
+	float grid_tolerance;
+	std::vector<float> *grid;
+	std::atomic_int *y_flow_grid;
 };
 
 class FilterProcess_GP_Wrapper::task_sampling_t {
@@ -647,30 +736,121 @@ public:
 	float px_size_y;
 	float offset_x;
 	float offset_y;
+
+	// separable resampling, or 'nullptr'; alpha of pixel is 'alpha_x[x] * alpha_y[y]'
+	const AreaHelper::resample_table_t *table_x;
+	const AreaHelper::resample_table_t *table_y;
+	const std::vector<float> *alpha_x;
+	const std::vector<float> *alpha_y;
 };
 
+// Weights for one axis of resampling w/o filters, the same as at 'process_sampling()', where coordinates are
+// 'start + delta * i' and window is [(c[i - 1] + c[i]) / 2, (c[i] + c[i + 1]) / 2]. Weights are normalized
+// by the sum of weights inside of input area, and 'alpha' is the part of window inside of input area.
+static void sampling_table(AreaHelper::resample_table_t *table, std::vector<float> &alpha, float start, float delta, int out_size,
+		float offset, float px_size, int in_offset, int in_1, int in_2, bool is_y) {
+	// accumulate coordinates as at 'prepare_coordinates()', with the first and the last for window
+	std::vector<float> c(out_size + 2);
+	float value = start;
+	for(int i = 0; i < out_size + 2; ++i) {
+		c[i] = value;
+		value += delta;
+	}
+	alpha.resize(out_size);
+	std::vector<float> w;
+	for(int i = 0; i < out_size; ++i) {
+		const float p1 = (c[i] + c[i + 1]) * 0.5f;
+		const float p2 = (c[i + 1] + c[i + 2]) * 0.5f;
+		const float f1 = (p1 - offset) / px_size;
+		const float f2 = (p2 - offset) / px_size;
+		float l = f2 - f1;
+		int i_floor = int(f1);
+		if(float(i_floor) > f1)
+			--i_floor;
+		const float w_first = 1.0f - (f1 - float(i_floor));
+		if(l < 1.0f)
+			l = 1.0f;
+		// start of window in Y is truncated, not floored
+		int i1 = is_y ? int(f1) : i_floor;
+		int i2 = int(f1 + l);
+		if(!is_y && float(i2) > f1 + l)
+			--i2;
+		i1 += in_offset;
+		i2 += in_offset;
+		alpha[i] = 0.0f;
+		w.clear();
+		int first = in_1;
+		if(!(i2 < in_1 || i1 >= in_2)) {
+			float w_sum = 0.0f;
+			float w_sum_alpha = 0.0f;
+			float w_i = (w_first < 0.0f) ? -w_first : w_first;
+			float l_i = l;
+			for(int k = i1; k <= i2; ++k) {
+				if(k >= in_1 && k < in_2) {
+					if(w.size() == 0)
+						first = k;
+					w.push_back(w_i);
+					w_sum += w_i;
+				}
+				w_sum_alpha += w_i;
+				l_i -= w_i;
+				w_i = (l_i > 1.0f) ? 1.0f : l_i;
+			}
+			if(w_sum > 0.0f) {
+				for(size_t k = 0; k < w.size(); ++k)
+					w[k] /= w_sum;
+				alpha[i] = w_sum / w_sum_alpha;
+			} else {
+				w.clear();
+			}
+		}
+		table->push(first, w.data(), w.size());
+	}
+}
+
+// Key of coordinates of tile: settings of filters, position and scale of tile, and options of tracing.
+std::string FilterProcess_GP_Wrapper::coordinates_tile_key(const Process_t *process_obj, const Area *area_in, int grid_step) {
+	std::string key = coordinates_key;
+	auto append = [&key](const void *ptr, size_t size) {key.append((const char *)ptr, size);};
+	const Tile_t::t_position &tp = process_obj->position;
+	append(&tp.x, sizeof(tp.x));
+	append(&tp.y, sizeof(tp.y));
+	append(&tp.width, sizeof(tp.width));
+	append(&tp.height, sizeof(tp.height));
+	append(&tp.px_size_x, sizeof(tp.px_size_x));
+	append(&tp.px_size_y, sizeof(tp.px_size_y));
+	// tolerance of grid depends on input scale
+	append(&area_in->dimensions()->position.px_size_x, sizeof(area_in->dimensions()->position.px_size_x));
+	append(&area_in->dimensions()->position.px_size_y, sizeof(area_in->dimensions()->position.px_size_y));
+	append(&grid_step, sizeof(grid_step));
+	return key;
+}
+
 std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj) {
 	SubFlow *subflow = mt_obj->subflow;
 	Area *area_in = process_obj->area_in;
-	if(gp_vector.size() == 0) {
-		if(subflow->sync_point_pre()) {
-			init_gp(process_obj->metadata);
-		}
-		subflow->sync_point_post();
-	}
+	// by each thread w/o barrier, as other tiles can do the same at the same time
+	init_gp(process_obj->metadata);
 
 	std::unique_ptr<Area> area_coordinates_prep;
 	std::vector<std::unique_ptr<task_coordinates_prep_t>> tasks_coordinates_prep(0);
 	std::unique_ptr<std::atomic_int> y_flow_coordinates_prep;
 
-	std::unique_ptr<Area> area_out_coordinates;
+	std::shared_ptr<Area> area_out_coordinates;
+	std::string coordinates_tile_key_str;
 	std::vector<std::unique_ptr<task_coordinates_t>> tasks_coordinates(0);
 	std::unique_ptr<std::atomic_int> y_flow_coordinates;
+	std::unique_ptr<std::atomic_int> y_flow_coordinates_grid;
+	std::vector<float> coordinates_grid;
 	bool coordinates_rgb = false;
 
 	std::unique_ptr<Area> area_out_sampling;
 	std::vector<std::unique_ptr<task_sampling_t>> tasks_sampling(0);
 	std::unique_ptr<std::atomic_int> y_flow_sampling;
+	std::unique_ptr<AreaHelper::resample_table_t> table_x;
+	std::unique_ptr<AreaHelper::resample_table_t> table_y;
+	std::vector<float> alpha_x;
+	std::vector<float> alpha_y;
 
 	float px_size_in_x = 1.0;
 	float px_size_in_y = 1.0;
@@ -687,6 +867,17 @@ std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, P
 	const int threads_count = subflow->threads_count();
 	// prepare coordinates
 	if(subflow->sync_point_pre()) {
+		// reuse traced coordinates of the same tile, if settings of filters are the same
+		bool coordinates_cached = false;
+		if(!resampling_only && coordinates_cache != nullptr && !filter_obj->is_offline) {
+			coordinates_tile_key_str = coordinates_tile_key(process_obj, area_in, System::instance()->gp_grid_step());
+			area_out_coordinates = coordinates_cache->get(coordinates_tile_key_str);
+			if(area_out_coordinates) {
+				coordinates_cached = true;
+				for(size_t i = 0; i < gp_vector.size(); ++i)
+					coordinates_rgb |= gp_vector[i]->is_rgb();
+			}
+		}
 		Area::t_dimensions d_out = *area_in->dimensions();
 		Tile_t::t_position &tp = process_obj->position;
 		// add 1px. strip for each edge on purpose - to simplify recalculations at rescaling stage
@@ -700,13 +891,35 @@ std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, P
 		d_out.position.px_size_y = px_size_out_y;
 		d_out.edges.reset();
 
-		area_coordinates_prep = std::unique_ptr<Area>(new Area(&d_out, Area::type_t::float_p2));
-
 		float start_x = d_out.position.x;
 		float start_y = d_out.position.y;
 		float delta_x = px_size_out_x;
 		float delta_y = px_size_out_y;
 
+		// w/o filters window of each pixel is the product of windows for column and row
+		const bool separable = resampling_only;
+		if(separable) {
+			const float offset_x = area_in->dimensions()->position.x - 0.5 * px_size_in_x;
+			const float offset_y = area_in->dimensions()->position.y - 0.5 * px_size_in_y;
+			const int in_x1 = area_in->dimensions()->edges.x1;
+			const int in_y1 = area_in->dimensions()->edges.y1;
+			const int in_x2 = area_in->dimensions()->width() + in_x1;
+			const int in_y2 = area_in->dimensions()->height() + in_y1;
+			table_x = std::unique_ptr<AreaHelper::resample_table_t>(new AreaHelper::resample_table_t);
+			table_y = std::unique_ptr<AreaHelper::resample_table_t>(new AreaHelper::resample_table_t);
+			sampling_table(table_x.get(), alpha_x, start_x, delta_x, tp.width, offset_x, px_size_in_x, in_x1, in_x1, in_x2, false);
+			sampling_table(table_y.get(), alpha_y, start_y, delta_y, tp.height, offset_y, px_size_in_y, in_y1, in_y1, in_y2, true);
+			if(System::instance()->resample_lanczos()) {
+				// the same alpha; output pixel 'i' is centered at 'start + delta * (i + 1)', input pixel 'n' at 'offset + px_size * (n + 0.5)'
+				table_x.reset(new AreaHelper::resample_table_t);
+				table_y.reset(new AreaHelper::resample_table_t);
+				AreaHelper::resample_table_lanczos3(table_x.get(), (start_x + delta_x - offset_x) / px_size_in_x - 0.5, delta_x / px_size_in_x, in_x1, in_x2 - in_x1, tp.width);
+				AreaHelper::resample_table_lanczos3(table_y.get(), (start_y + delta_y - offset_y) / px_size_in_y - 0.5, delta_y / px_size_in_y, in_y1, in_y2 - in_y1, tp.height);
+			}
+		}
+		if(!coordinates_cached && !separable)
+			area_coordinates_prep = std::unique_ptr<Area>(new Area(&d_out, Area::type_t::float_p2));
+
 		y_flow_coordinates_prep = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
 		tasks_coordinates_prep.resize(threads_count);
 		for(int i = 0; i < threads_count; ++i) {
@@ -719,16 +932,21 @@ std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, P
 			task->start_y = start_y;
 			task->delta_x = delta_x;
 			task->delta_y = delta_y;
+			task->coordinates_cached = coordinates_cached;
+			task->separable = separable;
 
 			subflow->set_private(task, i);
 		}
 	}
 	subflow->sync_point_post();
 
-	prepare_coordinates(subflow);
+	const bool coordinates_cached = ((task_coordinates_prep_t *)subflow->get_private())->coordinates_cached;
+	const bool separable = ((task_coordinates_prep_t *)subflow->get_private())->separable;
+	if(!coordinates_cached && !separable)
+		prepare_coordinates(subflow);
 
 	// process coordinates
-	if(!resampling_only) {
+	if(!resampling_only && !coordinates_cached) {
 		if(subflow->sync_point_pre()) {
 			Area::t_dimensions d_out = *area_in->dimensions();
 			Tile_t::t_position &tp = process_obj->position;
@@ -745,7 +963,19 @@ std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, P
 			for(size_t i = 0; i < gp_vector.size(); ++i)
 				coordinates_rgb |= gp_vector[i]->is_rgb();
 			Area::type_t area_type = coordinates_rgb ? Area::type_t::float_p6 : Area::type_t::float_p2;
-			area_out_coordinates = std::unique_ptr<Area>(new Area(&d_out, area_type));
+			area_out_coordinates = std::shared_ptr<Area>(new Area(&d_out, area_type));
+
+			// mapping is smooth, so use grid if tile is big enough
+			int grid_step = System::instance()->gp_grid_step();
+			if(d_out.width() <= grid_step * 2 || d_out.height() <= grid_step * 2)
+				grid_step = 0;
+			if(grid_step > 0) {
+				const int nodes_x = (d_out.width() + grid_step - 2) / grid_step + 1;
+				const int nodes_y = (d_out.height() + grid_step - 2) / grid_step + 1;
+				coordinates_grid.resize(nodes_x * nodes_y * (coordinates_rgb ? 6 : 2));
+				y_flow_coordinates_grid = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
+			}
+			const float grid_tolerance = GP_GRID_TOLERANCE * ((px_size_in_x < px_size_in_y) ? px_size_in_x : px_size_in_y);
 
 			y_flow_coordinates = std::unique_ptr<std::atomic_int>(new std::atomic_int(0));
 			tasks_coordinates.resize(threads_count);
@@ -757,6 +987,10 @@ std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, P
 				task->area_out = area_out_coordinates.get();
 				task->coordinates_rgb = coordinates_rgb;
 				task->y_flow = y_flow_coordinates.get();
+				task->grid_step = grid_step;
+				task->grid_tolerance = grid_tolerance;
+				task->grid = &coordinates_grid;
+				task->y_flow_grid = y_flow_coordinates_grid.get();
 
 				subflow->set_private(task, i);
 			}
@@ -767,6 +1001,9 @@ std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, P
 
 	// do supersampling
 	if(subflow->sync_point_pre()) {
+		// all threads are done with coordinates here
+		if(!coordinates_cached && coordinates_tile_key_str.size() != 0)
+			coordinates_cache->put(coordinates_tile_key_str, area_out_coordinates);
 		Area::t_dimensions d_out = *area_in->dimensions();
 		Tile_t::t_position &tp = process_obj->position;
 		d_out.position.x = tp.x;
@@ -805,13 +1042,20 @@ std::unique_ptr<Area> FilterProcess_GP_Wrapper::process_sampling(MT_t *mt_obj, P
 			task->px_size_y = px_size_y;
 			task->offset_x = offset_x;
 			task->offset_y = offset_y;
+			task->table_x = table_x.get();
+			task->table_y = table_y.get();
+			task->alpha_x = &alpha_x;
+			task->alpha_y = &alpha_y;
 
 			subflow->set_private(task, i);
 		}
 	}
 	subflow->sync_point_post();
 
-	process_sampling(subflow);
+	if(separable)
+		process_sampling_separable(subflow, (task_sampling_t *)subflow->get_private());
+	else
+		process_sampling(subflow);
 	subflow->sync_point();
 
 	return area_out_sampling;
@@ -835,97 +1079,159 @@ void FilterProcess_GP_Wrapper::prepare_coordinates(SubFlow *subflow) {
 	const float start_y = task->start_y;
 	const float delta_x = task->delta_x;
 	const float delta_y = task->delta_y;
-	int it_y;
-	int it_y_prev = 0;
-	float value_y = start_y;
-	auto y_flow = task->y_flow;
-	while((it_y = y_flow->fetch_add(1)) < out_y_max) {
-		value_y += delta_y * (it_y - it_y_prev);
-		it_y_prev = it_y;
-		float value_x = start_x;
-		for(int it_x = 0; it_x < out_x_max; ++it_x) {
-			float *rez = &_out[(it_y * out_width + it_x) * 2];
-			rez[0] = value_x;
-			rez[1] = value_y;
-			value_x += delta_x;
-//			rez[0] = start_x + delta_x * it_x;
-//			rez[1] = start_y + delta_y * it_y;
+	subflow->for_rows(task->y_flow, out_y_max, [&](int y_begin, int y_end) {
+		float value_y = start_y + delta_y * y_begin;
+		for(int it_y = y_begin; it_y < y_end; ++it_y) {
+			float value_x = start_x;
+			for(int it_x = 0; it_x < out_x_max; ++it_x) {
+				float *rez = &_out[(it_y * out_width + it_x) * 2];
+				rez[0] = value_x;
+				rez[1] = value_y;
+				value_x += delta_x;
+//				rez[0] = start_x + delta_x * it_x;
+//				rez[1] = start_y + delta_y * it_y;
 /*
 if(it_y == 3 && it_x < 5)
 cerr << "x == " << rez[0] << endl;
 */
+			}
+			value_y += delta_y;
 		}
+	});
+}
+
+void FilterProcess_GP_Wrapper::coordinates_backward_n(float *rez, const float *in, int count, bool coordinates_rgb) {
+	for(int i = 0; i < count * 2; ++i)
+		rez[i] = in[i];
+	const int j_max = gp_vector.size() - 1;
+	int j = j_max;
+	if(coordinates_rgb) {
+		// all colors share coordinates till the first 'rgb' filter
+		for(; j >= 0 && !gp_vector[j]->is_rgb(); --j)
+			gp_vector[j]->process_backward_n(rez, count);
+		// expand (x, y) to rgb_c[6] in place, from the end
+		for(int i = count - 1; i >= 0; --i) {
+			const float x = rez[i * 2 + 0];
+			const float y = rez[i * 2 + 1];
+			for(int k = 0; k < 3; ++k) {
+				rez[i * 6 + k * 2 + 0] = x;
+				rez[i * 6 + k * 2 + 1] = y;
+			}
+		}
+		for(; j >= 0; --j)
+			gp_vector[j]->process_backward_rgb_n(rez, count);
+	} else {
+		for(; j >= 0; --j)
+			gp_vector[j]->process_backward_n(rez, count);
 	}
 }
 
 void FilterProcess_GP_Wrapper::process_coordinates(SubFlow *subflow) {
 	task_coordinates_t *task = (task_coordinates_t *)subflow->get_private();
+	if(task->grid_step > 0) {
+		process_coordinates_grid(subflow);
+		return;
+	}
 	// size of area_in and area_out should be the same in here
 	Area *area_in = task->area_in;
 	Area *area_out = task->area_out;
 
 	const int out_width = area_out->dimensions()->width();
-//	int out_height = area_out->dimensions()->height();
 	const int out_x_max = area_out->dimensions()->width();
 	const int out_y_max = area_out->dimensions()->height();
 
-//	int _w = area_in->mem_width();
-//cerr << "_w = " << _w << endl;
 	float *_in = (float *)area_in->ptr();
 	float *_out = (float *)area_out->ptr();
 
-	int it_y;
-	const int j_max = gp_vector.size() - 1;
-	if(task->coordinates_rgb) {
-		auto y_flow = task->y_flow;
-		while((it_y = y_flow->fetch_add(1)) < out_y_max) {
-			for(int it_x = 0; it_x < out_x_max; ++it_x) {
-				float in[6];
-				float out[6];
-				out[0] = _in[(it_y * out_width + it_x) * 2 + 0];
-				out[1] = _in[(it_y * out_width + it_x) * 2 + 1];
-				bool c_rgb = false;
-				for(int j = j_max; j >= 0; j--) {
-					bool c_rgb_prev = c_rgb;
-					c_rgb |= gp_vector[j]->is_rgb();
-					if(c_rgb) {
-						if(!c_rgb_prev) {
-							out[2] = out[0];
-							out[3] = out[1];
-							out[4] = out[0];
-							out[5] = out[1];
-						}
-						gp_vector[j]->process_backward_rgb(in, out);
-						for(int i = 0; i < 6; ++i)
-							out[i] = in[i];
-					} else {
-						gp_vector[j]->process_backward(in[0], in[1], out[0], out[1]);
-						out[0] = in[0];
-						out[1] = in[1];
-					}
-				}
-				for(int i = 0; i < 6; ++i)
-					_out[(it_y * out_width + it_x) * 6 + i] = in[i];
+	const bool coordinates_rgb = task->coordinates_rgb;
+	const int rgb_size = coordinates_rgb ? 6 : 2;
+	subflow->for_rows(task->y_flow, out_y_max, [&](int y_begin, int y_end) {
+		for(int it_y = y_begin; it_y < y_end; ++it_y)
+			coordinates_backward_n(&_out[it_y * out_width * rgb_size], &_in[it_y * out_width * 2], out_x_max, coordinates_rgb);
+	});
+}
+
+// Process coordinates at nodes of grid with 'grid_step', and bilinear interpolation of them for pixels of each cell.
+// Interpolation is checked at the middle of each cell, and cells with too big error are processed for each pixel.
+void FilterProcess_GP_Wrapper::process_coordinates_grid(SubFlow *subflow) {
+	task_coordinates_t *task = (task_coordinates_t *)subflow->get_private();
+	Area *area_in = task->area_in;
+	Area *area_out = task->area_out;
+
+	const int width = area_out->dimensions()->width();
+	const int height = area_out->dimensions()->height();
+	const int step = task->grid_step;
+	const int nodes_x = (width + step - 2) / step + 1;
+	const int nodes_y = (height + step - 2) / step + 1;
+	auto node_x = [&](int i) {return (i * step < width - 1) ? i * step : width - 1;};
+	auto node_y = [&](int j) {return (j * step < height - 1) ? j * step : height - 1;};
+
+	float *_in = (float *)area_in->ptr();
+	float *_out = (float *)area_out->ptr();
+	float *grid = task->grid->data();
+
+	const bool coordinates_rgb = task->coordinates_rgb;
+	const int rgb_size = coordinates_rgb ? 6 : 2;
+	// nodes
+	subflow->for_rows(task->y_flow, nodes_y, [&](int j_begin, int j_end) {
+		std::vector<float> nodes_in(nodes_x * 2);
+		for(int j = j_begin; j < j_end; ++j) {
+			const int y = node_y(j);
+			for(int i = 0; i < nodes_x; ++i) {
+				nodes_in[i * 2 + 0] = _in[(y * width + node_x(i)) * 2 + 0];
+				nodes_in[i * 2 + 1] = _in[(y * width + node_x(i)) * 2 + 1];
 			}
+			coordinates_backward_n(&grid[j * nodes_x * rgb_size], nodes_in.data(), nodes_x, coordinates_rgb);
 		}
-	} else {
-		auto y_flow = task->y_flow;
-		while((it_y = y_flow->fetch_add(1)) < out_y_max) {
-			for(int it_x = 0; it_x < out_x_max; ++it_x) {
-				float in[2];
-				float out[2];
-				out[0] = _in[(it_y * out_width + it_x) * 2 + 0];
-				out[1] = _in[(it_y * out_width + it_x) * 2 + 1];
-				for(int j = j_max; j >= 0; j--) {
-					gp_vector[j]->process_backward(in[0], in[1], out[0], out[1]);
-					out[0] = in[0];
-					out[1] = in[1];
+	});
+	subflow->sync_point();
+
+	// cells
+	const float tolerance = task->grid_tolerance;
+	subflow->for_rows(task->y_flow_grid, nodes_y - 1, [&](int j_begin, int j_end) {
+		for(int j = j_begin; j < j_end; ++j) {
+			const int y0 = node_y(j);
+			const int y1 = node_y(j + 1);
+			// the last row and column of cells include the edge of area
+			const int y_end = (j == nodes_y - 2) ? y1 + 1 : y1;
+			for(int i = 0; i < nodes_x - 1; ++i) {
+				const int x0 = node_x(i);
+				const int x1 = node_x(i + 1);
+				const int x_end = (i == nodes_x - 2) ? x1 + 1 : x1;
+				const float *g00 = &grid[(j * nodes_x + i) * rgb_size];
+				const float *g01 = g00 + rgb_size;
+				const float *g10 = g00 + nodes_x * rgb_size;
+				const float *g11 = g10 + rgb_size;
+				auto interpolate = [&](float *rez, int x, int y) {
+					const float fx = float(x - x0) / (x1 - x0);
+					const float fy = float(y - y0) / (y1 - y0);
+					for(int k = 0; k < rgb_size; ++k) {
+						const float v0 = g00[k] + (g01[k] - g00[k]) * fx;
+						const float v1 = g10[k] + (g11[k] - g10[k]) * fx;
+						rez[k] = v0 + (v1 - v0) * fy;
+					}
+				};
+				// check error at the middle of the cell
+				const int mx = (x0 + x1) / 2;
+				const int my = (y0 + y1) / 2;
+				float exact[6];
+				float value[6];
+				coordinates_backward_n(exact, &_in[(my * width + mx) * 2], 1, coordinates_rgb);
+				interpolate(value, mx, my);
+				bool is_smooth = true;
+				for(int k = 0; k < rgb_size; ++k)
+					is_smooth = is_smooth && (std::abs(exact[k] - value[k]) <= tolerance);
+				for(int y = y0; y < y_end; ++y) {
+					if(is_smooth) {
+						for(int x = x0; x < x_end; ++x)
+							interpolate(&_out[(y * width + x) * rgb_size], x, y);
+					} else {
+						coordinates_backward_n(&_out[(y * width + x0) * rgb_size], &_in[(y * width + x0) * 2], x_end - x0, coordinates_rgb);
+					}
 				}
-				_out[(it_y * out_width + it_x) * 2 + 0] = in[0];
-				_out[(it_y * out_width + it_x) * 2 + 1] = in[1];
 			}
 		}
-	}
+	});
 }
 
 // - size_backward: ask input area size as for output area with edge == 1px;
@@ -982,148 +1288,231 @@ void FilterProcess_GP_Wrapper::process_sampling(SubFlow *subflow) {
 	const float px_size_y = task->px_size_y;
 	const float offset_x = task->offset_x;
 	const float offset_y = task->offset_y;
-	const int rgb_count = task->coordinates_rgb ? 4 : 1;
-	const int rgb_size = task->coordinates_rgb ? 6 : 2;
-	auto y_flow = task->y_flow;
-	while((it_y = y_flow->fetch_add(1)) < out_y_max) {
-		for(int it_x = 0; it_x < out_x_max; ++it_x) {
-			float *rez = &_out[(it_y * out_width + it_x) * 4];
-			float px_sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-			for(int k = 0; k < rgb_count; ++k) {
-				int rgb_offset = 2 * k;
-				// use coordinates for green channel for alpha channel for now
-				if(k == 3)
-					rgb_offset = 2;
-				// window boundaries
-				const int cit_x = it_x + 1;
-				const int cit_y = it_y + 1;
-				float px1 = _coordinates[(cit_y * coords_width + cit_x - 1) * rgb_size + rgb_offset + 0];
-				float _px = _coordinates[(cit_y * coords_width + cit_x    ) * rgb_size + rgb_offset + 0];
-				float px2 = _coordinates[(cit_y * coords_width + cit_x + 1) * rgb_size + rgb_offset + 0];
-				float py1 = _coordinates[((cit_y - 1) * coords_width + cit_x) * rgb_size + rgb_offset + 1];
-				float _py = _coordinates[((cit_y    ) * coords_width + cit_x) * rgb_size + rgb_offset + 1];
-				float py2 = _coordinates[((cit_y + 1) * coords_width + cit_x) * rgb_size + rgb_offset + 1];
-				px1 = (px1 + _px) * 0.5f;
-				px2 = (_px + px2) * 0.5f;
-				py1 = (py1 + _py) * 0.5f;
-				py2 = (_py + py2) * 0.5f;
-				float x1 = (px1 - offset_x) / px_size_x;
-				float x2 = (px2 - offset_x) / px_size_x;
-				float y1 = (py1 - offset_y) / px_size_y;
-				float y2 = (py2 - offset_y) / px_size_y;
-				float lx = x2 - x1;
-				float ly = y2 - y1;
-				float xst = x1;
-				float yst = y1;
-				bool flag_to_skip = false;
-				// X
-				float wx = 1.0f - (xst - floor(xst));
-				if(lx < 1.0f)
-					lx = 1.0f;
-				int ix1 = floor(xst);
-				int ix2 = floor(xst + lx);
-				ix1 += in_x_offset;
-				ix2 += in_x_offset;
-				if(ix2 < in_x1 || ix1 >= in_x2)
-					flag_to_skip = true;
-				// Y
-				float wy = 1.0f - (yst - floor(yst));
-				if(ly < 1.0f)
-					ly = 1.0f;
-				int iy1 = int(yst);
-				int iy2 = int(yst + ly);
-				iy1 += in_y_offset;
-				iy2 += in_y_offset;
-				if(iy2 < in_y1 || iy1 >= in_y2)
-					flag_to_skip = true;
-				// --==--
-				// empty pixels
-				if(flag_to_skip) {
-					for(int i = 0; i < 4; ++i)
-						rez[i] = empty_pixel[i];
-					continue;
-				}
-				// supersampling
-				float w_sum = 0.0f;
-				float w_sum_alpha = 0.0f;
-				float w_y = wy;
-				if(w_y < 0.0f)
-					w_y = -w_y;
-				float l_y = ly;
-				for(int y = iy1; y <= iy2; ++y) {
-					float w_x = wx;
-					if(w_x < 0.0f)
-						w_x = -w_x;
+	const bool coordinates_rgb = task->coordinates_rgb;
+	const int rgb_count = coordinates_rgb ? 3 : 1;
+	const int rgb_size = coordinates_rgb ? 6 : 2;
+	subflow->for_rows(task->y_flow, out_y_max, [&](int y_begin, int y_end) {
+		// weights of columns of window, the same for each row
+		std::vector<float> weights_x(16);
+		for(int it_y = y_begin; it_y < y_end; ++it_y) {
+			for(int it_x = 0; it_x < out_x_max; ++it_x) {
+				float *rez = &_out[(it_y * out_width + it_x) * 4];
+				// coordinates of green channel are used for alpha channel, so alpha is known after green pass
+				float alpha = 0.0f;
+				bool alpha_skip = false;
+				for(int k = 0; k < rgb_count; ++k) {
+					const int rgb_offset = 2 * k;
+					// window boundaries
+					const int cit_x = it_x + 1;
+					const int cit_y = it_y + 1;
+					float px1 = _coordinates[(cit_y * coords_width + cit_x - 1) * rgb_size + rgb_offset + 0];
+					float _px = _coordinates[(cit_y * coords_width + cit_x    ) * rgb_size + rgb_offset + 0];
+					float px2 = _coordinates[(cit_y * coords_width + cit_x + 1) * rgb_size + rgb_offset + 0];
+					float py1 = _coordinates[((cit_y - 1) * coords_width + cit_x) * rgb_size + rgb_offset + 1];
+					float _py = _coordinates[((cit_y    ) * coords_width + cit_x) * rgb_size + rgb_offset + 1];
+					float py2 = _coordinates[((cit_y + 1) * coords_width + cit_x) * rgb_size + rgb_offset + 1];
+					px1 = (px1 + _px) * 0.5f;
+					px2 = (_px + px2) * 0.5f;
+					py1 = (py1 + _py) * 0.5f;
+					py2 = (_py + py2) * 0.5f;
+					float x1 = (px1 - offset_x) / px_size_x;
+					float x2 = (px2 - offset_x) / px_size_x;
+					float y1 = (py1 - offset_y) / px_size_y;
+					float y2 = (py2 - offset_y) / px_size_y;
+					float lx = x2 - x1;
+					float ly = y2 - y1;
+					const float xst = x1;
+					const float yst = y1;
+					bool flag_to_skip = false;
+					// X
+					int ix1 = int(xst);
+					if(float(ix1) > xst)
+						--ix1;
+					const float wx = 1.0f - (xst - float(ix1));
+					if(lx < 1.0f)
+						lx = 1.0f;
+					int ix2 = int(xst + lx);
+					if(float(ix2) > xst + lx)
+						--ix2;
+					ix1 += in_x_offset;
+					ix2 += in_x_offset;
+					if(ix2 < in_x1 || ix1 >= in_x2)
+						flag_to_skip = true;
+					// Y
+					int iy_floor = int(yst);
+					if(float(iy_floor) > yst)
+						--iy_floor;
+					const float wy = 1.0f - (yst - float(iy_floor));
+					if(ly < 1.0f)
+						ly = 1.0f;
+					int iy1 = int(yst);
+					int iy2 = int(yst + ly);
+					iy1 += in_y_offset;
+					iy2 += in_y_offset;
+					if(iy2 < in_y1 || iy1 >= in_y2)
+						flag_to_skip = true;
+					// --==--
+					// empty pixels
+					if(flag_to_skip) {
+						for(int i = 0; i < 4; ++i)
+							rez[i] = empty_pixel[i];
+						if(k == 1)
+							alpha_skip = true;
+						continue;
+					}
+					// supersampling
+					const int nx = ix2 - ix1 + 1;
+					if(int(weights_x.size()) < nx)
+						weights_x.resize(nx);
+					float w_x = (wx < 0.0f) ? -wx : wx;
 					float l_x = lx;
-					for(int x = ix1; x <= ix2; ++x) {
-						float w = w_x * w_y;
+					for(int i = 0; i < nx; ++i) {
+						weights_x[i] = w_x;
 						l_x -= w_x;
 						w_x = (l_x > 1.0f) ? 1.0f : l_x;
-						if(x >= in_x1 && x < in_x2 && y >= in_y1 && y < in_y2) {
-							w_sum += w;
-							if(task->coordinates_rgb) {
-								if(k == 3) {
-									px_sum[3] += 1.0f * w;
-								} else {
-									px_sum[k] += _in[(y * _w + x) * 4 + k] * w;
-								}
-							} else {
-								for(int i = 0; i < 3; ++i)
-									px_sum[i] += _in[(y * _w + x) * 4 + i] * w;
-								px_sum[3] += 1.0f * w;
-							}
-						}
-						w_sum_alpha += w;
 					}
-					l_y -= w_y;
-					w_y = (l_y > 1.0f) ? 1.0f : l_y;
+					float px_sum[4];
+					float w_sum;
+					float w_sum_alpha;
+					sampling_sum(px_sum, w_sum, w_sum_alpha, _in, _w, in_x1, in_x2, in_y1, in_y2, ix1, ix2, iy1, iy2, &weights_x[0], wy, ly, coordinates_rgb ? k : -1, true);
+					// weights of pixels inside of input area are accumulated as alpha
+					if(coordinates_rgb) {
+						rez[k] = px_sum[k] / w_sum;
+						if(k == 1)
+							alpha = w_sum / w_sum_alpha;
+					} else {
+						for(int i = 0; i < 3; ++i)
+							rez[i] = px_sum[i] / w_sum;
+						rez[3] = w_sum / w_sum_alpha;
+					}
 				}
-				if(task->coordinates_rgb) {
-					if(k == 3) {
-						rez[k] = px_sum[k] / w_sum_alpha;
+				if(coordinates_rgb) {
+					if(alpha_skip) {
+						for(int i = 0; i < 4; ++i)
+							rez[i] = empty_pixel[i];
 					} else {
-						rez[k] = px_sum[k] / w_sum;
+						rez[3] = alpha;
 					}
-				} else {
-					for(int i = 0; i < 3; ++i)
-						rez[i] = px_sum[i] / w_sum;
-					rez[3] = px_sum[3] / w_sum_alpha;
 				}
-			}
 #ifdef MARK_CORNERS
-			// mark corners
-			const int mark_near = 2;
-			const int mark_far = 31;//15;
-			bool flag_mark_lt = false;
-			bool flag_mark_rb = false;
-			const int mx = out_x_max - 1;
-			const int my = out_y_max - 1;
-			if((it_y == 0 && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == 0))
-				flag_mark_lt = true;
-			if((it_y == 0 && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == 0))
-				flag_mark_lt = true;
-			if((it_y == my && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == mx))
-				flag_mark_rb = true;
-			if((it_y == my && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == mx))
-				flag_mark_rb = true;
-			if(flag_mark_lt)
-				for(int i = 0; i < 4; ++i)
-					rez[i] = mark_lt_pixel[i];
-			if(flag_mark_rb)
-				for(int i = 0; i < 4; ++i)
-					rez[i] = mark_rb_pixel[i];
+				// mark corners
+				const int mark_near = 2;
+				const int mark_far = 31;//15;
+				bool flag_mark_lt = false;
+				bool flag_mark_rb = false;
+				const int mx = out_x_max - 1;
+				const int my = out_y_max - 1;
+				if((it_y == 0 && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == 0))
+					flag_mark_lt = true;
+				if((it_y == 0 && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == 0))
+					flag_mark_lt = true;
+				if((it_y == my && it_x > mark_near && it_x < mark_far) || (it_y > mark_near && it_y < mark_far && it_x == mx))
+					flag_mark_rb = true;
+				if((it_y == my && it_x < mx - mark_near && it_x > mx - mark_far) || (it_y > my - mark_far && it_y < my - mark_near && it_x == mx))
+					flag_mark_rb = true;
+				if(flag_mark_lt)
+					for(int i = 0; i < 4; ++i)
+						rez[i] = mark_lt_pixel[i];
+				if(flag_mark_rb)
+					for(int i = 0; i < 4; ++i)
+						rez[i] = mark_rb_pixel[i];
+#endif
+				if(rez[3] > 0.99f)
+					rez[3] = 1.0f;
+				if(rez[3] < 0.01f) { // avoid 'isnan' for unprocessed transparent pixels
+					rez[0] = 0.0f;
+					rez[1] = 0.0f;
+					rez[2] = 0.0f;
+					rez[3] = 0.0f;
+				}
+//				rez[3] = 0.5;
+			}
+		}
+	});
+}
+
+void FilterProcess_GP_Wrapper::sampling_sum(float *px_sum, float &w_sum, float &w_sum_alpha, const float *in, int in_mem_width, int in_x1, int in_x2, int in_y1, int in_y2,
+		int ix1, int ix2, int iy1, int iy2, const float *weights_x, float wy, float ly, int channel, bool sse2) {
+	const int nx = ix2 - ix1 + 1;
+	// clip window with input area once instead of each pixel
+	const int cx1 = (ix1 > in_x1) ? ix1 : in_x1;
+	const int cx2 = (ix2 < in_x2 - 1) ? ix2 : in_x2 - 1;
+	const float *w_row = &weights_x[cx1 - ix1];
+	w_sum = 0.0f;
+	w_sum_alpha = 0.0f;
+	for(int c = 0; c < 4; ++c)
+		px_sum[c] = 0.0f;
+#ifdef FILTER_GP_SSE2
+	__m128 v_sum = _mm_setzero_ps();
+#endif
+	float w_y = wy;
+	if(w_y < 0.0f)
+		w_y = -w_y;
+	float l_y = ly;
+	for(int y = iy1; y <= iy2; ++y) {
+		for(int i = 0; i < nx; ++i)
+			w_sum_alpha += weights_x[i] * w_y;
+		if(y >= in_y1 && y < in_y2) {
+			const float *in_row = &in[(y * in_mem_width + cx1) * 4];
+#ifdef FILTER_GP_SSE2
+			if(sse2) {
+				for(int i = 0; i <= cx2 - cx1; ++i) {
+					const float w = w_row[i] * w_y;
+					w_sum += w;
+					v_sum = _mm_add_ps(v_sum, _mm_mul_ps(_mm_loadu_ps(&in_row[i * 4]), _mm_set1_ps(w)));
+				}
+			} else
 #endif
-			if(rez[3] > 0.99f)
-				rez[3] = 1.0f;
-			if(rez[3] < 0.01f) { // avoid 'isnan' for unprocessed transparent pixels
-				rez[0] = 0.0f;
-				rez[1] = 0.0f;
-				rez[2] = 0.0f;
-				rez[3] = 0.0f;
+			for(int i = 0; i <= cx2 - cx1; ++i) {
+				const float w = w_row[i] * w_y;
+				w_sum += w;
+				if(channel >= 0) {
+					px_sum[channel] += in_row[i * 4 + channel] * w;
+				} else {
+					for(int c = 0; c < 3; ++c)
+						px_sum[c] += in_row[i * 4 + c] * w;
+				}
 			}
-//			rez[3] = 0.5;
 		}
+		l_y -= w_y;
+		w_y = (l_y > 1.0f) ? 1.0f : l_y;
 	}
+#ifdef FILTER_GP_SSE2
+	if(sse2)
+		_mm_storeu_ps(px_sum, v_sum);
+#endif
+}
+
+// Resampling w/o filters: horizontal and vertical passes with weights of windows of 'process_sampling()',
+// and alpha of the part of window inside of input area.
+void FilterProcess_GP_Wrapper::process_sampling_separable(SubFlow *subflow, task_sampling_t *task) {
+	// 'task' is kept here as private data of subflow is changed by resampling
+	AreaHelper::resample_separable(subflow, task->area_in, task->area_out, task->table_x, task->table_y);
+
+	Area *area_out = task->area_out;
+	const int out_width = area_out->mem_width();
+	const int out_x_max = area_out->dimensions()->width();
+	const int out_y_max = area_out->dimensions()->height();
+	float *_out = (float *)area_out->ptr();
+	const float *alpha_x = task->alpha_x->data();
+	const float *alpha_y = task->alpha_y->data();
+	subflow->for_rows(task->y_flow, out_y_max, [&](int y_begin, int y_end) {
+		for(int it_y = y_begin; it_y < y_end; ++it_y) {
+			for(int it_x = 0; it_x < out_x_max; ++it_x) {
+				float *rez = &_out[(it_y * out_width + it_x) * 4];
+				float alpha = alpha_x[it_x] * alpha_y[it_y];
+				if(alpha > 0.99f)
+					alpha = 1.0f;
+				if(alpha < 0.01f) { // avoid 'isnan' for unprocessed transparent pixels
+					rez[0] = 0.0f;
+					rez[1] = 0.0f;
+					rez[2] = 0.0f;
+					alpha = 0.0f;
+				}
+				rez[3] = alpha;
+			}
+		}
+	});
 }
 
 //==============================================================================
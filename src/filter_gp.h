@@ -9,12 +9,20 @@
  *
  */
 
+#include <list>
 #include <memory>
+#include <mutex>
+#include <string>
 
 #include "area.h"
 #include "filter.h"
 #include "mt.h"
 
+#if defined(__SSE2__)
+	#define FILTER_GP_SSE2
+	#include <emmintrin.h>
+#endif
+
 //------------------------------------------------------------------------------
 class FP_GP_data_t {
 public:
@@ -47,8 +55,26 @@ public:
 	//  rgb_c[4], rgb_c[5]) - (x, y) for BLUE
 	virtual void process_forward_rgb(const float *in, float *out);
 	virtual void process_backward_rgb(float *in, const float *out);
+	// batched 'backward' in place, for 'count' points: xy[2 * count] as (x, y) pairs, or xy[6 * count] as rgb_c[6] records
+	virtual void process_backward_n(float *xy, int count);
+	virtual void process_backward_rgb_n(float *xy, int count);
 };
 
+#ifdef FILTER_GP_SSE2
+// load four (x, y) pairs as separate vectors of 'x' and 'y'
+inline void gp_load_xy_4(const float *xy, __m128 &x, __m128 &y) {
+	const __m128 a = _mm_loadu_ps(&xy[0]);
+	const __m128 b = _mm_loadu_ps(&xy[4]);
+	x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+	y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline void gp_store_xy_4(float *xy, const __m128 &x, const __m128 &y) {
+	_mm_storeu_ps(&xy[0], _mm_unpacklo_ps(x, y));
+	_mm_storeu_ps(&xy[4], _mm_unpackhi_ps(x, y));
+}
+#endif
+
 class FilterProcess_GP : public virtual FilterProcess {
 public:
 	virtual FilterProcess::fp_type_en fp_type(bool process_thumbnail) {return _fp_type;}
@@ -69,6 +95,20 @@ public:
 	class FS_Base *fs_base;
 };
 
+// Coordinates of tiles traced backward through geometry filters, kept with photo between processing requests,
+// so changes of color settings and panning at the same scale skip tracing; the least recently used are dropped.
+class FP_GP_Coordinates_Cache_t {
+public:
+	std::shared_ptr<Area> get(const std::string &key);
+	void put(const std::string &key, std::shared_ptr<Area> area);
+
+protected:
+	std::mutex lock;
+	std::list<std::pair<std::string, std::shared_ptr<Area>>> entries; // most recently used first
+	size_t mem_size = 0;
+	static size_t size_limit(void);
+};
+
 class FilterProcess_GP_Wrapper : public FilterProcess_2D {
 public:
 	FilterProcess_GP_Wrapper(const std::vector<class FP_GP_Wrapper_record_t> &);
@@ -78,11 +118,22 @@ public:
 
 	void size_forward(FP_size_t *fp_size, const Area::t_dimensions *d_before, Area::t_dimensions *d_after);
 	void size_backward(FP_size_t *fp_size, Area::t_dimensions *d_before, const Area::t_dimensions *d_after);
+	// reuse coordinates of tiles between processing requests, if possible
+	void set_coordinates_cache(class FP_GP_Coordinates_Cache_t *coordinates_cache);
+	// Kernel of supersampling: weighted sum 'px_sum[4]' of window of input pixels, with rows 'iy1 - iy2' and columns 'ix1 - ix2' of weights
+	// 'weights_x', clipped with input area 'in_x1 - in_x2', 'in_y1 - in_y2'; 'w_sum' - weights inside of input area, 'w_sum_alpha' - of the whole window.
+	// 'channel' - the only channel to sum, or '-1' for RGB; 'sse2 == false' - scalar code, to check SSE2 one; ignored w/o SSE2.
+	static void sampling_sum(float *px_sum, float &w_sum, float &w_sum_alpha, const float *in, int in_mem_width, int in_x1, int in_x2, int in_y1, int in_y2,
+		int ix1, int ix2, int iy1, int iy2, const float *weights_x, float wy, float ly, int channel, bool sse2);
 
 protected:
 	std::vector<class FP_GP_Wrapper_record_t> fp_gp_vector;
 	std::vector<class FP_GP *> gp_vector;
+	// create FP_GP objects once; could be called concurrently by tiles processed in parallel
 	void init_gp(class Metadata *metadata);
+	std::mutex gp_lock;
+	class FP_GP_Coordinates_Cache_t *coordinates_cache;
+	std::string coordinates_key; // settings of filters, prefix of key of cached coordinates
 
 	void size_forward_point(float in_x, float in_y, bool *flag_min_max, float *x_min_max, float *y_min_max);
 	void size_backward_point(float out_x, float out_y, bool *flag_min_max, float *x_min_max, float *y_min_max);
@@ -93,10 +144,14 @@ protected:
 	class task_coordinates_t;
 	class task_sampling_t;
 	std::unique_ptr<Area> process_sampling(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj);
+	std::string coordinates_tile_key(const Process_t *process_obj, const Area *area_in, int grid_step);
 	void prepare_coordinates(SubFlow *subflow);
 	void process_coordinates(SubFlow *subflow);
+	void process_coordinates_grid(SubFlow *subflow);
+	// apply backward the whole chain of filters to 'count' (x, y) pairs of output pixels; 'rez' is float[2] or float[6] per pixel
+	void coordinates_backward_n(float *rez, const float *in, int count, bool coordinates_rgb);
 	void process_sampling(SubFlow *subflow);
-	void process_sampling_sinc2(SubFlow *subflow);
+	void process_sampling_separable(SubFlow *subflow, task_sampling_t *task);
 	//--
 	class task_copy_t;
 	std::unique_ptr<Area> process_copy(MT_t *mt_obj, Process_t *process_obj, Filter_t *filter_obj);
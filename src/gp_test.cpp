@@ -0,0 +1,143 @@
+/*
+ * gp_test.cpp
+ *
+ * This source code is a part of 'DDRoom' project.
+ * (C) 2015-2017 Mykhailo Malyshko a.k.a. Spectr.
+ * License: GPL version 3.
+ *
+ */
+
+/*
+ Test of supersampling kernel FilterProcess_GP_Wrapper::sampling_sum(): random windows from upsampling
+ to downsampling, partially out of input area from each side, for RGB and for each channel separately.
+ Scalar kernel is checked against the straightforward reference in double precision, SSE2 one - against scalar.
+ Exit code: 0 - all differences are within tolerance, 1 - some are not.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "filter_gp.h"
+
+using namespace std;
+
+// max relative difference of kernels with the reference
+#define TEST_GP_DIFF	1.0e-5
+
+//------------------------------------------------------------------------------
+class test_window_t {
+public:
+	int ix1, ix2, iy1, iy2;
+	float wy, ly;
+	std::vector<float> weights_x;
+	int channel;
+};
+
+// the same sums, pixel by pixel: rows weights are '|wy|', then '1.0' while the rest of 'ly' is above it, and the rest
+static void test_reference(double *px_sum, double &w_sum, double &w_sum_alpha, const float *in, int in_mem_width, int in_x1, int in_x2, int in_y1, int in_y2, const test_window_t &w) {
+	w_sum = 0.0;
+	w_sum_alpha = 0.0;
+	for(int c = 0; c < 4; ++c)
+		px_sum[c] = 0.0;
+	double w_y = std::abs(w.wy);
+	double l_y = w.ly;
+	for(int y = w.iy1; y <= w.iy2; ++y) {
+		for(int x = w.ix1; x <= w.ix2; ++x) {
+			const double weight = double(w.weights_x[x - w.ix1]) * w_y;
+			w_sum_alpha += weight;
+			if(x < in_x1 || x >= in_x2 || y < in_y1 || y >= in_y2)
+				continue;
+			w_sum += weight;
+			for(int c = 0; c < 4; ++c)
+				px_sum[c] += in[(y * in_mem_width + x) * 4 + c] * weight;
+		}
+		l_y -= w_y;
+		w_y = (l_y > 1.0) ? 1.0 : l_y;
+	}
+}
+
+static double test_diff(double a, double b) {
+	return std::abs(a - b) / std::max(1.0, std::abs(a));
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+	// input area with edges
+	const int edge = 2;
+	const int width = 256;
+	const int height = 256;
+	const int mem_width = width + edge * 2;
+	const int mem_height = height + edge * 2;
+	unsigned state = 1;
+	auto random = [&](void) {
+		state = state * 1664525u + 1013904223u;
+		return float(state >> 8) / float(1 << 24);
+	};
+	std::vector<float> in(mem_width * mem_height * 4);
+	for(int i = 0; i < mem_width * mem_height; ++i) {
+		for(int c = 0; c < 3; ++c)
+			in[i * 4 + c] = random();
+		in[i * 4 + 3] = 1.0f;
+	}
+
+	double diff_scalar = 0.0;
+	double diff_sse2 = 0.0;
+	const int count = 64 * 1024;
+	for(int j = 0; j < count; ++j) {
+		// windows as at 'FilterProcess_GP_Wrapper::process_sampling()', scales from 1/4 to 8
+		test_window_t w;
+		const float scale = std::pow(2.0f, random() * 5.0f - 2.0f);
+		const float xst = random() * (mem_width - 2.0f);
+		const float yst = random() * (mem_height - 2.0f);
+		const float lx = std::max(scale, 1.0f);
+		w.ly = std::max(scale, 1.0f);
+		w.ix1 = int(std::floor(xst));
+		w.ix2 = int(std::floor(xst + lx));
+		w.wy = 1.0f - (yst - std::floor(yst));
+		w.iy1 = int(yst);
+		w.iy2 = int(yst + w.ly);
+		float w_x = 1.0f - (xst - std::floor(xst));
+		float l_x = lx;
+		for(int i = w.ix1; i <= w.ix2; ++i) {
+			w.weights_x.push_back(w_x);
+			l_x -= w_x;
+			w_x = (l_x > 1.0f) ? 1.0f : l_x;
+		}
+		w.channel = (j % 4) - 1;
+
+		double ref[4];
+		double ref_w_sum;
+		double ref_w_sum_alpha;
+		test_reference(ref, ref_w_sum, ref_w_sum_alpha, &in[0], mem_width, edge, edge + width, edge, edge + height, w);
+		for(bool sse2 : {false, true}) {
+			float px_sum[4];
+			float w_sum;
+			float w_sum_alpha;
+			FilterProcess_GP_Wrapper::sampling_sum(px_sum, w_sum, w_sum_alpha, &in[0], mem_width, edge, edge + width, edge, edge + height,
+				w.ix1, w.ix2, w.iy1, w.iy2, &w.weights_x[0], w.wy, w.ly, w.channel, sse2);
+			double d = std::max(test_diff(ref_w_sum, w_sum), test_diff(ref_w_sum_alpha, w_sum_alpha));
+			for(int c = 0; c < 3; ++c)
+				if(w.channel < 0 || w.channel == c)
+					d = std::max(d, test_diff(ref[c], px_sum[c]));
+			double &diff = sse2 ? diff_sse2 : diff_scalar;
+			diff = std::max(diff, d);
+		}
+	}
+	bool failed = false;
+	for(bool sse2 : {false, true}) {
+#ifndef FILTER_GP_SSE2
+		if(sse2)
+			continue;
+#endif
+		const double diff = sse2 ? diff_sse2 : diff_scalar;
+		const bool ok = (diff <= TEST_GP_DIFF);
+		cerr << "test: sampling_sum() " << (sse2 ? "SSE2" : "scalar") << " max difference with the reference: " << diff << (ok ? "" : " - FAILED") << endl;
+		failed |= !ok;
+	}
+	cerr << "test: " << (failed ? "FAILED" : "OK") << endl;
+	return failed ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
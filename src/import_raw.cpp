@@ -15,6 +15,8 @@
 
 */
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
@@ -118,22 +120,8 @@ std::unique_ptr<Area> Import_Raw::image(Metadata *metadata) {
 
 	get_metadata(dcraw, metadata, dcraw_raw);
 	Exiv2_load_metadata(file_name, metadata);
-	bool processed = false;
-	if(metadata->sensor_foveon) {
-		prof.mark("process Foveon data with dcraw");
-		processed = true;
-		area_out = load_foveon(dcraw, metadata, dcraw_raw);
-	}
-	if(metadata->sensor_xtrans) {
-		prof.mark("load X-Trans data");
-		processed = true;
-		area_out = load_xtrans(dcraw, metadata, dcraw_raw);
-	}
-	if(!processed && !metadata->demosaic_unsupported) {
-		prof.mark("load Bayer data");
-//		processed = true;
-		area_out = dcraw_to_area(dcraw, metadata, dcraw_raw);
-	}
+	prof.mark("convert raw data");
+	area_out = raw_to_area(dcraw, dcraw_raw, metadata);
 	DCRaw::free_raw(dcraw_raw);
 	delete dcraw;
 	prof.mark("");
@@ -141,6 +129,86 @@ std::unique_ptr<Area> Import_Raw::image(Metadata *metadata) {
 	return area_out;
 }
 
+std::unique_ptr<Area> Import_Raw::image(DCRaw *dcraw, const uint16_t *dcraw_raw, Metadata *metadata) {
+	metadata->is_raw = true;
+	get_metadata(dcraw, metadata, dcraw_raw);
+	return raw_to_area(dcraw, dcraw_raw, metadata);
+}
+
+std::unique_ptr<Area> Import_Raw::raw_to_area(DCRaw *dcraw, const uint16_t *dcraw_raw, Metadata *metadata) {
+	std::unique_ptr<Area> area_out;
+	if(metadata->sensor_foveon)
+		return load_foveon(dcraw, metadata, dcraw_raw);
+	if(metadata->sensor_xtrans)
+		return load_xtrans(dcraw, metadata, dcraw_raw);
+	if(!metadata->demosaic_unsupported)
+		area_out = dcraw_to_area(dcraw, metadata, dcraw_raw);
+	return area_out;
+}
+
+//------------------------------------------------------------------------------
+DCRaw *Import_Raw::synthetic_raw(int width, int height, bool xtrans, std::vector<uint16_t> &dcraw_raw, unsigned seed) {
+	static const char xtrans_pattern[6][6] = {
+		{1, 1, 0, 1, 1, 2},
+		{1, 1, 2, 1, 1, 0},
+		{2, 0, 1, 0, 2, 1},
+		{1, 1, 2, 1, 1, 0},
+		{1, 1, 0, 1, 1, 2},
+		{0, 2, 1, 2, 0, 1},
+	};
+	DCRaw *dcraw = new DCRaw();
+	dcraw->is_raw = 1;
+	dcraw->width = dcraw->iwidth = width;
+	dcraw->height = dcraw->iheight = height;
+	std::strcpy(dcraw->cdesc, "RGBG");
+	std::strcpy(dcraw->make, "DDRoom");
+	std::strcpy(dcraw->model, xtrans ? "Synthetic X-Trans" : "Synthetic Bayer");
+	dcraw->filters = xtrans ? 9 : 0x94949494;	// RGGB
+	for(int j = 0; j < 6; ++j)
+		for(int i = 0; i < 6; ++i)
+			dcraw->xtrans[j][i] = xtrans_pattern[j][i];
+	// 14 bits signal w/o black offset
+	dcraw->black = 0;
+	std::memset(dcraw->cblack, 0, sizeof(dcraw->cblack));
+	dcraw->maximum = 16383;
+	const float mul[4] = {2.0f, 1.0f, 1.6f, 1.0f};
+	for(int i = 0; i < 4; ++i) {
+		dcraw->pre_mul[i] = mul[i];
+		dcraw->cam_mul[i] = mul[i];
+	}
+	for(int j = 0; j < 3; ++j)
+		for(int i = 0; i < 4; ++i)
+			dcraw->rgb_cam[j][i] = (i == j) ? 1.0f : 0.0f;
+	dcraw->iso_speed = 100;
+	dcraw->shutter = 1.0 / 125.0;
+	dcraw->aperture = 8.0;
+	dcraw->focal_len = 50.0;
+	dcraw->timestamp = 0;
+
+	// DCRaw layout: four values per pixel, one of them with signal
+	dcraw_raw.assign(size_t(width) * height * 4, 0);
+	unsigned state = seed;
+	for(int y = 0; y < height; ++y) {
+		for(int x = 0; x < width; ++x) {
+			int c = 0;
+			if(xtrans)
+				c = xtrans_pattern[y % 6][x % 6];
+			else
+				c = (dcraw->filters >> ((((y << 1) & 14) + (x & 1)) << 1)) & 3;
+			// gradients of scene colors, under white balance multipliers
+			const float fx = float(x) / width;
+			const float fy = float(y) / height;
+			const float scene[4] = {fx, 0.5f * (fx + fy), fy, 0.5f * (fx + fy)};
+			state = state * 1664525u + 1013904223u;
+			const float noise = float(state >> 20) / 4096.0f - 0.5f;
+			float value = (0.05f + 0.8f * scene[c] + 0.02f * noise) / mul[c] * dcraw->maximum;
+			value = (value < 0.0f) ? 0.0f : ((value > dcraw->maximum) ? dcraw->maximum : value);
+			dcraw_raw[(size_t(y) * width + x) * 4 + c] = uint16_t(value);
+		}
+	}
+	return dcraw;
+}
+
 //------------------------------------------------------------------------------
 std::unique_ptr<Area> Import_Raw::demosaic_xtrans(const uint16_t *_image, int _width, int _height, const class Metadata *metadata, int passes, class Area *area_out) {
 	DCRaw dcraw;
@@ -279,7 +347,6 @@ std::unique_ptr<Area> Import_Raw::dcraw_to_area(DCRaw *dcraw, Metadata *metadata
 //cerr << "dcraw_to_area():     metadata->rotation == " << metadata->rotation << endl;
 //cerr << "metadata->demosaic_pattern == " << metadata->demosaic_pattern << endl;
 //	metadata->rotation = 0;
-	auto area_out = std::unique_ptr<Area>(new Area(width + 4, height + 4, Area::type_t::float_p1));
 /*
 	int mm = (width + 4) * (height + 4);
 	float *mp = (float *)area_out->ptr();
@@ -392,7 +459,6 @@ cerr << "dcraw->pre_mul[3] == " << dcraw->pre_mul[3] << endl;
 	// convert uint16_t to prescaled float, bayer pattern
 	//--
 	int offset = 2 * (width + 4) + 2;
-	float *out = (float *)area_out->ptr() + offset;
 	// fill metadata with signal levels and scaling factor for demosaic processing
 	float _import_prescale[4];
 	float _signal_max[4];
@@ -506,17 +572,49 @@ cerr << "bayer_signal_maximum[3] == " << bayer_signal_maximum[3] << endl;
 		normalization_factor[i] = bayer_signal_maximum[i] - black_pixels_level[i];
 */
 	//===================================================
+	// Keep mosaic as 'uint16_p1' with black level, with conversion to float at demosaic:
+	// '(value - demosaic_raw_black[]) * demosaic_raw_scale[]', so signal under black level is kept as with float.
+	// Per-pixel black offset pattern can't be described with per-channel values, so use float for that.
+	const bool raw_compact = !(dcraw->cblack[4] && dcraw->cblack[5]);
+	std::unique_ptr<Area> area_out;
+	if(raw_compact)
+		area_out = std::unique_ptr<Area>(new Area(width + 4, height + 4, Area::type_t::uint16_p1));
+	else
+		area_out = std::unique_ptr<Area>(new Area(width + 4, height + 4, Area::type_t::float_p1));
+	float *out = (float *)area_out->ptr();
+	uint16_t *out_16 = (uint16_t *)area_out->ptr();
+	int out_index = offset;
+	for(int i = 0; i < 4; ++i) {
+		int index_4 = 0;
+		const int s = __bayer_pos_to_c(i % 2, i / 2);
+		if(s == p_green_r)
+			index_4 = 1;
+		else if(s == p_blue)
+			index_4 = 2;
+		else if(s == p_green_b)
+			index_4 = metadata->demosaic_unknown ? 1 : 3;
+		metadata->demosaic_raw_scale[i] = scale[i] / (bayer_signal_maximum[index_4] - black_pixels_level[index_4]);
+		metadata->demosaic_raw_black[i] = uint16_t(std::min(65535.0f, black_pixels_level[index_4]));
+	}
+	// edges strips and pixels outside of Fuji 45 rotated sensor are zero signal, i.e. black level
+	if(raw_compact) {
+		const int w4 = width + 4;
+		const int h4 = height + 4;
+		for(int y = 0; y < h4; ++y)
+			for(int x = 0; x < w4; ++x)
+				out_16[y * w4 + x] = metadata->demosaic_raw_black[(y % 2) * 2 + (x % 2)];
+	}
 	// reset edges strips
 	float *out_mem = (float *)area_out->ptr();
 	const int w4 = width + 4;
 	const int h4 = height + 4;
-	for(int y = 2; y < h4; ++y) {
+	for(int y = 2; y < h4 && !raw_compact; ++y) {
 		out_mem[y * w4 + 0] = 0.0;
 		out_mem[y * w4 + 1] = 0.0;
 		out_mem[y * w4 + w4 - 1] = 0.0;
 		out_mem[y * w4 + w4 - 2] = 0.0;
 	}
-	for(int x = 0; x < w4; ++x) {
+	for(int x = 0; x < w4 && !raw_compact; ++x) {
 		out_mem[x + 0 * w4] = 0.0;
 		out_mem[x + 1 * w4] = 0.0;
 		out_mem[x + (height + 3) * w4] = 0.0;
@@ -566,8 +664,9 @@ cerr << "bayer_signal_maximum[3] == " << bayer_signal_maximum[3] << endl;
 			if(fuji_45 != nullptr) {
 //				if(fuji_45->raw_is_outside(i, j, 2)) {
 				if(fuji_45->raw_is_outside(i, j, 0)) {
-					*out = 0.0;
-					out++;
+					if(!raw_compact)
+						out[out_index] = 0.0;
+					out_index++;
 					continue;
 				}
 			}
@@ -579,6 +678,8 @@ cerr << "bayer_signal_maximum[3] == " << bayer_signal_maximum[3] << endl;
 				const int ii = j * width + i;
 				black_offset += dcraw->cblack[6 + ii / width % dcraw->cblack[4] * dcraw->cblack[5] + ii % width % dcraw->cblack[5]];
 			}
+			if(raw_compact)
+				out_16[out_index] = dcraw_raw[k + index_4];
 			value -= black_offset;
 			value /= bayer_signal_maximum[index_4] - black_offset;
 
@@ -601,10 +702,11 @@ cerr << "bayer_signal_maximum[3] == " << bayer_signal_maximum[3] << endl;
 			// store result
 			if(_signal_max[index_4] < value)
 				_signal_max[index_4] = value;
-			*out = value;
-			out++;
+			if(!raw_compact)
+				out[out_index] = value;
+			out_index++;
 		}
-		out += 4;
+		out_index += 4;
 	}
 	for(int i = 0; i < 4; ++i) {
 		int s = __bayer_pos_to_c(i % 2, i / 2);
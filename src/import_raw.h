@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "import.h"
 
@@ -23,10 +24,16 @@ public:
 	std::unique_ptr<Area> image(class Metadata *metadata);
 
 	void load_metadata(class Metadata *metadata);
+	// import of raw data already decoded by DCRaw
+	std::unique_ptr<Area> image(class DCRaw *dcraw, const uint16_t *dcraw_raw, class Metadata *metadata);
+	// synthetic raw photo for benchmarks - Bayer RGGB or X-Trans mosaic of smooth gradients with noise,
+	// like it would be decoded by DCRaw from a camera file; returned object should be deleted by caller
+	static class DCRaw *synthetic_raw(int width, int height, bool xtrans, std::vector<uint16_t> &dcraw_raw, unsigned seed = 1);
 	static std::unique_ptr<Area> demosaic_xtrans(const uint16_t *_image, int _width, int _height, const class Metadata *metadata, int passes, class Area *area_out = nullptr);
 
 protected:
 //	static std::mutex dcraw_lock;
+	std::unique_ptr<Area> raw_to_area(class DCRaw *dcraw, const uint16_t *dcraw_raw, class Metadata *metadata);
 	std::unique_ptr<Area> dcraw_to_area(class DCRaw *dcraw, class Metadata *metadata, const uint16_t *dcraw_raw);
 	std::unique_ptr<Area> load_foveon(class DCRaw *dcraw, class Metadata *metadata, const uint16_t *dcraw_raw);
 	std::unique_ptr<Area> load_xtrans(class DCRaw *dcraw, class Metadata *metadata, const uint16_t *dcraw_raw);
@@ -21,6 +21,8 @@
 #include "window.h"
 #include "photo.h"
 #include "filter.h"
+#include "render.h"
+#include "render_server.h"
 
 #include "import.h"
 
@@ -60,6 +62,16 @@ void unit_tests(void) {
 //------------------------------------------------------------------------------
 int main(int argc, char *argv[]) {
 	try {
+		// headless modes, w/o widgets
+		const bool is_server_mode = Render_Server::is_server_mode(argc, argv);
+		if(is_server_mode || Render::is_render_mode(argc, argv)) {
+			QCoreApplication *application = new QCoreApplication(argc, argv);
+			qRegisterMetaType<std::string>("std::string");
+			init_libraries();
+			int rez = is_server_mode ? Render_Server::run(argc, argv) : Render::run(argc, argv);
+			delete application;
+			return rez;
+		}
 		QApplication *application = new QApplication(argc, argv);
 		qRegisterMetaType<std::string>("std::string");
 		qRegisterMetaType<QVector<long> >("QVector<long>");
@@ -121,6 +133,8 @@ bool parse_arguments(int argc, char *argv[]) {
 		string arg = argv[i];
 		if(arg == "--help") {
 			cerr << "--generate-sgt - calculate and save saturation gamut tables as cm-cs-ver.sgt files" << endl;
+			cerr << "--render - render photos w/o GUI, see 'ddroom --render --help'" << endl;
+			cerr << "--serve - run render server on local socket, with jobs in '--render' format" << endl;
 			rez = true;
 		}
 		if(arg == "--generate-sgt") {
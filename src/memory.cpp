@@ -7,8 +7,10 @@
  *
  */
 
+#include <atomic>
 #include <iostream>
 #include <iomanip>
+#include <vector>
 #include "memory.h"
 
 using namespace std;
@@ -18,11 +20,11 @@ using namespace std;
 
 // (heap) Memory storage, with reference counter.
 //------------------------------------------------------------------------------
-size_t Mem::mem_total = 0;
-std::mutex Mem::state_mutex;
-size_t Mem::mem_start = 0;
-size_t Mem::mem_min = 0;
-size_t Mem::mem_max = 0;
+std::atomic<long> Mem::mem_total(0);
+std::atomic<long> Mem::mem_start(0);
+std::atomic<long> Mem::mem_min(0);
+std::atomic<long> Mem::mem_max(0);
+static thread_local std::shared_ptr<MemTracker> mem_tracker;
 #ifdef _FORCE_SILENT
 bool Mem::silent = true;
 #else
@@ -32,6 +34,230 @@ bool Mem::silent = false;
 std::mutex Mem::ptr_set_lock;
 std::set<uintptr_t> Mem::ptr_set;
 
+//------------------------------------------------------------------------------
+// Pool of freed buffers by size classes - the same sized tile buffers are allocated and freed over and over at processing.
+// Recently freed buffers are reused first from the thread's own cache, then from the shared one.
+#define MEM_POOL_MIN_SIZE	(64 * 1024)	// smaller buffers are not pooled
+#define MEM_POOL_STEPS		8			// size classes per each power of 2, i.e. up to 12.5% of overhead
+#define MEM_POOL_CLASSES	(64 * MEM_POOL_STEPS)
+#define MEM_POOL_THREAD_CACHE	4		// buffers at the thread's own cache
+#define MEM_POOL_LIMIT_DEFAULT	(256 * 1024 * 1024)
+
+class MemPool {
+public:
+	static int size_class(size_t size);
+	static size_t class_size(int index);
+	static char *alloc(size_t size, size_t &allocated_size);
+	static void release(char *ptr, size_t allocated_size);
+	static void shared_push(int index, char *ptr);
+	static size_t flush(bool thread_cache = true);
+	// release buffers of the thread's cache if pool was flushed after the last check
+	static size_t thread_cache_check(void);
+
+	static std::atomic<size_t> limit;
+	// incremented by each flush; caches of threads are checked at the next alloc or release by their threads
+	static std::atomic<unsigned> flush_epoch;
+	static std::atomic<size_t> bytes_cached;
+	static std::atomic<size_t> bytes_cached_max;
+	static std::atomic<long> count_requests;
+	static std::atomic<long> count_hits;
+	static std::mutex shared_lock[MEM_POOL_CLASSES];
+	static std::vector<char *> shared[MEM_POOL_CLASSES];
+};
+
+class MemPool_thread_cache_t {
+public:
+	~MemPool_thread_cache_t();
+	int index[MEM_POOL_THREAD_CACHE];
+	char *ptr[MEM_POOL_THREAD_CACHE];
+	int count = 0;
+	unsigned epoch = 0;
+};
+
+std::atomic<size_t> MemPool::limit(MEM_POOL_LIMIT_DEFAULT);
+std::atomic<unsigned> MemPool::flush_epoch(0);
+std::atomic<size_t> MemPool::bytes_cached(0);
+std::atomic<size_t> MemPool::bytes_cached_max(0);
+std::atomic<long> MemPool::count_requests(0);
+std::atomic<long> MemPool::count_hits(0);
+std::mutex MemPool::shared_lock[MEM_POOL_CLASSES];
+std::vector<char *> MemPool::shared[MEM_POOL_CLASSES];
+static thread_local MemPool_thread_cache_t mem_pool_thread_cache;
+
+// release shared buffers on exit
+class MemPool_cleanup_t {
+public:
+	// the thread's cache of the main thread is already destroyed here
+	~MemPool_cleanup_t() {MemPool::flush(false);}
+};
+static MemPool_cleanup_t mem_pool_cleanup;
+
+// return -1 for sizes that should not be pooled
+int MemPool::size_class(size_t size) {
+	if(size < MEM_POOL_MIN_SIZE)
+		return -1;
+	int k = 0;
+	while((size >> (k + 1)) != 0)
+		++k;
+	const size_t base = size_t(1) << k;
+	const size_t step = base / MEM_POOL_STEPS;
+	size_t m = (size - base + step - 1) / step;
+	if(m == MEM_POOL_STEPS) {
+		++k;
+		m = 0;
+	}
+	return k * MEM_POOL_STEPS + m;
+}
+
+size_t MemPool::class_size(int index) {
+	const size_t base = size_t(1) << (index / MEM_POOL_STEPS);
+	return base + (base / MEM_POOL_STEPS) * (index % MEM_POOL_STEPS);
+}
+
+char *MemPool::alloc(size_t size, size_t &allocated_size) {
+	allocated_size = size;
+	const size_t _limit = limit.load();
+	int index = (_limit != 0) ? size_class(size) : -1;
+	// buffer of that class would never be kept by the pool, so don't round it up
+	if(index >= 0 && class_size(index) > _limit)
+		index = -1;
+	if(index >= 0) {
+		allocated_size = class_size(index);
+		count_requests.fetch_add(1);
+		thread_cache_check();
+		// the most recently freed at this thread
+		MemPool_thread_cache_t &tc = mem_pool_thread_cache;
+		for(int i = tc.count - 1; i >= 0; --i) {
+			if(tc.index[i] == index) {
+				char *ptr = tc.ptr[i];
+				for(; i < tc.count - 1; ++i) {
+					tc.index[i] = tc.index[i + 1];
+					tc.ptr[i] = tc.ptr[i + 1];
+				}
+				--tc.count;
+				bytes_cached.fetch_sub(allocated_size);
+				count_hits.fetch_add(1);
+				return ptr;
+			}
+		}
+		// shared
+		char *ptr = nullptr;
+		shared_lock[index].lock();
+		if(!shared[index].empty()) {
+			ptr = shared[index].back();
+			shared[index].pop_back();
+		}
+		shared_lock[index].unlock();
+		if(ptr != nullptr) {
+			bytes_cached.fetch_sub(allocated_size);
+			count_hits.fetch_add(1);
+			return ptr;
+		}
+	}
+	try {
+		return new char[allocated_size];
+	} catch(...) {
+	}
+	// release cached buffers and try again
+	if(flush() == 0)
+		throw std::bad_alloc();
+	return new char[allocated_size];
+}
+
+void MemPool::release(char *ptr, size_t allocated_size) {
+	const int index = size_class(allocated_size);
+	const size_t _limit = limit.load();
+	if(index < 0 || class_size(index) != allocated_size) {
+		delete[] ptr;
+		return;
+	}
+	thread_cache_check();
+	// reserve space in the pool, concurrent releases can't overshoot the limit
+	size_t cached = bytes_cached.load();
+	do {
+		if(cached + allocated_size > _limit) {
+			delete[] ptr;
+			return;
+		}
+	} while(!bytes_cached.compare_exchange_weak(cached, cached + allocated_size));
+	cached += allocated_size;
+	size_t cached_max = bytes_cached_max.load();
+	while(cached > cached_max && !bytes_cached_max.compare_exchange_weak(cached_max, cached));
+	MemPool_thread_cache_t &tc = mem_pool_thread_cache;
+	if(tc.count == MEM_POOL_THREAD_CACHE) {
+		// move the oldest one to the shared pool
+		shared_push(tc.index[0], tc.ptr[0]);
+		for(int i = 0; i < tc.count - 1; ++i) {
+			tc.index[i] = tc.index[i + 1];
+			tc.ptr[i] = tc.ptr[i + 1];
+		}
+		--tc.count;
+	}
+	tc.index[tc.count] = index;
+	tc.ptr[tc.count] = ptr;
+	++tc.count;
+}
+
+void MemPool::shared_push(int index, char *ptr) {
+	shared_lock[index].lock();
+	shared[index].push_back(ptr);
+	shared_lock[index].unlock();
+}
+
+// release shared buffers and buffers of the calling thread; caches of the other threads
+// are released by them at the next alloc or release; return size of released memory
+size_t MemPool::flush(bool thread_cache) {
+	flush_epoch.fetch_add(1);
+	const size_t thread_released = thread_cache ? thread_cache_check() : 0;
+	size_t released = thread_released;
+	for(int index = 0; index < MEM_POOL_CLASSES; ++index) {
+		std::vector<char *> v;
+		shared_lock[index].lock();
+		v.swap(shared[index]);
+		shared_lock[index].unlock();
+		for(auto ptr : v)
+			delete[] ptr;
+		released += v.size() * class_size(index);
+	}
+	bytes_cached.fetch_sub(released - thread_released);
+	return released;
+}
+
+size_t MemPool::thread_cache_check(void) {
+	MemPool_thread_cache_t &tc = mem_pool_thread_cache;
+	const unsigned epoch = flush_epoch.load();
+	if(tc.epoch == epoch)
+		return 0;
+	tc.epoch = epoch;
+	size_t released = 0;
+	for(int i = 0; i < tc.count; ++i) {
+		delete[] tc.ptr[i];
+		released += class_size(tc.index[i]);
+	}
+	tc.count = 0;
+	bytes_cached.fetch_sub(released);
+	return released;
+}
+
+MemPool_thread_cache_t::~MemPool_thread_cache_t() {
+	// thread exit
+	for(int i = 0; i < count; ++i)
+		MemPool::shared_push(index[i], ptr[i]);
+	count = 0;
+}
+
+void Mem::pool_set_limit(size_t bytes) {
+	MemPool::limit.store(bytes);
+	if(MemPool::bytes_cached.load() > bytes)
+		MemPool::flush();
+}
+
+void Mem::pool_flush(void) {
+	MemPool::flush();
+}
+
+//------------------------------------------------------------------------------
+
 void Mem::ptr_dump(void) {
 	int refs = mem_shared_ptr.use_count();
 	std::cerr << "ptr == " << ((void *)ptr_allocated) << ", size == " << _mem_size << ", references == " << refs << std::endl;
@@ -41,16 +267,16 @@ Mem::Mem(size_t size) {
 	if(size != 0) {
 		// aligned memory
 		try {
-			ptr_allocated = new char[size + 32];
+			ptr_allocated = MemPool::alloc(size + 32, _mem_size);
 		} catch(...) {
 			// operator new failed, use nullptr value instead
 			ptr_allocated = nullptr;
+			_mem_size = 0;
 			return;
 //cerr << "failed to allocate memory with size: " << size << endl;
 		}
 	} else
 		return;
-	_mem_size = size + 32;
 	state_update(_mem_size);
 #ifdef USE_PTR_SET
 	ptr_set_lock.lock();
@@ -62,7 +288,7 @@ Mem::Mem(size_t size) {
 		int m = _mem_size;
 		cerr << m / 1000000 << setfill('0') << "." << setw(3) << (m % 1000000 / 1000) << "." << setw(3) << (m % 1000) << setfill(' ') << " bytes] memory usage: ";
 		//--
-		m = mem_total;
+		m = state_total();
 		cerr << m / 1000000 << setfill('0') << "." << setw(3) << (m % 1000000 / 1000) << "." << setw(3) << (m % 1000) << setfill(' ') << " bytes" << endl;
 	}
 	uintptr_t pointer = (uintptr_t)((void *)ptr_allocated);
@@ -76,7 +302,15 @@ Mem::Mem(size_t size) {
 		pointer = (pointer + 16) & mask_64;
 	ptr_aligned = (void *)pointer;
 	size_t msize = _mem_size;
-	mem_shared_ptr = decltype(mem_shared_ptr)(ptr_allocated, [msize](char *ptr){delete[] ptr; Mem::register_free(ptr, msize);});
+	std::shared_ptr<MemTracker> tracker = mem_tracker;
+	if(tracker != nullptr)
+		tracker->update(msize);
+	mem_shared_ptr = decltype(mem_shared_ptr)(ptr_allocated, [msize, tracker](char *ptr){
+		MemPool::release(ptr, msize);
+		Mem::register_free(ptr, msize);
+		if(tracker != nullptr)
+			tracker->update(-long(msize));
+	});
 }
 
 Mem::Mem(Mem const &other) {
@@ -104,7 +338,7 @@ void *Mem::ptr(void) {
 }
 
 void Mem::register_free(void *ptr, size_t size) {
-	state_update(-size);
+	state_update(-long(size));
 #ifdef USE_PTR_SET
 	ptr_set_lock.lock();
 	{
@@ -119,43 +353,144 @@ void Mem::register_free(void *ptr, size_t size) {
 		cerr << "------------------------->> ptr == 0x" << std::hex << (unsigned long)ptr << std::dec <<  "; after delete[";
 		int m = size;
 		cerr << m / 1000000 << setfill('0') << "." << setw(3) << (m % 1000000 / 1000) << "." << setw(3) << (m % 1000) << setfill(' ') << " bytes] memory usage: ";
-		m = mem_total;
+		m = state_total();
 		cerr << m / 1000000 << setfill('0') << "." << setw(3) << (m % 1000000 / 1000) << "." << setw(3) << (m % 1000) << setfill(' ') << " bytes" << endl;
 	}
 }
 
-void Mem::state_update(size_t mem_delta) {
-	state_mutex.lock();
-	mem_total += mem_delta;
-	if(mem_total < mem_min)
-		mem_min = mem_total;
-	if(mem_total > mem_max)
-		mem_max = mem_total;
-	state_mutex.unlock();
+// lock-free, min and max are updated only when changed
+static void atomic_update_min(std::atomic<long> &v_min, long value) {
+	long v = v_min.load(std::memory_order_relaxed);
+	while(value < v && !v_min.compare_exchange_weak(v, value, std::memory_order_relaxed));
+}
+
+static void atomic_update_max(std::atomic<long> &v_max, long value) {
+	long v = v_max.load(std::memory_order_relaxed);
+	while(value > v && !v_max.compare_exchange_weak(v, value, std::memory_order_relaxed));
+}
+
+// Deltas are accumulated at per-thread shards and moved to the 'mem_total' by batches, so threads
+// don't contend on the same cache line at each allocation; min and max are accurate within
+// a batch per active shard, and are aggregated with shards on read.
+#define MEM_SHARDS		64
+#define MEM_SHARD_BATCH	(4 * 1024 * 1024)
+
+class alignas(64) MemShard_t {
+public:
+	std::atomic<long> pending{0};
+};
+
+static MemShard_t mem_shards[MEM_SHARDS];
+static std::atomic<int> mem_shards_counter(0);
+static thread_local int mem_shard_index = mem_shards_counter.fetch_add(1) % MEM_SHARDS;
+
+void Mem::state_update(long mem_delta) {
+	MemShard_t &shard = mem_shards[mem_shard_index];
+	const long pending = shard.pending.fetch_add(mem_delta, std::memory_order_relaxed) + mem_delta;
+	if(pending < MEM_SHARD_BATCH && pending > -MEM_SHARD_BATCH)
+		return;
+	const long delta = shard.pending.exchange(0, std::memory_order_relaxed);
+	const long total = mem_total.fetch_add(delta, std::memory_order_relaxed) + delta;
+	if(delta < 0)
+		atomic_update_min(mem_min, total);
+	else
+		atomic_update_max(mem_max, total);
+}
+
+long Mem::state_total(void) {
+	long total = mem_total.load();
+	for(int i = 0; i < MEM_SHARDS; ++i)
+		total += mem_shards[i].pending.load(std::memory_order_relaxed);
+	return total;
+}
+
+void MemTracker::update(long mem_delta) {
+	const long total = _current.fetch_add(mem_delta, std::memory_order_relaxed) + mem_delta;
+	if(mem_delta > 0) {
+		atomic_update_max(_peak, total);
+		_allocated.fetch_add(mem_delta, std::memory_order_relaxed);
+	}
+}
+
+std::shared_ptr<MemTracker> Mem::tracker_set(std::shared_ptr<MemTracker> tracker) {
+	std::shared_ptr<MemTracker> prev = mem_tracker;
+	mem_tracker = tracker;
+	return prev;
 }
 
 void Mem::state_reset(bool _silent) {
-	state_mutex.lock();
 	silent = _silent;
-	mem_start = mem_total;
-	mem_min = mem_total;
-	mem_max = mem_total;
-	state_mutex.unlock();
+	const long total = state_total();
+	mem_start.store(total);
+	mem_min.store(total);
+	mem_max.store(total);
+	MemPool::count_requests.store(0);
+	MemPool::count_hits.store(0);
+	MemPool::bytes_cached_max.store(MemPool::bytes_cached.load());
 }
 
 void Mem::state_print(void) {
 //#ifndef _FORCE_SILENT
-	state_mutex.lock();
+	const long total = state_total();
+	atomic_update_min(mem_min, total);
+	atomic_update_max(mem_max, total);
 	cerr << "__________________________________" << endl;
 	cerr << "Memory statistics:" << endl;
-	cerr << "    at start == " << mem_start / (1024 * 1024) << " Mb;" << endl;
-	cerr << "         min == " << mem_min / (1024 * 1024) << " Mb;" << endl;
-	cerr << "         max == " << mem_max / (1024 * 1024) << " Mb;" << endl;
-	cerr << "     current == " << mem_total / (1024 * 1024) << " Mb;" << endl;
-	cerr << "     --||--  == " << mem_total << " bytes;" << endl;
+	cerr << "    at start == " << mem_start.load() / (1024 * 1024) << " Mb;" << endl;
+	cerr << "         min == " << mem_min.load() / (1024 * 1024) << " Mb;" << endl;
+	cerr << "         max == " << mem_max.load() / (1024 * 1024) << " Mb;" << endl;
+	cerr << "     current == " << total / (1024 * 1024) << " Mb;" << endl;
+	cerr << "     --||--  == " << total << " bytes;" << endl;
+	const long pool_requests = MemPool::count_requests.load();
+	const long pool_hits = MemPool::count_hits.load();
+	cerr << "   pool hits == " << pool_hits << " of " << pool_requests;
+	if(pool_requests != 0)
+		cerr << " (" << (pool_hits * 100) / pool_requests << "%)";
+	cerr << ";" << endl;
+	cerr << " pool cached == " << MemPool::bytes_cached.load() / (1024 * 1024) << " Mb, max == " << MemPool::bytes_cached_max.load() / (1024 * 1024) << " Mb;" << endl;
 	cerr << "==================================" << endl;
-	state_mutex.unlock();
 //#endif
 }
 
 //------------------------------------------------------------------------------
+MemBudget *MemBudget::instance(void) {
+	static MemBudget budget;
+	return &budget;
+}
+
+void MemBudget::set_limit(size_t bytes) {
+	std::unique_lock<std::mutex> lock(budget_lock);
+	_limit = bytes;
+	budget_cv.notify_all();
+}
+
+size_t MemBudget::limit(void) {
+	std::unique_lock<std::mutex> lock(budget_lock);
+	return _limit;
+}
+
+void MemBudget::acquire(size_t size, bool wait) {
+	std::unique_lock<std::mutex> lock(budget_lock);
+	// the only request should be processed anyway
+	while(wait && _limit != 0 && requests != 0 && reserved + size > _limit)
+		budget_cv.wait(lock);
+	reserved += size;
+	++requests;
+}
+
+void MemBudget::acquire_exclusive(size_t size) {
+	std::unique_lock<std::mutex> lock(budget_lock);
+	while(requests != 0)
+		budget_cv.wait(lock);
+	reserved += size;
+	++requests;
+}
+
+void MemBudget::release(size_t size) {
+	std::unique_lock<std::mutex> lock(budget_lock);
+	reserved -= size;
+	--requests;
+	budget_cv.notify_all();
+}
+
+//------------------------------------------------------------------------------
@@ -9,10 +9,29 @@
  *
  */
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <set>
 #include <memory>
 
+//------------------------------------------------------------------------------
+// Accounting of memory allocated by a group of threads, like a processing request;
+// memory is counted until released, even if it was released by another thread.
+class MemTracker {
+public:
+	long current(void) const {return _current.load();}
+	long peak(void) const {return _peak.load();}
+	// total volume of allocations
+	long allocated(void) const {return _allocated.load();}
+	void update(long mem_delta);
+
+protected:
+	std::atomic<long> _current{0};
+	std::atomic<long> _peak{0};
+	std::atomic<long> _allocated{0};
+};
+
 //------------------------------------------------------------------------------
 // aligned memory smart container
 class Mem {
@@ -29,23 +48,54 @@ public:
 	static void state_print(void);
 	void ptr_dump(void);
 
+	// set tracker for allocations of the current thread, return the previous one
+	static std::shared_ptr<MemTracker> tracker_set(std::shared_ptr<MemTracker> tracker);
+
+	// pool of freed buffers; '0' to disable pooling
+	static void pool_set_limit(size_t bytes);
+	static void pool_flush(void);
+
 protected:
 	char *ptr_allocated = nullptr;
 	void *ptr_aligned = nullptr;
 	std::shared_ptr<char> mem_shared_ptr;
 	size_t _mem_size = 0;
 
-	static size_t mem_total;
-	static size_t mem_start;
-	static size_t mem_min;
-	static size_t mem_max;
+	// sum of flushed deltas of shards, see state_update()
+	static std::atomic<long> mem_total;
+	static std::atomic<long> mem_start;
+	static std::atomic<long> mem_min;
+	static std::atomic<long> mem_max;
 	static bool silent;
 	static void register_free(void *ptr, size_t size);
-	static void state_update(size_t mem_delta);
-	static std::mutex state_mutex;
+	static void state_update(long mem_delta);
+	static long state_total(void);
 	static std::mutex ptr_set_lock;
 	static std::set<uintptr_t> ptr_set;
 };
 
+//------------------------------------------------------------------------------
+// Budget of memory for concurrent processing requests (singleton): each request reserves an estimation
+// of its peak memory usage, and waits while it doesn't fit into the budget with the other ones.
+class MemBudget {
+public:
+	static MemBudget *instance(void);
+	void set_limit(size_t bytes);	// '0' - unlimited
+	size_t limit(void);
+	// with 'wait == false' reserve immediately, used for interactive requests
+	void acquire(size_t size, bool wait = true);
+	// wait until there are no other reservations
+	void acquire_exclusive(size_t size);
+	void release(size_t size);
+
+protected:
+	MemBudget(void) {}
+	std::mutex budget_lock;
+	std::condition_variable budget_cv;
+	size_t _limit = 0;
+	size_t reserved = 0;
+	int requests = 0;
+};
+
 //------------------------------------------------------------------------------
 #endif // __H_MEMORY__
@@ -39,6 +39,8 @@ Metadata::Metadata(void) {
 //		demosaic_level_white[i] = 0.0;
 		demosaic_import_prescale[i] = 1.0f;
 		demosaic_signal_max[i] = 0.0f;
+		demosaic_raw_scale[i] = 1.0f;
+		demosaic_raw_black[i] = 0;
 	}
 //	demosaic_black_offset = 0.0;
 
@@ -56,6 +56,10 @@ public:
 	//    where 'signal_max_bl == signal_max * (1.0 - black_offset) + black_offset'; black_offset ~= 1.0 / 16.0;
 	float demosaic_import_prescale[4]; // used fixed order, not related to actual bayer pattern order: red, green_r, blue, green_b
 	float demosaic_signal_max[4]; // maximum value of normalized (to [0.0 - 1.0]) signal w/o prescaling
+	// for 'uint16_p1' mosaic - signal with black level to normalized and prescaled one: '(value - black) * scale',
+	// by position in 2x2 cell: (y % 2) * 2 + (x % 2); black level is kept as pedestal so signal under it isn't clipped
+	float demosaic_raw_scale[4];
+	uint16_t demosaic_raw_black[4];
 	// /|\ - should be removed ???
 
 	// TODO: add support of ICC profiles for CCD sensors
@@ -7,9 +7,16 @@
  *
  */
 
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+
 #include "mt.h"
 #include "system.h"
 
+using namespace std;
+
 //------------------------------------------------------------------------------
 decltype(Flow::run_flows) Flow::run_flows = decltype(Flow::run_flows)();
 std::mutex Flow::run_flows_lock;
@@ -135,20 +142,37 @@ SubFlow::SubFlow(Flow *parent, int _id, int threads_count)
 	_main = (i_id == 0);
 }
 
-SubFlow::~SubFlow() {
-	if(sf_thread != nullptr) {
-		sf_thread->join();
-		delete sf_thread;
+SubFlow::SubFlow(std::mutex *_serial_lock, SubFlow *pause_parent)
+	:_parent(nullptr), i_id(0), i_threads_count(1), serial_lock(_serial_lock) {
+	_main = true;
+	f_ptr = nullptr;
+	f_object = nullptr;
+	f_data = nullptr;
+	if(pause_parent != nullptr) {
+		m_lock = pause_parent->m_lock;
+		cv_pause = pause_parent->cv_pause;
+		b_flag_pause = pause_parent->b_flag_pause;
 	}
 }
 
+SubFlow::~SubFlow() {
+	// release serialized section on exception
+	if(serial_locked)
+		serial_lock->unlock();
+	wait();
+}
+
 void SubFlow::set_private(void **priv_array) {
-	if(_main)
+	if(_parent == nullptr)
+		_target_private = priv_array[0];
+	else if(_main)
 		_parent->set_private(priv_array);
 }
 
 void SubFlow::set_private(void *priv_data, int thread_index) {
-	if(_main || thread_index == i_id)
+	if(_parent == nullptr)
+		_target_private = priv_data;
+	else if(_main || thread_index == i_id)
 		_parent->set_private(priv_data, thread_index);
 }
 
@@ -157,18 +181,51 @@ void *SubFlow::get_private(void) {
 }
 
 void *SubFlow::get_private(int thread_index) {
+	if(_parent == nullptr)
+		return _target_private;
 	return _main ? _parent->get_private(thread_index) : nullptr;
 }
 
+void SubFlow::for_rows(std::atomic_int *y_flow, int rows, const std::function<void(int, int)> &f) {
+	if(_parent == nullptr) {
+		TaskGroup group;
+		group.run_rows(rows, f);
+		group.wait();
+		return;
+	}
+	const int block = rows_block(rows);
+	auto take_rows = [y_flow, rows, block, &f](void) {
+		int y;
+		while((y = y_flow->fetch_add(block)) < rows)
+			f(y, (y + block < rows) ? y + block : rows);
+	};
+	// idle worker can steal a helper and join this thread; if not, helper is popped back at wait and returns at once
+	TaskGroup group;
+	group.run(take_rows);
+	take_rows();
+	group.wait();
+}
+
+void SubFlow::for_rows_own(std::atomic_int *y_flow, int rows, const std::function<void(int, int)> &f) {
+	const int block = (_parent == nullptr) ? rows : rows_block(rows);
+	int y;
+	while((y = y_flow->fetch_add(block)) < rows)
+		f(y, (y + block < rows) ? y + block : rows);
+}
+
+int SubFlow::rows_block(int rows) const {
+	// the same size of blocks at all threads, a few blocks per thread to balance stragglers
+	const int block = rows / (i_threads_count * 4);
+	return (block < 4) ? 4 : block;
+}
+
 void SubFlow::wait(void) {
 	if(i_threads_count == 1)
 		return;
 
-	if(sf_thread != nullptr) {
-		sf_thread->join();
-		delete sf_thread;
-		sf_thread = nullptr;
-	}
+	std::unique_lock<std::mutex> lock(sf_lock);
+	if(sf_running)
+		sf_cv.wait(lock, [this]{return sf_running == false;});
 }
 
 void SubFlow::thread_wrapper(void) {
@@ -191,12 +248,13 @@ void SubFlow::start(void) {
 		return;
 	}
 
-	if(sf_thread != nullptr) {
-		sf_thread->join();
-		delete sf_thread;
-	}
+	wait();
 	if(f_ptr != nullptr) {
-		sf_thread = new std::thread( [=]{ thread_wrapper(); } );
+		sf_lock.lock();
+		sf_running = true;
+		sf_lock.unlock();
+		sf_dispatch_time = std::chrono::steady_clock::now();
+		FlowPool::instance()->dispatch(this);
 	}
 }
 
@@ -213,6 +271,7 @@ void SubFlow::abort() {
 void SubFlow::sync_point(void) {
 	if(i_threads_count == 1)
 		return;
+	TraceSpan trace_span("sync", "sync wait");
 
 	// pause if necessary
 	std::unique_lock<std::mutex> lock(*m_lock);
@@ -259,8 +318,15 @@ void SubFlow::sync_point(void) {
 }
 
 bool SubFlow::sync_point_pre(void) {
-	if(i_threads_count == 1)
+	if(i_threads_count == 1) {
+		pause_point();
+		if(serial_lock != nullptr && !serial_locked) {
+			serial_lock->lock();
+			serial_locked = true;
+		}
 		return true;
+	}
+	TraceSpan trace_span("sync", "sync wait");
 	std::unique_lock<std::mutex> lock(*m_lock);
 
 	// pause if necessary
@@ -318,6 +384,10 @@ bool SubFlow::sync_point_pre(void) {
 }
 
 void SubFlow::sync_point_post(void) {
+	if(serial_locked) {
+		serial_locked = false;
+		serial_lock->unlock();
+	}
 	if(i_threads_count == 1 || i_id != 0)
 		return;
 
@@ -338,4 +408,288 @@ void SubFlow::sync_point_post(void) {
 		cv_out->notify_all();
 }
 
+void SubFlow::pause_point(void) {
+	// don't hold serialized section of the other subflows while paused
+	if(b_flag_pause == nullptr || serial_locked)
+		return;
+	if(b_flag_pause->load() == 0)
+		return;
+	TraceSpan trace_span("sync", "pause");
+	std::unique_lock<std::mutex> lock(*m_lock);
+	cv_pause->wait(lock, [this]{return b_flag_pause->load() == 0;});
+}
+
+//------------------------------------------------------------------------------
+FlowPool *FlowPool::_this = nullptr;
+std::atomic_long FlowPool::stat_dispatched(0);
+std::atomic_long FlowPool::stat_latency_total(0);
+std::atomic_long FlowPool::stat_latency_max(0);
+std::atomic_long FlowPool::stat_spawned(0);
+
+FlowPool *FlowPool::instance(void) {
+	// pool is never destroyed - workers are detached and sleep at application's exit
+	static std::once_flag once;
+	std::call_once(once, []{ _this = new FlowPool(); });
+	return _this;
+}
+
+FlowPool::FlowPool(void) {
+	scheduler = TaskScheduler::instance();
+	// pre-spawn workers enough for one flow with default threads count
+	std::unique_lock<std::mutex> lock(pool_lock);
+	const int cores = System::instance()->cores();
+	for(int i = 0; i < cores; ++i)
+		spawn();
+}
+
+// should be called with locked 'pool_lock'
+void FlowPool::spawn(void) {
+	const int index = threads_total;
+	++threads_total;
+	++threads_idle;
+	++stat_spawned;
+	std::thread(&FlowPool::worker, this, index).detach();
+}
+
+void FlowPool::dispatch(SubFlow *subflow) {
+	std::unique_lock<std::mutex> lock(pool_lock);
+	queue.push_back(subflow);
+	// each queued subflow should get its own worker, otherwise barriers will deadlock
+	while(threads_idle < int(queue.size()))
+		spawn();
+	lock.unlock();
+	cv_queue.notify_one();
+}
+
+void FlowPool::notify_tasks(void) {
+	// lock to not miss worker between the check of predicate and sleep
+	std::unique_lock<std::mutex> lock(pool_lock);
+	lock.unlock();
+	cv_queue.notify_one();
+}
+
+void FlowPool::worker(int index) {
+	// grown workers are w/o own deques, and only steal tasks
+	TaskScheduler::worker_index = (index < scheduler->workers_count()) ? index : -1;
+	std::unique_lock<std::mutex> lock(pool_lock);
+	while(true) {
+		cv_queue.wait(lock, [this]{return !queue.empty() || scheduler->tasks_pending();});
+		if(queue.empty()) {
+			// worker with a task isn't idle, so subflows will spawn new workers instead of waiting for it
+			--threads_idle;
+			lock.unlock();
+			scheduler->run_one();
+			lock.lock();
+			++threads_idle;
+			continue;
+		}
+		SubFlow *subflow = queue.front();
+		queue.pop_front();
+		--threads_idle;
+		lock.unlock();
+
+		long latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - subflow->sf_dispatch_time).count();
+		++stat_dispatched;
+		stat_latency_total += latency;
+		long latency_max = stat_latency_max.load();
+		while(latency > latency_max && !stat_latency_max.compare_exchange_weak(latency_max, latency));
+
+		subflow->thread_wrapper();
+
+		// 'subflow' can be deleted right after notification
+		std::unique_lock<std::mutex> lock_sf(subflow->sf_lock);
+		subflow->sf_running = false;
+		subflow->sf_cv.notify_all();
+		lock_sf.unlock();
+
+		lock.lock();
+		++threads_idle;
+	}
+}
+
+void FlowPool::state_reset(void) {
+	stat_dispatched.store(0);
+	stat_latency_total.store(0);
+	stat_latency_max.store(0);
+}
+
+void FlowPool::state_print(void) {
+	long dispatched = stat_dispatched.load();
+	long latency_avg = (dispatched != 0) ? stat_latency_total.load() / dispatched : 0;
+	int threads = 0;
+	if(_this != nullptr) {
+		std::unique_lock<std::mutex> lock(_this->pool_lock);
+		threads = _this->threads_total;
+	}
+	cerr << "__________________________________" << endl;
+	cerr << "Flow pool statistics:" << endl;
+	cerr << "       threads == " << threads << " (spawned " << stat_spawned.load() << ");" << endl;
+	cerr << "    dispatched == " << dispatched << " subflows;" << endl;
+	cerr << "   latency avg == " << latency_avg << " us;" << endl;
+	cerr << "   latency max == " << stat_latency_max.load() << " us;" << endl;
+	cerr << "==================================" << endl;
+}
+
+//------------------------------------------------------------------------------
+TaskGroup::TaskGroup(void) : tasks_pending(0), tasks_queued(0) {
+}
+
+TaskGroup::~TaskGroup() {
+	// tasks reference the group, so don't leave them behind even on exception
+	try {
+		wait();
+	} catch(...) {
+	}
+}
+
+void TaskGroup::run(std::function<void(void)> f) {
+	TaskScheduler::task_t *task = new TaskScheduler::task_t;
+	task->f = std::move(f);
+	task->group = this;
+	++tasks_pending;
+	TaskScheduler::instance()->submit(task);
+}
+
+void TaskGroup::run_rows(int rows, std::function<void(int, int)> f, int block) {
+	if(rows <= 0)
+		return;
+	if(block <= 0) {
+		// a few blocks per worker to balance stragglers, but not too small ones
+		const int workers = TaskScheduler::instance()->workers_count();
+		block = rows / (workers * 4);
+		if(block < 4)
+			block = 4;
+	}
+	auto shared_f = std::make_shared<std::function<void(int, int)>>(std::move(f));
+	for(int y = 0; y < rows; y += block) {
+		const int y_end = (y + block < rows) ? y + block : rows;
+		run([shared_f, y, y_end]{ (*shared_f)(y, y_end); });
+	}
+}
+
+void TaskGroup::wait(void) {
+	TaskScheduler *scheduler = TaskScheduler::instance();
+	while(tasks_pending.load() != 0) {
+		// help to execute tasks of this group only: a task of other group could be a long offline one,
+		// or could wait for a lock held by the caller
+		if(scheduler->run_one(this))
+			continue;
+		// nothing to take - the rest of tasks are in progress at the other threads, so wait for
+		// the notification from the last one of them, or from a new task of the group
+		std::unique_lock<std::mutex> lock(group_lock);
+		cv_done.wait(lock, [this]{return tasks_pending.load() == 0 || tasks_queued.load() != 0;});
+	}
+	std::unique_lock<std::mutex> lock(group_lock);
+	if(exception != nullptr) {
+		std::exception_ptr e = exception;
+		exception = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+void TaskGroup::task_done(std::exception_ptr e) {
+	std::unique_lock<std::mutex> lock(group_lock);
+	if(e != nullptr && exception == nullptr)
+		exception = e;
+	if(--tasks_pending == 0)
+		cv_done.notify_all();
+}
+
+//------------------------------------------------------------------------------
+TaskScheduler *TaskScheduler::_this = nullptr;
+thread_local int TaskScheduler::worker_index = -1;
+
+TaskScheduler *TaskScheduler::instance(void) {
+	// scheduler is never destroyed, as the pool with its workers
+	static std::once_flag once;
+	std::call_once(once, []{ _this = new TaskScheduler(); });
+	return _this;
+}
+
+// deques for pre-spawned workers of the FlowPool
+TaskScheduler::TaskScheduler(void) : tasks_queued(0), submit_counter(0) {
+	workers_total = System::instance()->cores();
+	if(workers_total < 1)
+		workers_total = 1;
+	for(int i = 0; i < workers_total; ++i)
+		workers.push_back(std::unique_ptr<worker_t>(new worker_t));
+}
+
+void TaskScheduler::submit(task_t *task) {
+	// own deque for workers - to keep data of nested tasks cache-hot, round robin for others
+	int index = worker_index;
+	if(index < 0)
+		index = (submit_counter.fetch_add(1) & 0x7FFFFFFF) % workers_total;
+	worker_t *w = workers[index].get();
+	// count before push, so 'tasks_queued' never goes below zero at pop
+	TaskGroup *group = task->group;
+	++tasks_queued;
+	++group->tasks_queued;
+	w->lock.lock();
+	w->deque.push_back(task);
+	w->lock.unlock();
+	// wake up a thread waiting for the group, if any
+	std::unique_lock<std::mutex> lock(group->group_lock);
+	group->cv_done.notify_all();
+	lock.unlock();
+	FlowPool::instance()->notify_tasks();
+}
+
+TaskScheduler::task_t *TaskScheduler::pop(int index, TaskGroup *group) {
+	task_t *task = nullptr;
+	auto match = [group](const task_t *t){return group == nullptr || t->group == group;};
+	// own tasks - LIFO
+	if(index >= 0) {
+		worker_t *w = workers[index].get();
+		w->lock.lock();
+		auto it = std::find_if(w->deque.rbegin(), w->deque.rend(), match);
+		if(it != w->deque.rend()) {
+			task = *it;
+			w->deque.erase(std::next(it).base());
+		}
+		w->lock.unlock();
+	}
+	// steal - FIFO, i.e. the largest chunks of work first
+	const int start = (index >= 0) ? index + 1 : 0;
+	for(int i = 0; i < workers_total && task == nullptr; ++i) {
+		worker_t *w = workers[(start + i) % workers_total].get();
+		w->lock.lock();
+		auto it = std::find_if(w->deque.begin(), w->deque.end(), match);
+		if(it != w->deque.end()) {
+			task = *it;
+			w->deque.erase(it);
+		}
+		w->lock.unlock();
+	}
+	if(task != nullptr) {
+		--tasks_queued;
+		--task->group->tasks_queued;
+	}
+	return task;
+}
+
+void TaskScheduler::execute(task_t *task) {
+	std::exception_ptr e = nullptr;
+	try {
+		task->f();
+	} catch(...) {
+		e = std::current_exception();
+	}
+	TaskGroup *group = task->group;
+	delete task;
+	group->task_done(e);
+}
+
+bool TaskScheduler::run_one(TaskGroup *group) {
+	if(tasks_queued.load() == 0)
+		return false;
+	if(group != nullptr && group->tasks_queued.load() == 0)
+		return false;
+	task_t *task = pop(worker_index, group);
+	if(task == nullptr)
+		return false;
+	execute(task);
+	return true;
+}
+
 //------------------------------------------------------------------------------
@@ -10,7 +10,12 @@
  */
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -83,6 +88,13 @@ class SubFlow {
 
 public:
 	SubFlow(Flow *parent, int _id, int threads_count);
+	// Standalone single-threaded subflow, w/o parent Flow: all barriers are no-op,
+	// used to run barrier-based code (like FilterProcess_2D::process()) inside of a task.
+	// With 'serial_lock', sections between sync_point_pre() and sync_point_post() are
+	// serialized with other standalone subflows that share the same lock - as those
+	// sections expect to be run only by the 'main' thread (caches preparation etc.).
+	// With 'pause_parent', pause_point() and sync_point_pre() follow pauses of the flow of that subflow.
+	SubFlow(std::mutex *serial_lock = nullptr, SubFlow *pause_parent = nullptr);
 	virtual ~SubFlow();
 
 	bool is_main(void) const {return _main;}
@@ -107,25 +119,45 @@ public:
 	bool sync_point_pre(void);
 	// 'main' thread will wakeup all other threads, and those will do nothing in here
 	void sync_point_post(void);
+	// wait while the flow is paused by a flow with a higher priority; w/o barrier
+	void pause_point(void);
+
+	// Call from all threads, as barriers. Split rows [0, rows) by blocks between threads - 'y_flow' should
+	// be shared and zeroed by the 'main' thread before, idle workers of the TaskScheduler can join them;
+	// or, for the standalone subflow, fork rows blocks as tasks and join them. No barrier on return.
+	// 'f' can be called concurrently from different threads, so it should keep own state per call.
+	void for_rows(std::atomic_int *y_flow, int rows, const std::function<void(int y_begin, int y_end)> &f);
+	// The same, for 'f' with state of the calling thread (like histograms at private data of subflow): rows are
+	// split between threads of the flow only, w/o helpers, and the standalone subflow takes all rows itself.
+	void for_rows_own(std::atomic_int *y_flow, int rows, const std::function<void(int y_begin, int y_end)> &f);
 
 	void wait(void);
 	void start(void);
 
 protected:
+	friend class FlowPool;
 	class abort_exception {};
-	std::thread *sf_thread = nullptr;
+	// 'true' from dispatch to the pool till return of the thread function
+	bool sf_running = false;
+	std::mutex sf_lock;
+	std::condition_variable sf_cv;
+	std::chrono::steady_clock::time_point sf_dispatch_time;
 	void (*f_ptr)(void *, class SubFlow *, void *);
 	void *f_object;
 	void *f_data;
 	// Wrapper for thread function to intercept 'abort' exception
 	// and finish thread's execution in a correct way.
 	void thread_wrapper(void);
+	// size of blocks of rows for 'for_rows()'
+	int rows_block(int rows) const;
 
 	Flow *const _parent;
 	bool _main;
 	const int i_id;
 	const int i_threads_count;
 	void *_target_private = nullptr;
+	std::mutex *serial_lock = nullptr;
+	bool serial_locked = false;
 
 	// shared barrier objects from the parent Flow object
 	std::mutex *m_lock = nullptr;
@@ -143,5 +175,108 @@ protected:
 	std::atomic_int *b_flag_pause = nullptr;
 };
 
+//------------------------------------------------------------------------------
+/*
+ 'FlowPool' keeps process-wide worker threads for 'SubFlow' objects, so Flow::flow()
+ doesn't create and join a new OS thread per subflow. All subflows of one flow
+ should run at the same time (barriers), so pool grows when there are not enough
+ idle workers; grown workers are kept for reuse. Idle workers execute tasks of
+ the TaskScheduler, so there is only one set of threads per process.
+*/
+class FlowPool {
+public:
+	static FlowPool *instance(void);
+	void dispatch(class SubFlow *subflow);
+	// wake up an idle worker for a new task of the TaskScheduler
+	void notify_tasks(void);
+
+	// dispatch latency - time between SubFlow::start() and actual start of the thread function
+	static void state_reset(void);
+	static void state_print(void);
+
+protected:
+	static FlowPool *_this;
+	FlowPool(void);
+	void spawn(void);
+	void worker(int index);
+
+	class TaskScheduler *scheduler;
+	std::mutex pool_lock;
+	std::condition_variable cv_queue;
+	std::deque<class SubFlow *> queue;
+	int threads_total = 0;
+	int threads_idle = 0;
+
+	static std::atomic_long stat_dispatched;
+	static std::atomic_long stat_latency_total;	// microseconds
+	static std::atomic_long stat_latency_max;	// microseconds
+	static std::atomic_long stat_spawned;
+};
+
+//------------------------------------------------------------------------------
+/*
+ 'TaskScheduler' is a work-stealing executor of small tasks: each worker owns a deque,
+ pops own tasks from the back (LIFO) and steals from the front of deques of other workers.
+ Workers are threads of the FlowPool, between subflows. Tasks are grouped with 'TaskGroup'
+ for fork/join; waiting thread executes pending tasks of the same group only, and sleeps when
+ the rest of them are in progress, so nested fork/join (like rows blocks inside of tile task) is OK,
+ and a wait of interactive flow never picks up a long task of other group.
+*/
+class TaskGroup {
+public:
+	TaskGroup(void);
+	~TaskGroup();
+	void run(std::function<void(void)> f);
+	// split [0, rows) into blocks of 'block' rows, or of reasonable size if 'block' <= 0
+	void run_rows(int rows, std::function<void(int y_begin, int y_end)> f, int block = 0);
+	// rethrow the first exception from tasks if any (like Area::bad_alloc)
+	void wait(void);
+
+protected:
+	friend class TaskScheduler;
+	void task_done(std::exception_ptr exception);
+	std::atomic_int tasks_pending;
+	std::atomic_int tasks_queued;	// submitted, but not taken by any thread yet
+	std::mutex group_lock;
+	std::condition_variable cv_done;
+	std::exception_ptr exception = nullptr;
+};
+
+class TaskScheduler {
+public:
+	static TaskScheduler *instance(void);
+	int workers_count(void) const {return workers_total;}
+	bool tasks_pending(void) const {return tasks_queued.load() > 0;}
+	// execute one pending task, if any, from the calling thread; of the 'group' only if not 'nullptr'
+	bool run_one(class TaskGroup *group = nullptr);
+
+protected:
+	friend class TaskGroup;
+	friend class FlowPool;
+	class task_t {
+	public:
+		std::function<void(void)> f;
+		TaskGroup *group;
+	};
+	class worker_t {
+	public:
+		std::mutex lock;
+		std::deque<task_t *> deque;
+	};
+
+	static TaskScheduler *_this;
+	TaskScheduler(void);
+	void submit(task_t *task);
+	task_t *pop(int index, TaskGroup *group);
+	void execute(task_t *task);
+
+	int workers_total = 0;
+	std::vector<std::unique_ptr<worker_t>> workers;
+	std::atomic_int tasks_queued;
+	std::atomic_int submit_counter;
+	// index of the worker's deque for the current thread, or '-1' for threads w/o own deque
+	static thread_local int worker_index;
+};
+
 //------------------------------------------------------------------------------
 #endif // __H_MT__
@@ -92,7 +92,13 @@ PS_Loader::PS_Loader(Photo_ID photo_id) {
 		load(photo_id, true);
 }
 
-void PS_Loader::load(Photo_ID photo_id, bool use_lock) {
+PS_Loader::PS_Loader(Photo_ID photo_id, std::string fname_ps) {
+	cw_rotation = 0;
+	_cw_rotation_empty = true;
+	load(photo_id, false, fname_ps);
+}
+
+void PS_Loader::load(Photo_ID photo_id, bool use_lock, std::string fname_ps) {
 	string file_name = photo_id.get_file_name();
 	string lock_name = file_name;
 	std::unique_lock<std::mutex> locker(ps_lock, std::defer_lock);
@@ -101,7 +107,10 @@ void PS_Loader::load(Photo_ID photo_id, bool use_lock) {
 	//--
 	_is_empty = false;
 	int v_index = photo_id.get_version_index();
-	file_name += PS_SETTINGS_EXT;
+	if(fname_ps == "")
+		file_name += PS_SETTINGS_EXT;
+	else
+		file_name = fname_ps;
 	QFile qifile(file_name.c_str());
 	if(qifile.open(QFile::ReadOnly | QFile::Text)) {
 		QXmlStreamReader xml(&qifile);
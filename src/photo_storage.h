@@ -33,6 +33,8 @@ public:
 class PS_Loader {
 public:
 	PS_Loader(Photo_ID photo_id = Photo_ID());
+	// load settings of photo version from the file 'fname_ps' instead of the photo's own one
+	PS_Loader(Photo_ID photo_id, std::string fname_ps);
 	~PS_Loader();
 	void save(Photo_ID photo_id);
 
@@ -62,7 +64,7 @@ protected:
 	int cw_rotation;
 	bool _cw_rotation_empty;
 
-	void load(Photo_ID photo_id, bool use_lock);
+	void load(Photo_ID photo_id, bool use_lock, std::string fname_ps = "");
 	void save(QXmlStreamWriter &xml, int v_index);
 
 	static void lock(std::string file_name, std::unique_lock<std::mutex> &mutex_locker);
@@ -19,6 +19,7 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 
@@ -146,6 +147,25 @@ public:
 	TilesDescriptor_t *tiles_request = nullptr;
 	int tile_index = -1;
 
+	// tile-per-thread mode
+	std::mutex tiles_serial_lock;		// for 'main'-only parts of filters and TilesReceiver calls
+	std::set<int> tiles_processed;		// covered with 'tiles_request->index_list_lock'
+	std::atomic_bool tiles_bad_alloc{false};
+
+	// memory allocated by the request, and the stage where was reached the peak of it
+	std::shared_ptr<MemTracker> mem_tracker;
+	long mem_peak = 0;
+	std::string mem_peak_stage;
+	// should be called at 'main' only
+	void mem_peak_check(const std::string &stage) {
+		const long peak = mem_tracker->peak();
+		if(peak > mem_peak) {
+			mem_peak = peak;
+			mem_peak_stage = stage;
+		}
+		if(Trace::enabled())
+			Trace::counter("memory", "\"current\":" + std::to_string(mem_tracker->current()) + ",\"allocated\":" + std::to_string(mem_tracker->allocated()));
+	}
 };
 
 //------------------------------------------------------------------------------
@@ -156,6 +176,8 @@ public:
 
 	class FilterProcess *cache_fp_for_second_pass = nullptr;
 	std::shared_ptr<Area> cached_area_for_second_pass; // could hold Area from 'filters_area_cache'
+	FP_CP_LUT_Cache_t cp_lut_cache; // preview 3D LUT of tiled CP filters chain
+	FP_GP_Coordinates_Cache_t gp_coordinates_cache; // traced coordinates of tiles for GP filters
 
 	void local_clear(void); // release pass-between area cache ASAP
 };
@@ -243,7 +265,10 @@ void Process::wrap_filters(const std::vector<filter_record_t> &filters, task_run
 //cerr << "create a new GP wrapper" << endl;
 				gp_wrapper_resampling_force = false;
 				filter_record_t r;
-				r.wrapper_holder.reset(new FilterProcess_GP_Wrapper(gp_wrapper_records));
+				FilterProcess_GP_Wrapper *gp_wrapper = new FilterProcess_GP_Wrapper(gp_wrapper_records);
+				if(pass == 1)
+					gp_wrapper->set_coordinates_cache(&process_cache->gp_coordinates_cache);
+				r.wrapper_holder.reset(gp_wrapper);
 				gp_wrapper_records.clear();
 				r.filter = nullptr;
 				r.fp = r.wrapper_holder.get();
@@ -254,7 +279,10 @@ void Process::wrap_filters(const std::vector<filter_record_t> &filters, task_run
 			// create a new CP wrapper
 			if(cp_wrapper_records.size() > 0 && filter_type != FilterProcess::fp_type_cp) {
 				filter_record_t r;
-				r.wrapper_holder.reset(new FilterProcess_CP_Wrapper(cp_wrapper_records));
+				FilterProcess_CP_Wrapper *cp_wrapper = new FilterProcess_CP_Wrapper(cp_wrapper_records);
+				if(pass == 1)
+					cp_wrapper->set_lut_cache(&process_cache->cp_lut_cache);
+				r.wrapper_holder.reset(cp_wrapper);
 				cp_wrapper_records.clear();
 				r.filter = nullptr;
 				r.fp = r.wrapper_holder.get();
@@ -355,18 +383,43 @@ bool Process::process_edit(void *ptr, std::shared_ptr<Photo_t> photo, int reques
 //------------------------------------------------------------------------------
 // Helper for 'export'.
 // Should be moved somewhere outside.
-bool Process::process_export(Photo_ID photo_id, string fname_export, export_parameters_t *ep) {
+bool Process::process_export(Photo_ID photo_id, string fname_export, export_parameters_t *ep, long *mem_peak, string fname_ps) {
 	if(photo_id.is_empty())
 		return false;
 
 	Profiler prof(string("Batch for ") + photo_id.get_export_file_name());
 	prof.mark("export");
+	std::unique_ptr<Export_job_t> job = export_load(photo_id, fname_export, ep, fname_ps);
+	export_process(job.get());
+	if(mem_peak != nullptr)
+		*mem_peak = job->process_task.mem_peak;
+	const bool result = export_save(job.get());
+	prof.mark("");
+	return result;
+}
+
+Export_job_t::Export_job_t(void) {
+}
 
-	std::shared_ptr<Photo_t> photo(new Photo_t());
+Export_job_t::~Export_job_t() {
+}
+
+// Load filter settings and import photo.
+std::unique_ptr<Export_job_t> Process::export_load(Photo_ID photo_id, string fname_export, export_parameters_t *ep, string fname_ps, std::shared_ptr<Photo_t> photo_warm) {
+	std::unique_ptr<Export_job_t> job(new Export_job_t());
+	job->time_start = std::chrono::steady_clock::now();
+	job->photo_id = photo_id;
+	job->fname_export = fname_export;
+	job->ep = ep;
+	job->keep_photo = (photo_warm != nullptr);
+
+	std::shared_ptr<Photo_t> photo = photo_warm;
+	if(photo == nullptr)
+		photo = std::shared_ptr<Photo_t>(new Photo_t());
 	photo->process_source = ProcessSource::s_process_export;
 	photo->photo_id = photo_id;
 
-	Process_task_t process_task;
+	Process_task_t &process_task = job->process_task;
 	process_task.photo = photo;
 	process_task.request_ID = Process::newID();
 
@@ -375,6 +428,9 @@ bool Process::process_export(Photo_ID photo_id, string fname_export, export_para
 		Filter_process_desc_t desc{el};
 		desc.use_tiling = false;
 		desc.cache_result = false;
+		// keep results for the next exports of the same photo
+		if(job->keep_photo && (el->get_id() == ProcessSource::s_wb || el->get_id() == ProcessSource::s_demosaic))
+			desc.cache_result = true;
 		filters_desc.push_back(desc);
 	}
 	for(auto el : fstore->get_filters_tiled()) {
@@ -394,7 +450,7 @@ bool Process::process_export(Photo_ID photo_id, string fname_export, export_para
 		process_task.out_format = ((ep_bits == 16) ? Area::format_t::rgb_16 : Area::format_t::rgb_8);
 
 	// load filter settings
-	std::unique_ptr<PS_Loader> ps_loader(new PS_Loader(photo_id));
+	std::unique_ptr<PS_Loader> ps_loader((fname_ps == "") ? new PS_Loader(photo_id) : new PS_Loader(photo_id, fname_ps));
 	if(!ps_loader->cw_rotation_empty())
 		photo->cw_rotation = ps_loader->get_cw_rotation();
 	else {
@@ -404,12 +460,11 @@ bool Process::process_export(Photo_ID photo_id, string fname_export, export_para
 		photo->cw_rotation = metadata.rotation;
 		ps_loader->set_cw_rotation(photo->cw_rotation);
 	}
-	std::unique_ptr<TilesReceiver> tiles_receiver;
 	if(ep->scaling_force)
-		tiles_receiver = std::unique_ptr<TilesReceiver>(new TilesReceiver(!ep->scaling_to_fill, ep->scaling_width, ep->scaling_height));
+		job->tiles_receiver = std::unique_ptr<TilesReceiver>(new TilesReceiver(!ep->scaling_to_fill, ep->scaling_width, ep->scaling_height));
 	else
-		tiles_receiver = std::unique_ptr<TilesReceiver>(new TilesReceiver());
-	process_task.tiles_receiver = tiles_receiver.get();
+		job->tiles_receiver = std::unique_ptr<TilesReceiver>(new TilesReceiver());
+	process_task.tiles_receiver = job->tiles_receiver.get();
 	process_task.tiles_receiver->use_tiling(true, photo->cw_rotation, process_task.out_format);
 	process_task.tiles_receiver->set_request_ID(process_task.request_ID);
 
@@ -421,29 +476,87 @@ bool Process::process_export(Photo_ID photo_id, string fname_export, export_para
 		ps->load(dataset);
 		map_ps_base[filter] = std::move(std::shared_ptr<PS_Base>(ps));
 	}
+	// cached results of warm photo are valid only with the same settings of filters up to the last cached one;
+	// caches of other filters follow settings changes by themselves, as at interactive editing
+	if(job->keep_photo) {
+		size_t cached_end = 0;
+		for(size_t i = 0; i < filters_desc.size(); ++i)
+			if(filters_desc[i].cache_result)
+				cached_end = i + 1;
+		string ps_state;
+		for(size_t i = 0; i < cached_end; ++i) {
+			const string id = filters_desc[i].filter->id();
+			ps_state += id + "\n" + ps_loader->get_dataset(id)->serialize() + "\n";
+		}
+		if(photo->ps_state != ps_state && photo->cache_process != nullptr) {
+			delete photo->cache_process;
+			photo->cache_process = nullptr;
+		}
+		photo->ps_state = ps_state;
+	}
 	ps_loader.reset();
 
-	Process::process(&process_task);
-	photo->area_raw.reset();
+	// import; on fail, Process::process() will try again and report the failure
+	process_task.mem_tracker.reset(new MemTracker());
+	std::shared_ptr<MemTracker> mem_tracker_prev = Mem::tracker_set(process_task.mem_tracker);
+	if(photo->area_raw == nullptr) {
+		try {
+			if(photo->metadata == nullptr)
+				photo->metadata = new Metadata;
+			TraceSpan trace_import("stage", "import");
+			photo->area_raw = std::unique_ptr<Area>(Import::image(photo_id.get_file_name(), photo->metadata));
+		} catch(Area::bad_alloc) {
+			photo->area_raw.reset();
+		} catch(std::bad_alloc) {
+			photo->area_raw.reset();
+		}
+	}
+	Mem::tracker_set(mem_tracker_prev);
+	return job;
+}
+
+bool Process::export_process(Export_job_t *job) {
+	const bool result = Process::process(&job->process_task);
+	if(!job->keep_photo)
+		job->process_task.photo->area_raw.reset();
+	return result;
+}
 
+bool Process::export_save(Export_job_t *job) {
+	Process_task_t &process_task = job->process_task;
 	if(process_task.failed) {
 		if(process_task.failed_oom) {
 			OOM_desc_t *OOM_desc = new OOM_desc_t;
-			OOM_desc->photo_id = photo->photo_id;
+			OOM_desc->photo_id = job->photo_id;
 			OOM_desc->at_export = false;
 			OOM_desc->at_open_stage = process_task.failed_at_import;
 			emit signal_OOM_notification((void *)OOM_desc);
 		}
-	} else {
-		Export::export_photo(fname_export, tiles_receiver->area_image, tiles_receiver->area_thumb, ep, photo->cw_rotation, photo->metadata);
+		return false;
 	}
-	prof.mark("");
-	return !process_task.failed;
+	TilesReceiver *tiles_receiver = job->tiles_receiver.get();
+	TraceSpan trace_export("stage", "export");
+	Export::export_photo(job->fname_export, tiles_receiver->area_image, tiles_receiver->area_thumb, job->ep, process_task.photo->cw_rotation, process_task.photo->metadata);
+	trace_export.end();
+	// throughput and memory usage of the whole export, for benchmarks
+	if(Trace::enabled()) {
+		const long time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job->time_start).count();
+		const Area::t_dimensions *d_image = tiles_receiver->area_image->dimensions();
+		const double mpx = double(d_image->width()) * d_image->height() / 1000000.0;
+		const double mpx_per_sec = (time_ms > 0) ? mpx * 1000.0 / time_ms : 0.0;
+		Trace::counter("export", "\"mpx_per_sec\":" + std::to_string(mpx_per_sec) + ",\"memory_peak\":" + std::to_string(process_task.mem_peak));
+	}
+	Trace::flush();
+	// release the result right now
+	job->tiles_receiver.reset();
+	process_task.tiles_receiver = nullptr;
+	return true;
 }
 
 //------------------------------------------------------------------------------
 bool Process::process(Process_task_t *process_task) {
 	ID_add(process_task->request_ID);
+	TraceSpan trace_process("stage", "process " + process_task->photo->photo_id.get_export_file_name());
 
 	Process::task_run_t task;
 	task.request_ID = process_task->request_ID;
@@ -452,16 +565,24 @@ bool Process::process(Process_task_t *process_task) {
 	task.out_format = process_task->out_format;
 	task.is_offline = process_task->is_offline;
 	task.tiles_receiver = process_task->tiles_receiver;
+	task.mem_tracker = process_task->mem_tracker;
+	if(task.mem_tracker == nullptr)
+		task.mem_tracker.reset(new MemTracker());
+	std::shared_ptr<MemTracker> mem_tracker_prev = Mem::tracker_set(task.mem_tracker);
+	// photo was imported already by the export pipeline
+	if(process_task->mem_tracker != nullptr && task.photo->area_raw != nullptr)
+		task.mem_peak_check("import");
 
 	// import photo if necessary
 	bool bad_alloc = false;
 	bool import = false;
 	import |= (task.photo->process_source == ProcessSource::s_load);
-	import |= (task.photo->process_source == ProcessSource::s_process_export);
+	import |= (task.photo->process_source == ProcessSource::s_process_export && task.photo->area_raw == nullptr);
 	if(import || task.photo->area_raw == nullptr) {
 		try {
 			if(task.photo->metadata == nullptr)
 				task.photo->metadata = new Metadata;
+			TraceSpan trace_import("stage", "import");
 			task.photo->area_raw = std::unique_ptr<Area>(Import::image(task.photo->photo_id.get_file_name(), task.photo->metadata));
 		} catch(Area::bad_alloc) {
 			bad_alloc = true;
@@ -474,9 +595,11 @@ bool Process::process(Process_task_t *process_task) {
 			process_task->failed_at_import = true;
 cerr << "decline processing task, failed to import \"" << task.photo->photo_id.get_export_file_name() << "\"" << endl;
 			ID_remove(process_task->request_ID);
+			Mem::tracker_set(mem_tracker_prev);
 			return false;
 		}
 		task.update = false;
+		task.mem_peak_check("import");
 	}
 
 	// prepare filters list
@@ -493,19 +616,56 @@ cerr << "decline processing task, failed to import \"" << task.photo->photo_id.g
 	allocate_process_caches(filter_records, task.photo);
 	wrap_filters(filter_records, &task);
 
+	// fit into the memory budget: decrease tiles of offline processing, and wait for other requests if necessary
+	TilesReceiver *tiles_receiver = process_task->tiles_receiver;
+	const int tile_length_min = TILES_MIN_SIZE * 4;
+	int tile_length = tiles_receiver->get_offline_tile_length();
+	// estimation traces sizes through all filters, so skip it when there is nothing to fit into:
+	// w/o the budget, and for interactive requests - they are processed at once anyway, with small tiles
+	size_t mem_estimate = 0;
+	const size_t mem_limit = MemBudget::instance()->limit();
+	if(task.is_offline && mem_limit != 0) {
+		mem_estimate = mem_budget_estimate(&task, tile_length);
+		while(mem_estimate > mem_limit && tile_length / 2 >= tile_length_min) {
+			tile_length /= 2;
+			mem_estimate = mem_budget_estimate(&task, tile_length);
+		}
+		tiles_receiver->set_offline_tile_length(tile_length);
+	}
+	// with budget reserved by the caller before import (export pipeline), reserve the rest w/o wait -
+	// waiting for reservations of the next photos in pipeline would be a deadlock
+	const size_t mem_reserved = process_task->mem_reserved;
+	size_t mem_acquired = (mem_estimate > mem_reserved) ? mem_estimate - mem_reserved : 0;
+	MemBudget::instance()->acquire(mem_acquired, task.is_offline && mem_reserved == 0);
+
 	// apply filters
-	bad_alloc = false;
-	try {
-		Flow flow(process_task->priority, Process::subflow_run_mt, nullptr, (void *)&task);
-		flow.flow();
-		bad_alloc = task.bad_alloc;
-	} catch(Area::bad_alloc) {
-		bad_alloc = true;
-	} catch(std::bad_alloc) {
-		bad_alloc = true;
+	bad_alloc = run_flow(process_task, &task);
+	if(bad_alloc && task.is_offline && tile_length > tile_length_min) {
+		// don't lose export - try again alone, with the smallest tiles and w/o cached memory
+cerr << "out of memory at processing of \"" << task.photo->photo_id.get_export_file_name() << "\", try again with the smallest tiles" << endl;
+		MemBudget::instance()->release(mem_acquired);
+		Mem::pool_flush();
+		tile_length = tile_length_min;
+		tiles_receiver->set_offline_tile_length(tile_length);
+		mem_estimate = (mem_limit != 0) ? mem_budget_estimate(&task, tile_length) : 0;
+		mem_acquired = (mem_estimate > mem_reserved) ? mem_estimate - mem_reserved : 0;
+		if(mem_reserved == 0)
+			MemBudget::instance()->acquire_exclusive(mem_acquired);
+		else
+			MemBudget::instance()->acquire(mem_acquired, false);
+		task.bad_alloc = false;
+		task.to_abort = false;
+		bad_alloc = run_flow(process_task, &task);
 	}
+	MemBudget::instance()->release(mem_acquired);
 
 	ID_remove(task.request_ID);
+	Mem::tracker_set(mem_tracker_prev);
+	task.mem_peak_check("convert tiles");
+	process_task->mem_peak = task.mem_peak;
+	process_task->mem_peak_stage = task.mem_peak_stage;
+	if(Trace::enabled())
+		Trace::counter("memory peak", "\"" + task.mem_peak_stage + "\":" + std::to_string(task.mem_peak));
 
 	if(bad_alloc) {
 		process_task->failed = true;
@@ -517,9 +677,85 @@ cerr << "decline processing task, failed to import \"" << task.photo->photo_id.g
 	return true;
 }
 
+// Return 'true' on OOM.
+bool Process::run_flow(Process_task_t *process_task, Process::task_run_t *task) {
+	bool bad_alloc = false;
+	try {
+		Flow flow(process_task->priority, Process::subflow_run_mt, nullptr, (void *)task);
+		flow.flow();
+		bad_alloc = task->bad_alloc;
+	} catch(Area::bad_alloc) {
+		bad_alloc = true;
+	} catch(std::bad_alloc) {
+		bad_alloc = true;
+	}
+	return bad_alloc;
+}
+
+// Estimation of the peak memory usage of the request, for the memory budget:
+//  - 'whole' filters (demosaic etc.) - input and output areas of the whole photo, and results cached for the next requests;
+//  - tiles - input area of the whole photo, result image with size after ::size_forward() and scaling of export,
+//    and tiles at each thread with edges asked by filters via ::size_backward().
+size_t Process::mem_budget_estimate(Process::task_run_t *task, int tile_length) {
+	const Area::t_dimensions *d_raw = task->photo->area_raw->dimensions();
+	const size_t pixels = size_t(d_raw->size.w) * d_raw->size.h;
+	const size_t px_size = Area::type_to_sizeof(Area::type_t::float_p4);
+	const size_t area_whole = pixels * px_size;
+	Area *area_raw = task->photo->area_raw.get();
+	const size_t mem_raw = size_t(area_raw->mem_width()) * area_raw->mem_height() * area_raw->type_to_sizeof();
+
+	int cached_count = 0;
+	for(auto &el : task->filter_records[0])
+		if(!el.use_tiling && el.cache_result)
+			++cached_count;
+	size_t area_cached = area_whole;
+	if(!task->is_offline && System::instance()->half_float_cache())
+		area_cached = pixels * Area::type_to_sizeof(Area::type_t::half_p4);
+	const size_t mem_whole = mem_raw + area_whole * 2 + area_cached * cached_count;
+
+	// result image, as in ::run_mt()
+	DataSet mutators_forward;
+	DataSet mutators_forward_multipass;
+	mutators_forward.set("_p_thumb", false);
+	DataSet *task_mutators = task->mutators;
+	DataSet *task_mutators_multipass = task->mutators_multipass;
+	task->mutators = &mutators_forward;
+	task->mutators_multipass = &mutators_forward_multipass;
+	Area::t_dimensions d_forward;
+	process_size_forward(d_forward, task, task->filter_records[0], area_raw->dimensions());
+	task->mutators = task_mutators;
+	task->mutators_multipass = task_mutators_multipass;
+	Area::t_dimensions d_result = d_forward;
+	if(task->tiles_receiver != nullptr)
+		d_result = task->tiles_receiver->scaled_dimensions(&d_forward, task->photo->cw_rotation);
+	const size_t pixels_result = size_t(d_result.width()) * d_result.height();
+
+	// the biggest area of the tile at filters chain
+	DataSet mutators;
+	DataSet mutators_multipass;
+	Area::t_dimensions d_tile(tile_length, tile_length);
+	d_tile.position.px_size_x = d_result.position.px_size_x;
+	d_tile.position.px_size_y = d_result.position.px_size_y;
+	d_tile.position._x_max = d_raw->size.w * 0.5;
+	d_tile.position._y_max = d_raw->size.h * 0.5;
+	d_tile.position.x = -tile_length * d_tile.position.px_size_x * 0.5;
+	d_tile.position.y = -tile_length * d_tile.position.px_size_y * 0.5;
+	Tile_t tile;
+	size_backward_tile(task, task->filter_records[1], d_tile, &tile, &mutators, &mutators_multipass);
+	size_t tile_pixels = size_t(tile_length) * tile_length;
+	for(auto &el : tile.fp_position)
+		tile_pixels = std::max(tile_pixels, size_t(el.second.width) * el.second.height);
+	tile_pixels = std::min(tile_pixels, pixels);
+	// input and output of the filter, at each thread
+	const size_t mem_tiles = area_whole + pixels_result * Area::type_to_sizeof(Area::type_for_format(task->out_format)) + tile_pixels * px_size * 2 * System::instance()->cores();
+
+	return std::max(mem_whole, mem_tiles);
+}
+
 //------------------------------------------------------------------------------
 void Process::subflow_run_mt(void *obj, SubFlow *subflow, void *data) {
 	bool bad_alloc = false;
+	std::shared_ptr<MemTracker> mem_tracker_prev = Mem::tracker_set(((task_run_t *)data)->mem_tracker);
 	try {
 		run_mt(subflow, data);
 	} catch(Area::bad_alloc) {
@@ -537,6 +773,7 @@ void Process::subflow_run_mt(void *obj, SubFlow *subflow, void *data) {
 		task_run_t *task = (task_run_t *)data;
 		((ProcessCache_t *)task->photo->cache_process)->local_clear();
 	}
+	Mem::tracker_set(mem_tracker_prev);
 }
 
 //------------------------------------------------------------------------------
@@ -754,6 +991,7 @@ void Process::run_mt(SubFlow *subflow, void *data) {
 		prof->mark("");
 		delete prof;
 		Mem::state_print();
+		FlowPool::state_print();
 //		Mem::state_reset();
 		// remove inter-pass caches if any
 		process_cache->local_clear();
@@ -815,7 +1053,6 @@ cerr << endl;
 //------------------------------------------------------------------------------
 void Process::process_size_backward(Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, const Area::t_dimensions &target_dimensions) {
 	Area::t_dimensions d_in;
-	Area::t_dimensions d_out;
 	TilesDescriptor_t *tiles_request = task->tiles_request;
 /*
 cerr << "Process::process_size_backward(),  in geometry:" << endl;
@@ -823,65 +1060,63 @@ cerr << "      size: " << tiles_request->post_width << "-" << tiles_request->pos
 cerr << "   px_size: " << tiles_request->scale_factor_x << "-" << tiles_request->scale_factor_y << endl;
 cerr << "  position: " << target_dimensions.position.x << "-" << target_dimensions.position.y << endl;
 */
-	for(unsigned i = 0; i < tiles_request->tiles.size() + 1; ++i) {
-		// actually, tiles coordinates and edges flags (outer|inner) was prepared in tiles_request, nothing to do here
-//cerr << endl << "....................................................................." << "process_size_backward(); iteration == " << i << endl;
-		if(i == 0) {
-			// 1:1 size
-			d_in = Area::t_dimensions(tiles_request->post_width, tiles_request->post_height);
-			d_in.position = target_dimensions.position;
-		} else {
-			// tiles
-			d_in = tiles_request->tiles[i - 1].dimensions_post;
-		}
-		// backward
-		auto it = pl_filters.end();
-		if(it != pl_filters.begin()) {
-			do {
-				--it;
-				FP_size_t fp_size((*it).ps_base.get());
-				fp_size.metadata = task->photo->metadata;
-				fp_size.mutators = task->mutators;
-				fp_size.mutators_multipass = task->mutators_multipass;
-				fp_size.cw_rotation = task->photo->cw_rotation;
-				d_out = d_in;
-				if(i > 0) {
-					// cache position and size of dimensions_after so at process time we can send exactly dimensions that are expecting by next filters and tiles receiver
-					Tile_t::t_position tp;
-					tp.x = d_in.position.x;
-					tp.y = d_in.position.y;
-					tp.width = d_in.width();
-					tp.height = d_in.height();
-					tp.px_size_x = d_in.position.px_size_x;
-					tp.px_size_y = d_in.position.px_size_y;
-					tiles_request->tiles[i - 1].fp_position[(*it).fp_2d->name()] = tp;
-				}
-				// allow edit mode for online processing
-				if(!task->is_offline) {
-					fp_size.filter = (*it).filter;
-				}
-				(*it).fp_2d->size_backward(&fp_size, &d_out, &d_in);
-				d_in = d_out;
-			} while(it != pl_filters.begin());
-		} else {
-			d_out = d_in;
-		}
-		// store result
-		if(i == 0) {
-			// i.e. 1:1 size
-/*
-cerr << "Process::process_size_backward(), out geometry:" << endl;
-cerr << "      size: " << d_out.size.w << " - " << d_out.size.h << endl;
-cerr << "   px_size: " << d_out.position.px_size_x << " - " << d_out.position.px_size_y << endl;
-cerr << "  position: " << d_out.position.x << ", " << d_out.position.y << endl;
-*/
-		} else {
-			tiles_request->tiles[i - 1].dimensions_pre = d_out;
-		}
+	// 1:1 size
+	d_in = Area::t_dimensions(tiles_request->post_width, tiles_request->post_height);
+	d_in.position = target_dimensions.position;
+	size_backward_tile(task, pl_filters, d_in, nullptr, task->mutators, task->mutators_multipass);
+	// tiles
+	// actually, tiles coordinates and edges flags (outer|inner) was prepared in tiles_request, nothing to do here
+	for(unsigned i = 0; i < tiles_request->tiles.size(); ++i) {
+		Tile_t *tile = &tiles_request->tiles[i];
+		tile->dimensions_pre = size_backward_tile(task, pl_filters, tile->dimensions_post, tile, task->mutators, task->mutators_multipass);
 	}
 //cerr << endl << "====================================================" << "process_size_backward() - return" << endl;
 }
 
+// Return input dimensions for desired output ones; if 'tile' is not nullptr, cache position and size of
+// dimensions_after of each filter, so at process time we can send exactly dimensions that are expecting by next filters and tiles receiver
+Area::t_dimensions Process::size_backward_tile(Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, const Area::t_dimensions &d_post, Tile_t *tile, DataSet *mutators, DataSet *mutators_multipass) {
+	Area::t_dimensions d_in = d_post;
+	Area::t_dimensions d_out = d_in;
+	auto it = pl_filters.end();
+	while(it != pl_filters.begin()) {
+		--it;
+		FP_size_t fp_size((*it).ps_base.get());
+		fp_size.metadata = task->photo->metadata;
+		fp_size.mutators = mutators;
+		fp_size.mutators_multipass = mutators_multipass;
+		fp_size.cw_rotation = task->photo->cw_rotation;
+		d_out = d_in;
+		if(tile != nullptr) {
+			Tile_t::t_position tp;
+			tp.x = d_in.position.x;
+			tp.y = d_in.position.y;
+			tp.width = d_in.width();
+			tp.height = d_in.height();
+			tp.px_size_x = d_in.position.px_size_x;
+			tp.px_size_y = d_in.position.px_size_y;
+			tile->fp_position[(*it).fp_2d->name()] = tp;
+		}
+		// allow edit mode for online processing
+		if(!task->is_offline)
+			fp_size.filter = (*it).filter;
+		(*it).fp_2d->size_backward(&fp_size, &d_out, &d_in);
+		d_in = d_out;
+	}
+	return d_out;
+}
+
+//------------------------------------------------------------------------------
+// Results of 'whole' filters are kept between requests, so keep them as 'half_p4' if asked - but only
+// for the interactive preview: the second pass of export reads the cache, and should be of full precision.
+std::shared_ptr<Area> Process::area_to_cache(Area *area, bool is_offline) {
+	if(!is_offline && System::instance()->half_float_cache() && area->type() == Area::type_t::float_p4) {
+		SubFlow subflow;
+		return std::shared_ptr<Area>(AreaHelper::convert_to_half(&subflow, area).release());
+	}
+	return std::shared_ptr<Area>(new Area(*area));
+}
+
 //------------------------------------------------------------------------------
 void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, bool is_thumb, Profiler *prof) {
 	TilesDescriptor_t *tiles_request = task->tiles_request;
@@ -892,6 +1127,29 @@ void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::
 //	const bool allow_destructive = false;
 	std::set<int> tiles_processed;	// used with disabled tiling
 	bool was_abortion = false;
+
+	// Tile-per-thread mode is possible only if all filters are 'tiled' ones, otherwise
+	// 'whole' filters (like demosaic) need all threads on the same (and the only) tile.
+	if(!is_thumb && System::instance()->tiles_parallel() && tiles_request->tiles.size() > 1) {
+		bool all_tiled = true;
+		for(auto &el : pl_filters)
+			all_tiled &= el.use_tiling;
+		if(all_tiled) {
+			process_filters_tiles_parallel(subflow, task, pl_filters, prof);
+			return;
+		}
+	}
+
+	// 'half_p4' cache is converted back to 'float_p4' at once, or by each stripe at fused processing
+	std::unique_ptr<Area> area_original_float;
+	if(area_original->type() == Area::type_t::half_p4 && (is_thumb || System::instance()->stripe_size() <= 0)) {
+		area_original_float = AreaHelper::convert_to_float(subflow, area_original);
+		if(is_main)
+			task->area_transfer = area_original_float.get();
+		subflow->sync_point();
+		area_original = task->area_transfer;
+	}
+
 	while(true) {
 		// cycle of tiles
 		// for improved interactivity of UI, it's better to always update thumb
@@ -932,9 +1190,41 @@ void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::
 
 		//-- process tile
 		Tile_t *tile = &tiles_request->tiles[index];
+		TraceSpan trace_tile("tile", is_thumb ? "thumb" : "tile");
+		trace_tile.arg("tile", index);
+		if(!is_thumb && System::instance()->stripe_size() > 0) {
+			Area *area_out = process_tile_stripes(subflow, task, pl_filters, tile, area_original, task->mutators, task->mutators_multipass, prof);
+			if(subflow->sync_point_pre()) {
+				if(tile->area != nullptr)
+					delete tile->area;
+				tile->area = area_out;
+				if(to_quit.load() == 0)
+					tiles_request->receiver->receive_tile(tile, is_thumb);
+			}
+			subflow->sync_point_post();
+			continue;
+		}
+		// serial setup of the next filter is done at the same barrier as the release of the previous one
+		auto process_obj_setup = [&](std::vector<class filter_record_t>::iterator it) {
+			Process_t *process_obj = new Process_t;
+			task->process_obj.reset(process_obj);
+			process_obj->area_in = task->area_transfer;
+			process_obj->position = tile->fp_position[(*it).fp_2d->name()];
+			process_obj->metadata = task->photo->metadata;
+			process_obj->allow_destructive = allow_destructive;
+			process_obj->mutators = task->mutators;
+			process_obj->mutators_multipass = task->mutators_multipass;
+			process_obj->fp_cache = nullptr;
+			//--
+			auto it_cache = process_cache->filters_cache.find((*it).fp);
+			if(it_cache != process_cache->filters_cache.end())
+				task->process_obj->fp_cache = (*it_cache).second.get();
+		};
 		if(subflow->sync_point_pre()) {
 			tile->request_ID = task->request_ID;
 			task->area_transfer = new Area(*area_original);
+			if(!pl_filters.empty())
+				process_obj_setup(pl_filters.begin());
 		}
 		subflow->sync_point_post();
 		bool flag_long_wait = false;
@@ -955,22 +1245,6 @@ void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::
 				}
 			}
 
-			if(subflow->sync_point_pre()) {
-				Process_t *process_obj = new Process_t;
-				task->process_obj.reset(process_obj);
-				process_obj->area_in = task->area_transfer;
-				process_obj->position = tile->fp_position[(*it).fp_2d->name()];
-				process_obj->metadata = task->photo->metadata;
-				process_obj->allow_destructive = allow_destructive;
-				process_obj->mutators = task->mutators;
-				process_obj->mutators_multipass = task->mutators_multipass;
-				process_obj->fp_cache = nullptr;
-				//--
-				auto it_cache = process_cache->filters_cache.find((*it).fp);
-				if(it_cache != process_cache->filters_cache.end())
-					task->process_obj->fp_cache = (*it_cache).second.get();
-			}
-			subflow->sync_point_post();
 			MT_t mt_obj;
 			mt_obj.subflow = subflow;
 			Filter_t filter_obj;
@@ -981,27 +1255,38 @@ void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::
 			filter_obj.fs_base = task->photo->map_fs_base[(*it).filter];
 //			if(is_main)
 //				cerr << "process filter: \"" << (*it).fp_2d->name() << "\"" << endl;
+			TraceSpan trace_filter("filter", (*it).fp->name());
+			trace_filter.arg("tile", index);
 			std::unique_ptr<Area> u_ptr = (*it).fp_2d->process(&mt_obj, task->process_obj.get(), &filter_obj);
 			Area *result_area = u_ptr.release();
+			trace_filter.end();
 			if(subflow->sync_point_pre()) {
 				const bool result_is_empty = (result_area == nullptr);
 				if(result_area == nullptr)
 					result_area = new Area(*task->area_transfer);
 				// cache 'whole' filters
 				if(is_thumb && (*it).use_tiling == false) {
+					std::shared_ptr<Area> area_cached;
 					if((*it).cache_result) {
-						if(!result_is_empty)
-							process_cache->filters_area_cache[(*it).fp] = std::shared_ptr<Area>{new Area(*result_area)};
+						if(!result_is_empty) {
+							area_cached = area_to_cache(result_area, task->is_offline);
+							process_cache->filters_area_cache[(*it).fp] = area_cached;
+						}
 						if(process_cache->cache_fp_for_second_pass == nullptr)
 							process_cache->cached_area_for_second_pass = process_cache->filters_area_cache[(*it).fp];
 					}
 					if(process_cache->cache_fp_for_second_pass == (*it).fp) {
-						process_cache->cached_area_for_second_pass.reset(new Area(*result_area));
+						if(area_cached == nullptr)
+							area_cached = area_to_cache(result_area, task->is_offline);
+						process_cache->cached_area_for_second_pass = area_cached;
 					}
 				}
 				delete task->area_transfer;
 				task->area_transfer = result_area;
 				task->process_obj.reset(nullptr);
+				task->mem_peak_check((*it).fp->name());
+				if(it + 1 != pl_filters.end())
+					process_obj_setup(it + 1);
 			}
 			subflow->sync_point_post();
 		}
@@ -1014,6 +1299,7 @@ void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::
 		int insert_pos_y = 0;
 		if(!is_thumb && is_main)
 			tiled_area = task->tiles_request->receiver->get_area_to_insert_tile_into(insert_pos_x, insert_pos_y, tile);
+		TraceSpan trace_convert("convert", "convert tile");
 		if(tiled_area != nullptr) {
 			AreaHelper::convert_mt(subflow, task->area_transfer, task->out_format, task->photo->cw_rotation, tiled_area, insert_pos_x, insert_pos_y);
 			area_out = tiled_area;
@@ -1021,6 +1307,7 @@ void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::
 			area_out = AreaHelper::convert_mt(subflow, task->area_transfer, task->out_format, task->photo->cw_rotation).release();
 			// here 'area_out' will be the 'area_to_insert' if the last one wasn't 'nullptr'
 		}
+		trace_convert.end();
 		if(subflow->sync_point_pre()) {
 			// delete 'type_float_p4' area
 			delete task->area_transfer;
@@ -1043,3 +1330,242 @@ void Process::process_filters(SubFlow *subflow, Process::task_run_t *task, std::
 }
 
 //------------------------------------------------------------------------------
+// Each thread takes the next tile from the request and processes it through all the filters with
+// its own standalone subflow, w/o barriers; 'main'-only sections of filters are serialized.
+void Process::process_filters_tiles_parallel(SubFlow *subflow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, Profiler *prof) {
+	TilesDescriptor_t *tiles_request = task->tiles_request;
+	const bool is_main = subflow->is_main();
+	Area *area_original = task->area_transfer;
+	if(is_main)
+		prof->mark("tiles parallel");
+	while(true) {
+		// let flows with higher priority (interactive requests) to preempt this one between tiles
+		subflow->pause_point();
+		if(Process::ID_to_abort(task->request_ID) || to_quit.load() != 0)
+			task->to_abort = true;
+		if(task->to_abort || task->tiles_bad_alloc.load())
+			break;
+
+		int index = -1;
+		tiles_request->index_list_lock.lock();
+		while(index == -1 && !tiles_request->index_list.empty()) {
+			index = tiles_request->index_list.front();
+			tiles_request->index_list.pop_front();
+			if(task->tiles_processed.find(index) != task->tiles_processed.end())
+				index = -1;
+			else
+				task->tiles_processed.insert(index);
+		}
+		tiles_request->index_list_lock.unlock();
+		if(index == -1)
+			break;
+
+		// OOM at any thread should be handled by the 'main' one after the barrier
+		try {
+			process_tile(subflow, task, pl_filters, &tiles_request->tiles[index], area_original);
+		} catch(Area::bad_alloc) {
+			task->tiles_bad_alloc.store(true);
+		} catch(std::bad_alloc) {
+			task->tiles_bad_alloc.store(true);
+		}
+	}
+	subflow->sync_point();
+	if(is_main) {
+		task->tiles_processed.clear();
+		if(task->tiles_bad_alloc.exchange(false))
+			throw Area::bad_alloc();
+		if(!task->to_abort)
+			tiles_request->receiver->process_done(false);
+	}
+}
+
+void Process::process_tile(SubFlow *subflow_flow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, Tile_t *tile, Area *area_original) {
+	TilesDescriptor_t *tiles_request = task->tiles_request;
+	TraceSpan trace_tile("tile", "tile");
+	trace_tile.arg("tile", tile->index);
+	// pauses of the flow are applied at the 'main'-only sections of filters too
+	SubFlow subflow(&task->tiles_serial_lock, subflow_flow);
+	// filters can change mutators at processing, so each tile should have a copy
+	DataSet mutators(*task->mutators);
+	DataSet mutators_multipass(*task->mutators_multipass);
+
+	Area *area_out = process_tile_stripes(&subflow, task, pl_filters, tile, area_original, &mutators, &mutators_multipass, nullptr);
+
+	// send result
+	std::unique_lock<std::mutex> lock(task->tiles_serial_lock);
+	if(tile->area != nullptr)
+		delete tile->area;
+	tile->area = area_out;
+	if(to_quit.load() == 0)
+		tiles_request->receiver->receive_tile(tile, false);
+}
+
+//------------------------------------------------------------------------------
+// Fused processing of the tile: instead of materializing the whole tile after each filter, process it by
+// horizontal stripes sized to fit into L2 cache. Each stripe is extended with rows asked by filters via
+// ::size_backward(), and converted into the asked format right after the last filter.
+class tile_stripes_t {
+public:
+	std::vector<Tile_t> stripes;	// with positions of each filter
+	std::vector<int> offsets;		// first row of stripe at tile
+	// of each stripe, as filters can change mutators at ::size_backward() and processing
+	std::vector<DataSet> mutators;
+	std::vector<DataSet> mutators_multipass;
+	Area *area_out = nullptr;		// the whole converted tile
+	std::unique_ptr<Area> area_out_holder;	// if TilesReceiver has no area to insert tile into
+	int pos_x = 0;
+	int pos_y = 0;
+	std::unique_ptr<Area> area_transfer;
+	std::unique_ptr<Process_t> process_obj;
+};
+
+// Return converted tile at 'main' thread, and nullptr for others.
+Area *Process::process_tile_stripes(SubFlow *subflow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, Tile_t *tile, Area *area_original, DataSet *mutators, DataSet *mutators_multipass, Profiler *prof) {
+	ProcessCache_t *process_cache = (ProcessCache_t *)task->photo->cache_process;
+	const bool is_main = subflow->is_main();
+	const int cw_rotation = task->photo->cw_rotation;
+	const int stripe_min_rows = 8;
+	std::unique_ptr<tile_stripes_t> ts_holder;
+
+	if(subflow->sync_point_pre()) {
+		tile_stripes_t *ts = new tile_stripes_t;
+		ts_holder.reset(ts);
+		tile->request_ID = task->request_ID;
+		const Area::t_dimensions &d_tile = tile->dimensions_post;
+		const int width = d_tile.width();
+		const int height = d_tile.height();
+		int rows = height;
+		const int stripe_size = System::instance()->stripe_size();
+		if(stripe_size > 0 && width > 0) {
+			// keep overhead of the rows processed twice reasonable
+			int halo = 0;
+			for(auto &el : tile->fp_position)
+				halo = std::max(halo, el.second.height - height);
+			rows = stripe_size / (width * Area::type_to_sizeof(Area::type_t::float_p4));
+			rows = std::max(rows, std::max(halo * 2, stripe_min_rows));
+		}
+		if(rows >= height) {
+			ts->stripes.push_back(*tile);
+			ts->stripes.back().area = nullptr;
+			ts->offsets.push_back(0);
+			ts->mutators.push_back(*mutators);
+			ts->mutators_multipass.push_back(*mutators_multipass);
+		} else {
+			for(int y = 0; y < height; y += rows) {
+				const int h = std::min(rows, height - y);
+				ts->stripes.push_back(Tile_t());
+				Tile_t &stripe = ts->stripes.back();
+				stripe.dimensions_post = d_tile;
+				stripe.dimensions_post.edges.y1 += y;
+				stripe.dimensions_post.edges.y2 += height - y - h;
+				stripe.dimensions_post.position.y += d_tile.position.px_size_y * y;
+				ts->mutators.push_back(*mutators);
+				ts->mutators_multipass.push_back(*mutators_multipass);
+				stripe.dimensions_pre = size_backward_tile(task, pl_filters, stripe.dimensions_post, &stripe, &ts->mutators.back(), &ts->mutators_multipass.back());
+				ts->offsets.push_back(y);
+			}
+		}
+		ts->area_out = task->tiles_request->receiver->get_area_to_insert_tile_into(ts->pos_x, ts->pos_y, tile);
+		if(ts->area_out == nullptr) {
+			Area::t_dimensions d_out;
+			d_out.size.w = width;
+			d_out.size.h = height;
+			if(cw_rotation == 90 || cw_rotation == 270)
+				std::swap(d_out.size.w, d_out.size.h);
+			ts->area_out_holder.reset(new Area(&d_out, Area::type_for_format(task->out_format)));
+			ts->area_out = ts->area_out_holder.get();
+			ts->pos_x = 0;
+			ts->pos_y = 0;
+		}
+		for(int i = 0; i < subflow->threads_count(); ++i)
+			subflow->set_private(ts, i);
+	}
+	subflow->sync_point_post();
+	// filters will use private data for own purposes
+	tile_stripes_t *ts = (tile_stripes_t *)subflow->get_private();
+
+	for(size_t si = 0; si < ts->stripes.size(); ++si) {
+		subflow->pause_point();
+		Tile_t *stripe = &ts->stripes[si];
+		if(area_original->type() == Area::type_t::half_p4) {
+			std::unique_ptr<Area> area_in = AreaHelper::convert_to_float(subflow, area_original, &stripe->dimensions_pre);
+			if(subflow->sync_point_pre())
+				ts->area_transfer = std::move(area_in);
+			subflow->sync_point_post();
+		} else {
+			if(subflow->sync_point_pre())
+				ts->area_transfer.reset(new Area(*area_original));
+			subflow->sync_point_post();
+		}
+		for(auto it = pl_filters.begin(); it != pl_filters.end(); ++it) {
+			if(is_main && prof != nullptr)
+				prof->mark((*it).fp->name());
+			if(subflow->sync_point_pre()) {
+				Process_t *process_obj = new Process_t;
+				ts->process_obj.reset(process_obj);
+				process_obj->area_in = ts->area_transfer.get();
+				process_obj->position = stripe->fp_position[(*it).fp_2d->name()];
+				process_obj->metadata = task->photo->metadata;
+				process_obj->allow_destructive = true;
+				process_obj->mutators = &ts->mutators[si];
+				process_obj->mutators_multipass = &ts->mutators_multipass[si];
+				process_obj->fp_cache = nullptr;
+				auto it_cache = process_cache->filters_cache.find((*it).fp);
+				if(it_cache != process_cache->filters_cache.end())
+					process_obj->fp_cache = (*it_cache).second.get();
+			}
+			subflow->sync_point_post();
+			MT_t mt_obj;
+			mt_obj.subflow = subflow;
+			Filter_t filter_obj;
+			filter_obj.ps_base = (*it).ps_base.get();
+			filter_obj.filter = task->is_offline ? nullptr : (*it).filter;
+			filter_obj.is_offline = task->is_offline;
+			// don't use operator[] - it can modify the map
+			filter_obj.fs_base = nullptr;
+			auto it_fs = task->photo->map_fs_base.find((*it).filter);
+			if(it_fs != task->photo->map_fs_base.end())
+				filter_obj.fs_base = (*it_fs).second;
+			TraceSpan trace_filter("filter", (*it).fp->name());
+			trace_filter.arg("tile", tile->index);
+			trace_filter.arg("stripe", si);
+			std::unique_ptr<Area> result_area = (*it).fp_2d->process(&mt_obj, ts->process_obj.get(), &filter_obj);
+			trace_filter.end();
+			if(subflow->sync_point_pre()) {
+				if(result_area == nullptr)
+					result_area.reset(new Area(*ts->area_transfer));
+				ts->area_transfer = std::move(result_area);
+				ts->process_obj.reset(nullptr);
+				task->mem_peak_check((*it).fp->name());
+			}
+			subflow->sync_point_post();
+		}
+		// convert to asked format, right into the result
+		if(is_main && prof != nullptr)
+			prof->mark("convert tiles");
+		int pos_x = ts->pos_x;
+		int pos_y = ts->pos_y;
+		if(cw_rotation == 90 || cw_rotation == 270)
+			pos_x += ts->offsets[si];
+		else
+			pos_y += ts->offsets[si];
+		TraceSpan trace_convert("convert", "convert stripe");
+		AreaHelper::convert_mt(subflow, ts->area_transfer.get(), task->out_format, cw_rotation, ts->area_out, pos_x, pos_y);
+		trace_convert.end();
+		if(subflow->sync_point_pre())
+			ts->area_transfer.reset();
+		subflow->sync_point_post();
+	}
+	Area *area_out = ts->area_out;
+	if(is_main) {
+		ts->area_out_holder.release();
+		// as after processing of the whole tile
+		*mutators = ts->mutators.back();
+		*mutators_multipass = ts->mutators_multipass.back();
+	}
+	// 'ts' will be destroyed by 'main' after that point
+	subflow->sync_point();
+	return is_main ? area_out : nullptr;
+}
+
+//------------------------------------------------------------------------------
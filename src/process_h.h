@@ -10,6 +10,7 @@
  */
 
 
+#include <chrono>
 #include <string>
 #include <list>
 #include <map>
@@ -53,6 +54,8 @@ public:
 	bool is_offline;
 	Flow::priority_t priority = Flow::priority_lowest;
 	TilesReceiver *tiles_receiver = nullptr;
+	// memory budget reserved by the caller for the whole request, released by the caller
+	size_t mem_reserved = 0;
 
 	// Set of (all) filters settings for processing
 	std::map<class Filter *, std::shared_ptr<PS_Base>> map_ps_base;
@@ -64,6 +67,25 @@ public:
 	bool failed_at_import = false;
 	int result_cw_rotation = 0;
 	int result_update;
+	// the peak of memory allocated by the request, and the stage - import or filter - where it was reached
+	long mem_peak = 0;
+	std::string mem_peak_stage;
+	// if photo was imported before the request
+	std::shared_ptr<MemTracker> mem_tracker;
+};
+
+// Export of photo, split into stages to be run by a pipeline: load, process and save.
+class Export_job_t {
+public:
+	Export_job_t(void);
+	~Export_job_t();
+	Photo_ID photo_id;
+	std::string fname_export;
+	class export_parameters_t *ep = nullptr;	// should be valid until save
+	Process_task_t process_task;
+	std::unique_ptr<class TilesReceiver> tiles_receiver;
+	std::chrono::steady_clock::time_point time_start;
+	bool keep_photo = false;	// don't release imported raw after processing
 };
 
 class Process : public QObject {
@@ -81,7 +103,14 @@ public:
 	// map<...> - processing settings for filters
 	// Return 'false' if failed - like out-of-memory etc...
 	bool process_edit(void *ptr, std::shared_ptr<class Photo_t>, int request_ID, class TilesReceiver *, class std::map<class Filter *, std::shared_ptr<PS_Base> >);
-	bool process_export(Photo_ID photo_id, std::string fname_export, class export_parameters_t *ep);
+	// 'mem_peak' - if not nullptr, would be set to the peak of memory used by the request
+	// 'fname_ps' - file with filters settings to apply instead of the photo's own one, if not empty
+	bool process_export(Photo_ID photo_id, std::string fname_export, class export_parameters_t *ep, long *mem_peak = nullptr, std::string fname_ps = "");
+	// stages of 'process_export()'; return 'false' if failed, next stages still should be called
+	// 'photo_warm' - photo kept by caller between exports, to reuse imported raw and cached results of filters
+	std::unique_ptr<Export_job_t> export_load(Photo_ID photo_id, std::string fname_export, class export_parameters_t *ep, std::string fname_ps = "", std::shared_ptr<Photo_t> photo_warm = std::shared_ptr<Photo_t>());
+	bool export_process(Export_job_t *job);
+	bool export_save(Export_job_t *job);
 
 	static void quit(void);
 
@@ -105,12 +134,19 @@ protected:
 
 	// thread properties
 	class task_run_t;
+	static bool run_flow(Process_task_t *process_task, Process::task_run_t *task);
+	static size_t mem_budget_estimate(Process::task_run_t *task, int tile_length);
 	static void subflow_run_mt(void *obj, SubFlow *subflow, void *data);
 	static void run_mt(SubFlow *subflow, void *data);
 
 	static void process_size_forward(Area::t_dimensions &d_out, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, Area::t_dimensions *d_in_ptr);
 	static void process_size_backward(Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, const Area::t_dimensions &);
 	static void process_filters(SubFlow *subflow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, bool is_thumb, class Profiler *prof);
+	static void process_filters_tiles_parallel(SubFlow *subflow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, class Profiler *prof);
+	static void process_tile(class SubFlow *subflow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, class Tile_t *tile, class Area *area_original);
+	static class Area *process_tile_stripes(SubFlow *subflow, Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, class Tile_t *tile, class Area *area_original, class DataSet *mutators, class DataSet *mutators_multipass, class Profiler *prof);
+	static std::shared_ptr<class Area> area_to_cache(class Area *area, bool is_offline);
+	static Area::t_dimensions size_backward_tile(Process::task_run_t *task, std::vector<class filter_record_t> &pl_filters, const Area::t_dimensions &d_post, class Tile_t *tile, class DataSet *mutators, class DataSet *mutators_multipass);
 
 	static void wrap_filters(const std::vector<class filter_record_t> &filters, class task_run_t *task);
 	static void allocate_process_caches(const std::vector<class filter_record_t> &filters, std::shared_ptr<class Photo_t> photo_ptr);
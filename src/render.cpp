@@ -0,0 +1,205 @@
+/*
+ * render.cpp
+ *
+ * This source code is a part of 'DDRoom' project.
+ * (C) 2015-2017 Mykhailo Malyshko a.k.a. Spectr.
+ * License: GPL version 3.
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QString>
+
+#include "memory.h"
+#include "photo.h"
+#include "process_h.h"
+#include "render.h"
+#include "system.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+bool Render::is_render_mode(int argc, char *argv[]) {
+	for(int i = 1; i < argc; ++i)
+		if(string(argv[i]) == "--render")
+			return true;
+	return false;
+}
+
+int Render::run(int argc, char *argv[]) {
+	Render render;
+	std::vector<std::string> args;
+	for(int i = 1; i < argc; ++i)
+		args.push_back(argv[i]);
+	if(!render.parse_arguments(args))
+		return exit_usage;
+	if(render.files.empty()) {
+		cerr << "nothing to render" << endl;
+		return exit_usage;
+	}
+	return render.render();
+}
+
+Render::Render(void) {
+	version_index = 0;
+	threads = 0;
+	memory_mb = 0;
+	ep.process_single = false;
+	ep.process_asap = false;
+}
+
+void Render::help(void) {
+	cerr << "usage: ddroom --render [options] file..." << endl;
+	cerr << "  -o, --output <folder>    folder for results, by default the folder of each photo" << endl;
+	cerr << "  --settings <file.ddr>    apply filters settings from file, by default the photo's own ones" << endl;
+	cerr << "  --version <N>            version of photo settings to use, and add to the name of result" << endl;
+	cerr << "  --format <jpeg|png|tiff> type of results, 'jpeg' by default" << endl;
+	cerr << "  --quality <0-100>        JPEG quality" << endl;
+	cerr << "  --subsampling <1x1|2x2>  JPEG color subsampling" << endl;
+	cerr << "  --bits <8|16>            PNG or TIFF bits per channel" << endl;
+	cerr << "  --alpha                  save PNG or TIFF with alpha channel" << endl;
+	cerr << "  --size <W>x<H>           scale result to fit into size" << endl;
+	cerr << "  --fill                   with '--size', scale and cut result to fill the whole size" << endl;
+	cerr << "  --threads <N>            threads count for processing" << endl;
+	cerr << "  --memory <MB>            budget of memory for processing" << endl;
+	cerr << "  --trace <file.json>      write trace of processing as Chrome trace events" << endl;
+	cerr << "exit code: 0 - all photos are rendered, 1 - some photos failed, 2 - wrong arguments" << endl;
+}
+
+bool Render::parse_arguments(const std::vector<std::string> &args) {
+	bool fill = false;
+	const int argc = args.size();
+	for(int i = 0; i < argc; ++i) {
+		const string &arg = args[i];
+		if(arg == "--render")
+			continue;
+		if(arg == "--help" || arg == "-h") {
+			help();
+			return false;
+		}
+		if(arg == "--alpha") {
+			ep.options_png.alpha = true;
+			ep.options_tiff.alpha = true;
+			continue;
+		}
+		if(arg == "--fill") {
+			fill = true;
+			continue;
+		}
+		if(arg.length() > 0 && arg[0] != '-') {
+			files.push_back(arg);
+			continue;
+		}
+		// options with value
+		if(i + 1 >= argc) {
+			cerr << "missed value of option \"" << arg << "\"" << endl;
+			return false;
+		}
+		const string value = args[++i];
+		const QString q_value = QString::fromStdString(value);
+		bool ok = true;
+		if(arg == "-o" || arg == "--output") {
+			folder = value;
+			ok = QFileInfo(q_value).isDir();
+		} else if(arg == "--settings") {
+			fname_ps = value;
+			ok = QFileInfo(q_value).isFile();
+		} else if(arg == "--version") {
+			version_index = q_value.toInt(&ok);
+			ok = ok && version_index > 0;
+		} else if(arg == "--format") {
+			ep.image_type = export_parameters_t::image_name_to_type(value);
+			ok = (export_parameters_t::image_type_to_name(ep.image_type) == value || value == "jpg" || value == "tif");
+		} else if(arg == "--quality") {
+			ep.options_jpeg.image_quality = q_value.toInt(&ok);
+			ok = ok && ep.options_jpeg.image_quality >= 0 && ep.options_jpeg.image_quality <= 100;
+		} else if(arg == "--subsampling") {
+			ep.options_jpeg.color_subsampling_1x1 = (value == "1x1");
+			ok = (value == "1x1" || value == "2x2");
+		} else if(arg == "--bits") {
+			const int bits = q_value.toInt(&ok);
+			ok = ok && (bits == 8 || bits == 16);
+			ep.options_png.bits = bits;
+			ep.options_tiff.bits = bits;
+		} else if(arg == "--size") {
+			QStringList size = q_value.split("x");
+			ok = (size.size() == 2);
+			if(ok) {
+				bool ok_h = false;
+				ep.scaling_width = size[0].toInt(&ok);
+				ep.scaling_height = size[1].toInt(&ok_h);
+				ok = ok && ok_h && ep.scaling_width > 0 && ep.scaling_height > 0;
+				ep.scaling_force = true;
+			}
+		} else if(arg == "--threads") {
+			threads = q_value.toInt(&ok);
+			ok = ok && threads > 0;
+		} else if(arg == "--memory") {
+			memory_mb = q_value.toInt(&ok);
+			ok = ok && memory_mb > 0;
+		} else if(arg == "--trace") {
+			trace_file = value;
+		} else {
+			cerr << "unknown option \"" << arg << "\"" << endl;
+			help();
+			return false;
+		}
+		if(!ok) {
+			cerr << "wrong value \"" << value << "\" of option \"" << arg << "\"" << endl;
+			return false;
+		}
+	}
+	ep.scaling_to_fill = fill;
+	return true;
+}
+
+int Render::render(void) {
+	// set budget of threads and memory
+	if(threads > 0)
+		System::instance()->set_cores(threads);
+	if(memory_mb > 0)
+		MemBudget::instance()->set_limit(size_t(memory_mb) * 1024 * 1024);
+	if(trace_file != "")
+		Trace::open(trace_file);
+	Process process;
+	int c_failed = 0;
+	auto time_begin = std::chrono::steady_clock::now();
+	for(auto file_name : files) {
+		auto time_start = std::chrono::steady_clock::now();
+		string fname_export;
+		const bool result = render_photo(&process, file_name, fname_export);
+		const long time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - time_start).count();
+		// one line per photo, for scripts
+		cout << file_name << " -> " << fname_export << ": " << (result ? "OK" : "FAILED") << ", " << time_ms << " ms" << endl;
+		if(!result)
+			++c_failed;
+	}
+	const long time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - time_begin).count();
+	Trace::close();
+	cerr << "rendered " << files.size() - c_failed << " of " << files.size() << " photos in " << time_ms << " ms" << endl;
+	return (c_failed == 0) ? exit_ok : exit_failed;
+}
+
+bool Render::render_photo(Process *process, string file_name, string &fname_export, std::shared_ptr<Photo_t> photo_warm, std::function<void(const std::string &)> progress) {
+	QFileInfo fi(QString::fromStdString(file_name));
+	file_name = fi.absoluteFilePath().toStdString();
+	Photo_ID photo_id(file_name, (version_index > 0) ? version_index : 1);
+	// result name: the same as photo, with version if asked
+	ep.set_file_name((version_index > 0) ? photo_id.get_export_file_name() : file_name);
+	ep.folder = (folder != "") ? folder : fi.absolutePath().toStdString();
+	fname_export = ep.folder + QDir::toNativeSeparators("/").toStdString() + ep.get_file_name();
+	if(!fi.isFile())
+		return false;
+	if(progress) progress("load");
+	std::unique_ptr<Export_job_t> job = process->export_load(photo_id, fname_export, &ep, fname_ps, photo_warm);
+	if(progress) progress("process");
+	process->export_process(job.get());
+	if(progress) progress("save");
+	return process->export_save(job.get());
+}
+
+//------------------------------------------------------------------------------
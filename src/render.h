@@ -0,0 +1,60 @@
+#ifndef __H_RENDER__
+#define __H_RENDER__
+/*
+ * render.h
+ *
+ * This source code is a part of 'DDRoom' project.
+ * (C) 2015-2017 Mykhailo Malyshko a.k.a. Spectr.
+ * License: GPL version 3.
+ *
+ */
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "export.h"
+
+//------------------------------------------------------------------------------
+// Headless rendering of photos from the command line: "ddroom --render [options] files...",
+// w/o any widgets created.
+class Render {
+public:
+	// exit codes
+	enum exit_code_t {
+		exit_ok = 0,
+		exit_failed = 1,	// some of photos were not rendered
+		exit_usage = 2		// wrong arguments
+	};
+
+	static bool is_render_mode(int argc, char *argv[]);
+	// return exit code; libraries should be initialized already
+	static int run(int argc, char *argv[]);
+
+	Render(void);
+	// arguments w/o program name; return 'false' on error
+	bool parse_arguments(const std::vector<std::string> &args);
+	// options of the whole process - threads, memory and trace - were given
+	bool process_options(void) const {return threads > 0 || memory_mb > 0 || trace_file != "";}
+	// render one photo with parsed options; 'photo_warm' could be used to keep imported photo for the next calls
+	// 'progress' if not null is called with the name of each stage: "load", "process", "save"
+	bool render_photo(class Process *process, std::string file_name, std::string &fname_export, std::shared_ptr<class Photo_t> photo_warm = std::shared_ptr<class Photo_t>(), std::function<void(const std::string &)> progress = nullptr);
+	std::list<std::string> files;
+
+protected:
+	static void help(void);
+	int render(void);
+
+	std::string fname_ps;
+	std::string folder;
+	int version_index;
+	int threads;
+	int memory_mb;
+	std::string trace_file;
+	export_parameters_t ep;
+};
+
+//------------------------------------------------------------------------------
+#endif // __H_RENDER__
@@ -0,0 +1,275 @@
+/*
+ * render_server.cpp
+ *
+ * This source code is a part of 'DDRoom' project.
+ * (C) 2015-2017 Mykhailo Malyshko a.k.a. Spectr.
+ * License: GPL version 3.
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "memory.h"
+#include "photo.h"
+#include "process_h.h"
+#include "render.h"
+#include "render_server.h"
+#include "system.h"
+
+using namespace std;
+
+#define RENDER_SERVER_SOCKET "ddroom-render"
+#define RENDER_SERVER_PHOTOS_WARM 2
+// ms to write replies to clients on quit
+#define RENDER_SERVER_QUIT_TIMEOUT 1000
+
+//------------------------------------------------------------------------------
+bool Render_Server::is_server_mode(int argc, char *argv[]) {
+	for(int i = 1; i < argc; ++i)
+		if(string(argv[i]) == "--serve")
+			return true;
+	return false;
+}
+
+int Render_Server::run(int argc, char *argv[]) {
+	QString socket_name = RENDER_SERVER_SOCKET;
+	int photos_warm_max = RENDER_SERVER_PHOTOS_WARM;
+	int threads = 0;
+	int memory_mb = 0;
+	for(int i = 1; i < argc; ++i) {
+		const string arg = argv[i];
+		if(arg == "--serve")
+			continue;
+		bool ok = (i + 1 < argc);
+		QString value = ok ? QString(argv[++i]) : QString();
+		if(ok && arg == "--socket") {
+			socket_name = value;
+		} else if(ok && arg == "--keep") {
+			photos_warm_max = value.toInt(&ok);
+			ok = ok && photos_warm_max >= 0;
+		} else if(ok && arg == "--threads") {
+			threads = value.toInt(&ok);
+			ok = ok && threads > 0;
+		} else if(ok && arg == "--memory") {
+			memory_mb = value.toInt(&ok);
+			ok = ok && memory_mb > 0;
+		} else {
+			ok = false;
+		}
+		if(!ok) {
+			cerr << "usage: ddroom --serve [--socket <name>] [--threads N] [--memory MB] [--keep N]" << endl;
+			return Render::exit_usage;
+		}
+	}
+	// set_cores() resets the memory budget from config, so set memory after threads
+	if(threads > 0)
+		System::instance()->set_cores(threads);
+	if(memory_mb > 0)
+		MemBudget::instance()->set_limit(size_t(memory_mb) * 1024 * 1024);
+	Render_Server render_server(photos_warm_max);
+	if(!render_server.listen(socket_name))
+		return Render::exit_failed;
+	return QCoreApplication::exec();
+}
+
+//------------------------------------------------------------------------------
+Render_Server::Render_Server(int _photos_warm_max) {
+	photos_warm_max = _photos_warm_max;
+	clients_counter = 0;
+	to_quit = false;
+	process = new Process();
+	server = new QLocalServer(this);
+	connect(server, SIGNAL(newConnection(void)), this, SLOT(slot_new_connection(void)));
+	connect(this, SIGNAL(signal_reply(int, QString)), this, SLOT(slot_reply(int, QString)), Qt::QueuedConnection);
+	jobs_thread = new std::thread( [=]{ run_jobs(); } );
+}
+
+Render_Server::~Render_Server() {
+	if(jobs_thread != nullptr) {
+		jobs_lock.lock();
+		to_quit = true;
+		jobs_wait.notify_all();
+		jobs_lock.unlock();
+		jobs_thread->join();
+		delete jobs_thread;
+	}
+	photos_warm.clear();
+	delete process;
+}
+
+bool Render_Server::listen(QString socket_name) {
+	// remove socket left by crashed server, if any
+	QLocalServer::removeServer(socket_name);
+	// jobs read and write files with rights of the server, so don't let other users connect
+	server->setSocketOptions(QLocalServer::UserAccessOption);
+	if(!server->listen(socket_name)) {
+		cerr << "render server: can't listen \"" << socket_name.toStdString() << "\": " << server->errorString().toStdString() << endl;
+		return false;
+	}
+	cerr << "render server: listen \"" << server->fullServerName().toStdString() << "\"" << endl;
+	return true;
+}
+
+void Render_Server::slot_new_connection(void) {
+	QLocalSocket *socket = server->nextPendingConnection();
+	while(socket != nullptr) {
+		const int client_id = ++clients_counter;
+		socket->setProperty("client_id", client_id);
+		clients[client_id] = socket;
+		connect(socket, SIGNAL(readyRead(void)), this, SLOT(slot_ready_read(void)));
+		connect(socket, SIGNAL(disconnected(void)), this, SLOT(slot_disconnected(void)));
+		socket = server->nextPendingConnection();
+	}
+}
+
+void Render_Server::slot_disconnected(void) {
+	QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+	if(socket == nullptr)
+		return;
+	// jobs of this client would be done anyway, w/o replies
+	clients.erase(socket->property("client_id").toInt());
+	socket->deleteLater();
+}
+
+void Render_Server::slot_ready_read(void) {
+	QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+	if(socket == nullptr)
+		return;
+	const int client_id = socket->property("client_id").toInt();
+	while(socket->canReadLine()) {
+		QString line = QString::fromUtf8(socket->readLine()).trimmed();
+		if(line.isEmpty())
+			continue;
+		if(line == "--quit") {
+			quit();
+			return;
+		}
+		job_t job;
+		job.client_id = client_id;
+		for(auto el : line.split("\t", QString::SkipEmptyParts))
+			job.args.push_back(el.toStdString());
+		jobs_lock.lock();
+		jobs.push_back(job);
+		jobs_wait.notify_all();
+		jobs_lock.unlock();
+	}
+}
+
+// Jobs in queue are dropped, with reply to their clients; the current job is finished, and replies of it are sent before exit.
+void Render_Server::quit(void) {
+	jobs_lock.lock();
+	std::list<job_t> jobs_dropped;
+	jobs_dropped.swap(jobs);
+	to_quit = true;
+	jobs_wait.notify_all();
+	jobs_lock.unlock();
+	for(auto &job : jobs_dropped) {
+		reply(job.client_id, {"error", "server quit"});
+		reply(job.client_id, {"end", QString::number(Render::exit_failed).toStdString()});
+	}
+	jobs_thread->join();
+	delete jobs_thread;
+	jobs_thread = nullptr;
+	// deliver queued replies, then write them out
+	QCoreApplication::sendPostedEvents(this);
+	for(auto el : clients)
+		el.second->waitForBytesWritten(RENDER_SERVER_QUIT_TIMEOUT);
+	QCoreApplication::quit();
+}
+
+void Render_Server::slot_reply(int client_id, QString line) {
+	auto it = clients.find(client_id);
+	if(it == clients.end())
+		return;
+	(*it).second->write(line.toUtf8());
+	(*it).second->flush();
+}
+
+void Render_Server::reply(int client_id, const std::vector<std::string> &fields) {
+	QString line;
+	for(size_t i = 0; i < fields.size(); ++i) {
+		if(i != 0)
+			line += "\t";
+		line += QString::fromStdString(fields[i]);
+	}
+	line += "\n";
+	emit signal_reply(client_id, line);
+}
+
+//------------------------------------------------------------------------------
+// Jobs are done one by one, each job uses all cores anyway.
+void Render_Server::run_jobs(void) {
+	while(true) {
+		std::unique_lock<std::mutex> locker(jobs_lock);
+		jobs_wait.wait(locker, [this]{ return to_quit || !jobs.empty(); });
+		if(to_quit)
+			break;
+		job_t job = jobs.front();
+		jobs.pop_front();
+		locker.unlock();
+		run_job(job);
+	}
+}
+
+void Render_Server::run_job(job_t &job) {
+	const int client_id = job.client_id;
+	Render render;
+	if(!render.parse_arguments(job.args) || render.files.empty()) {
+		reply(client_id, {"error", "wrong arguments"});
+		reply(client_id, {"end", QString::number(Render::exit_usage).toStdString()});
+		return;
+	}
+	// jobs share threads and memory budget of the server
+	if(render.process_options()) {
+		reply(client_id, {"error", "options --threads, --memory and --trace are set for the server only"});
+		reply(client_id, {"end", QString::number(Render::exit_usage).toStdString()});
+		return;
+	}
+	int c_failed = 0;
+	for(auto file_name : render.files) {
+		auto time_start = std::chrono::steady_clock::now();
+		string fname_export;
+		auto progress = [&](const std::string &stage){ reply(client_id, {"progress", file_name, stage}); };
+		const bool result = render.render_photo(process, file_name, fname_export, photo_warm(file_name), progress);
+		const long time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - time_start).count();
+		reply(client_id, {"done", file_name, fname_export, result ? "OK" : "FAILED", QString::number(time_ms).toStdString()});
+		if(!result)
+			++c_failed;
+	}
+	reply(client_id, {"end", QString::number((c_failed == 0) ? Render::exit_ok : Render::exit_failed).toStdString()});
+}
+
+// Return photo to keep between jobs, with imported raw if that file was rendered recently and not changed since.
+std::shared_ptr<Photo_t> Render_Server::photo_warm(std::string file_name) {
+	if(photos_warm_max <= 0)
+		return std::shared_ptr<Photo_t>();
+	QFileInfo fi(QString::fromStdString(file_name));
+	file_name = fi.absoluteFilePath().toStdString();
+	const QDateTime modified = fi.lastModified();
+	photo_warm_t warm;
+	for(auto it = photos_warm.begin(); it != photos_warm.end(); ++it) {
+		if((*it).file_name == file_name) {
+			if((*it).modified == modified)
+				warm = *it;
+			photos_warm.erase(it);
+			break;
+		}
+	}
+	if(warm.photo == nullptr) {
+		warm.file_name = file_name;
+		warm.modified = modified;
+		warm.photo = std::shared_ptr<Photo_t>(new Photo_t());
+	}
+	photos_warm.push_front(warm);
+	while(photos_warm.size() > size_t(photos_warm_max))
+		photos_warm.pop_back();
+	return warm.photo;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,91 @@
+#ifndef __H_RENDER_SERVER__
+#define __H_RENDER_SERVER__
+/*
+ * render_server.h
+ *
+ * This source code is a part of 'DDRoom' project.
+ * (C) 2015-2017 Mykhailo Malyshko a.k.a. Spectr.
+ * License: GPL version 3.
+ *
+ */
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+
+//------------------------------------------------------------------------------
+// Long-running render service: "ddroom --serve [--socket <name>] [--threads N] [--memory MB] [--keep N]".
+// Listen on a local (Unix domain) socket, and keep color tables, imported photos and cached results of
+// filters warm between jobs.
+// Protocol is line-based, with tab-separated fields. Each request line is a job - the same arguments as
+// for '--render' w/o --threads, --memory and --trace, or "--quit" to stop the server after the current job -
+// queued jobs get "error" and "end" replies. Only the user of the server can connect. Replies to the job:
+//   progress <file> <load|process|save>
+//   done <file> <result file> <OK|FAILED> <time in ms>
+//   error <message>
+//   end <exit code of '--render'>
+class Render_Server : public QObject {
+	Q_OBJECT
+
+public:
+	static bool is_server_mode(int argc, char *argv[]);
+	// return exit code; libraries should be initialized already
+	static int run(int argc, char *argv[]);
+
+	Render_Server(int photos_warm_max);
+	~Render_Server();
+	bool listen(QString socket_name);
+
+signals:
+	void signal_reply(int client_id, QString line);
+
+protected slots:
+	void slot_new_connection(void);
+	void slot_ready_read(void);
+	void slot_disconnected(void);
+	void slot_reply(int client_id, QString line);
+
+protected:
+	class QLocalServer *server;
+	std::map<int, class QLocalSocket *> clients;
+	int clients_counter;
+
+	class job_t {
+	public:
+		int client_id;
+		std::vector<std::string> args;
+	};
+	std::mutex jobs_lock;
+	std::condition_variable jobs_wait;
+	std::list<job_t> jobs;
+	bool to_quit;
+	std::thread *jobs_thread;
+	void run_jobs(void);
+	void quit(void);
+	void run_job(job_t &job);
+	void reply(int client_id, const std::vector<std::string> &fields);
+
+	class Process *process;
+	// imported photos, the most recently used is the first one
+	class photo_warm_t {
+	public:
+		std::string file_name;
+		QDateTime modified;
+		std::shared_ptr<class Photo_t> photo;
+	};
+	std::list<photo_warm_t> photos_warm;
+	int photos_warm_max;
+	std::shared_ptr<class Photo_t> photo_warm(std::string file_name);
+};
+
+//------------------------------------------------------------------------------
+#endif // __H_RENDER_SERVER__
@@ -7,8 +7,12 @@
  *
  */
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <mutex>
+#include <sstream>
 #include <thread>
 
 #ifdef Q_OS_WIN32
@@ -17,6 +21,7 @@
 	#include <winbase.h>
 #else
 	#include <stdint.h>
+	#include <unistd.h>
 	// CPU count for MacOSX (i.e. BSD systems)
 	#include <sys/sysctl.h>
 	#include <sys/types.h>
@@ -26,6 +31,7 @@
 
 #include "system.h"
 #include "config.h"
+#include "memory.h"
 
 using namespace std;
 
@@ -33,6 +39,7 @@ using namespace std;
 //#define _PROFILER_OFF
 
 #define THREADS_DEFAULT 4
+#define L2_SIZE_DEFAULT (256 * 1024)
 
 //------------------------------------------------------------------------------
 // Time profiler. Last entry should be ""
@@ -87,6 +94,141 @@ Profiler::~Profiler() {
 #endif
 }
 
+//------------------------------------------------------------------------------
+// Events are written as JSON array w/o the closing bracket, which is allowed by the trace events format,
+// so the file is usable even if application was terminated.
+std::atomic_bool Trace::_enabled{false};
+
+static std::mutex trace_lock;
+static std::ofstream trace_stream;
+static std::string trace_file_name;
+static std::chrono::steady_clock::time_point trace_time_start;
+static std::atomic_int trace_threads_counter{0};
+static std::function<void(const char *, const string &, long)> trace_sink;
+
+// small thread IDs for the trace viewer
+static int trace_thread_id(void) {
+	thread_local int id = ++trace_threads_counter;
+	return id;
+}
+
+static string trace_escape(const string &str) {
+	string rez;
+	for(auto c : str) {
+		if(c == '"' || c == '\\')
+			rez += '\\';
+		rez += c;
+	}
+	return rez;
+}
+
+void Trace::open(const string &file_name) {
+	std::unique_lock<std::mutex> locker(trace_lock);
+	if(file_name == trace_file_name)
+		return;
+	_enabled.store(bool(trace_sink));
+	if(trace_stream.is_open())
+		trace_stream.close();
+	trace_file_name = file_name;
+	if(file_name.empty())
+		return;
+	trace_stream.open(file_name, std::ios_base::out | std::ios_base::trunc);
+	if(!trace_stream.is_open()) {
+		cerr << "trace: can't open file \"" << file_name << "\"" << endl;
+		trace_file_name = "";
+		return;
+	}
+	if(!trace_sink)
+		trace_time_start = std::chrono::steady_clock::now();
+	trace_stream << "[" << endl;
+	trace_stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ddroom\"}}";
+	_enabled.store(true);
+}
+
+void Trace::close(void) {
+	open("");
+}
+
+void Trace::sink_set(std::function<void(const char *, const string &, long)> sink) {
+	std::unique_lock<std::mutex> locker(trace_lock);
+	if(!trace_stream.is_open() && sink)
+		trace_time_start = std::chrono::steady_clock::now();
+	trace_sink = sink;
+	_enabled.store(trace_stream.is_open() || bool(trace_sink));
+}
+
+void Trace::flush(void) {
+	std::unique_lock<std::mutex> locker(trace_lock);
+	if(trace_stream.is_open())
+		trace_stream.flush();
+}
+
+long Trace::now(void) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - trace_time_start).count();
+}
+
+void Trace::span(const char *category, const string &name, long ts_begin, long ts_end, const string &args) {
+	const int tid = trace_thread_id();
+	std::ostringstream event;
+	event << ",\n{\"name\":\"" << trace_escape(name) << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid;
+	event << ",\"ts\":" << ts_begin << ",\"dur\":" << (ts_end - ts_begin);
+	if(!args.empty())
+		event << ",\"args\":{" << args << "}";
+	event << "}";
+	std::unique_lock<std::mutex> locker(trace_lock);
+	if(trace_stream.is_open())
+		trace_stream << event.str();
+	if(trace_sink)
+		trace_sink(category, name, ts_end - ts_begin);
+}
+
+void Trace::counter(const string &name, const string &args) {
+	std::ostringstream event;
+	event << ",\n{\"name\":\"" << trace_escape(name) << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << now() << ",\"args\":{" << args << "}}";
+	std::unique_lock<std::mutex> locker(trace_lock);
+	if(trace_stream.is_open())
+		trace_stream << event.str();
+}
+
+TraceSpan::TraceSpan(const char *_category, const char *_name) {
+	active = Trace::enabled();
+	if(!active)
+		return;
+	category = _category;
+	name = _name;
+	ts_begin = Trace::now();
+}
+
+TraceSpan::TraceSpan(const char *_category, const string &_name) {
+	active = Trace::enabled();
+	if(!active)
+		return;
+	category = _category;
+	name = _name;
+	ts_begin = Trace::now();
+}
+
+TraceSpan::~TraceSpan() {
+	end();
+}
+
+void TraceSpan::end(void) {
+	if(active)
+		Trace::span(category, name, ts_begin, Trace::now(), args);
+	active = false;
+}
+
+void TraceSpan::arg(const char *key, long value) {
+	if(!active)
+		return;
+	if(!args.empty())
+		args += ",";
+	args += "\"";
+	args += key;
+	args += "\":";
+	args += std::to_string(value);
+}
+
 /*------------------------------------------------------------------------------
  * System capabilities description (singleton)
  */
@@ -140,6 +282,26 @@ System::System(void) {
 	if(_cores <= 0)
 		_cores = THREADS_DEFAULT;
 	detected_cores = _cores;
+	// half float conversion
+	detected_f16c = false;
+#if defined(Q_CC_GNU) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	detected_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#endif
+	// L2 cache size, used for the fused processing stripes
+	detected_l2_size = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	detected_l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+	if(detected_l2_size <= 0)
+		detected_l2_size = L2_SIZE_DEFAULT;
+	detected_mem_physical = 0;
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+	const long mem_pages = sysconf(_SC_PHYS_PAGES);
+	const long mem_page_size = sysconf(_SC_PAGE_SIZE);
+	if(mem_pages > 0 && mem_page_size > 0)
+		detected_mem_physical = size_t(mem_pages) * size_t(mem_page_size);
+#endif
 //	cerr << "detected cores: " << _cores << endl;
 	apply_config();
 //	connect(Config::instance(), SIGNAL(changed(void)), this, SLOT(slot_config_changed(void)));
@@ -175,6 +337,11 @@ struct lfDatabase *System::ldb(void) {
 }
 */
 
+void System::set_cores(int cores) {
+	forced_cores = cores;
+	apply_config();
+}
+
 void System::update_to_config(void) {
 	apply_config();
 }
@@ -188,6 +355,8 @@ void System::apply_config(void) {
 	Config::instance()->get(CONFIG_SECTION_SYSTEM, "cores", c_cores);
 	if(c_cores_force && c_cores > 0)
 		_cores = c_cores;
+	if(forced_cores > 0)
+		_cores = forced_cores;
 	// SSE2
 #ifdef Q_CC_GNU
 	_sse2 = detected_sse2;
@@ -197,7 +366,46 @@ void System::apply_config(void) {
 			_sse2 = false;
 	}
 #endif
+	// F16C
+	_f16c = detected_f16c;
+	bool c_f16c = false;
+	if(Config::instance()->get(CONFIG_SECTION_SYSTEM, "f16c", c_f16c)) {
+		if(!c_f16c)
+			_f16c = false;
+	}
+	// processing
+	_tiles_parallel = true;
+	Config::instance()->get(CONFIG_SECTION_SYSTEM, "tiles_parallel", _tiles_parallel);
+	// in KB, '0' - disable fused processing
+	_stripe_size = detected_l2_size;
+	int c_stripe_size = 0;
+	if(Config::instance()->get(CONFIG_SECTION_SYSTEM, "stripe_size", c_stripe_size))
+		_stripe_size = (c_stripe_size > 0) ? c_stripe_size * 1024 : 0;
+	_half_float_cache = true;
+	Config::instance()->get(CONFIG_SECTION_SYSTEM, "half_float_cache", _half_float_cache);
+	_preview_lut = true;
+	Config::instance()->get(CONFIG_SECTION_SYSTEM, "preview_lut", _preview_lut);
+	_gp_grid_step = 8;
+	int c_gp_grid_step = 0;
+	if(Config::instance()->get(CONFIG_SECTION_SYSTEM, "gp_grid_step", c_gp_grid_step))
+		_gp_grid_step = (c_gp_grid_step > 1) ? c_gp_grid_step : 0;
+	_resample_lanczos = false;
+	Config::instance()->get(CONFIG_SECTION_SYSTEM, "resample_lanczos", _resample_lanczos);
+	// in Mb, '0' - disable pool of freed memory buffers
+	int c_mem_pool_size = 0;
+	if(Config::instance()->get(CONFIG_SECTION_SYSTEM, "mem_pool_size", c_mem_pool_size))
+		Mem::pool_set_limit((c_mem_pool_size > 0) ? size_t(c_mem_pool_size) * 1024 * 1024 : 0);
+	// in Mb, '0' - unlimited memory budget for processing requests
+	int c_mem_budget = 0;
+	Config::instance()->get(CONFIG_SECTION_SYSTEM, "mem_budget", c_mem_budget);
+	MemBudget::instance()->set_limit((c_mem_budget > 0) ? size_t(c_mem_budget) * 1024 * 1024 : 0);
 	// debug section
+	string trace_file = "";
+	Config::instance()->get(CONFIG_SECTION_SYSTEM, "trace_file", trace_file);
+	const char *env_trace = std::getenv("DDROOM_TRACE");
+	if(env_trace != nullptr)
+		trace_file = env_trace;
+	Trace::open(trace_file);
 }
 
 string System::env_home(void) {
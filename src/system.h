@@ -9,9 +9,11 @@
  *
  */
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include <chrono>
+#include <functional>
 
 #define PROFILER_HIGH_RES_CLOCK
 
@@ -33,6 +35,46 @@ protected:
 	std::string _module;
 };
 
+//------------------------------------------------------------------------------
+// Structured tracing: spans of stages, filters and tiles per thread, barrier waits and memory counters,
+// written as Chrome trace events JSON (chrome://tracing, Perfetto UI). Switched at runtime by config option
+// 'trace_file' or environment variable 'DDROOM_TRACE' with the file name; empty name disables it.
+class Trace {
+public:
+	static bool enabled(void) {return _enabled.load(std::memory_order_relaxed);}
+	static void open(const std::string &file_name);
+	static void close(void);
+	static void flush(void);
+	// microseconds from the start of trace
+	static long now(void);
+	// complete span at the current thread; 'args' - JSON object fields, like "\"tile\":1"
+	static void span(const char *category, const std::string &name, long ts_begin, long ts_end, const std::string &args = "");
+	static void counter(const std::string &name, const std::string &args);
+	// receive each span as it is finished, w/ or w/o trace file; 'nullptr' to remove
+	static void sink_set(std::function<void(const char *category, const std::string &name, long duration)> sink);
+
+protected:
+	static std::atomic_bool _enabled;
+};
+
+// Span from construction till destruction, if tracing is enabled.
+class TraceSpan {
+public:
+	TraceSpan(const char *category, const char *name);
+	TraceSpan(const char *category, const std::string &name);
+	~TraceSpan();
+	void arg(const char *key, long value);
+	// finish span before destruction
+	void end(void);
+
+protected:
+	bool active;
+	const char *category;
+	std::string name;
+	std::string args;
+	long ts_begin;
+};
+
 //------------------------------------------------------------------------------
 //class System : public QObject {
 //	Q_OBJECT
@@ -46,9 +88,26 @@ public:
 	}
 	~System(void);
 	int cores(void) { return _cores; }
+	// override cores count from config, '0' - back to config
+	void set_cores(int cores);
+	// size of physical memory in bytes, '0' if unknown
+	size_t mem_physical(void) { return detected_mem_physical; }
 	static std::string env_home(void);
 	// CPU configuration
 	bool cpu_sse2(void) {return _sse2;}
+	bool cpu_f16c(void) {return _f16c;}
+	// process each tile end-to-end with its own thread, instead of all threads on one tile
+	bool tiles_parallel(void) {return _tiles_parallel;}
+	// size in bytes of the stripe for fused processing of tiled filters, '0' to process the whole tile with each filter
+	int stripe_size(void) {return _stripe_size;}
+	// keep cached results of 'whole' filters as 'half_p4' areas, for interactive processing only
+	bool half_float_cache(void) {return _half_float_cache;}
+	// preview chain of color filters with baked 3D LUT
+	bool preview_lut(void) {return _preview_lut;}
+	// step in pixels of the grid for coordinates of geometry filters, with interpolation between; '0' - process each pixel
+	int gp_grid_step(void) {return _gp_grid_step;}
+	// axis-aligned scaling with Lanczos-3 kernel, instead of box (downscale) and bilinear (upscale) ones
+	bool resample_lanczos(void) {return _resample_lanczos;}
 
 //	struct lfDatabase *ldb(void);
 
@@ -59,11 +118,22 @@ protected:
 	static System *_this;
 	System(void);
 	int _cores;	// believe to constant cores count :)
+	int forced_cores = 0;
 	// CPU configuration
 	bool _sse2;
+	bool _f16c;
+	bool _tiles_parallel;
+	int _stripe_size;
+	bool _half_float_cache;
+	bool _preview_lut;
+	int _gp_grid_step;
+	bool _resample_lanczos;
 
 	int detected_cores;
 	bool detected_sse2;
+	bool detected_f16c;
+	int detected_l2_size;
+	size_t detected_mem_physical;
 	void apply_config(void);
 //	struct lfDatabase *_ldb;
 };
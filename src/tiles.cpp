@@ -83,6 +83,7 @@ TilesReceiver::TilesReceiver(void) {
 	default_tile_length = TILE_LENGTH;
 	default_tile_width = TILE_WIDTH;
 	default_tile_height = TILE_HEIGHT;
+	offline_tile_length = TILE_OFFLINE_LENGTH;
 	do_scale = false;
 	cw_rotation = 0;
 }
@@ -147,6 +148,10 @@ void TilesReceiver::process_done(bool is_thumb) {
 void TilesReceiver::long_wait(bool set) {
 }
 
+void TilesReceiver::set_offline_tile_length(int length) {
+	offline_tile_length = (length < TILES_MIN_SIZE) ? TILES_MIN_SIZE : length;
+}
+
 void TilesReceiver::use_tiling(bool flag, int rotation, Area::format_t _tiles_format) {
 	flag_use_tiling = flag;
 	cw_rotation = rotation;
@@ -222,25 +227,32 @@ TilesDescriptor_t *TilesReceiver::get_tiles(void) {
 	return &tiles_descriptor;
 }
 
+Area::t_dimensions TilesReceiver::scaled_dimensions(const Area::t_dimensions *d, int cw_rotation) {
+	Area::t_dimensions td = *d;
+	if(do_scale) {
+		int r_scaled_width = scaled_width;
+		int r_scaled_height = scaled_height;
+		if(cw_rotation == 90 || cw_rotation == 270)
+			std::swap(r_scaled_width, r_scaled_height);
+		if(scale_to_fit)
+			Area::scale_dimensions_to_size_fit(&td, r_scaled_width, r_scaled_height);
+		else
+			Area::scale_dimensions_to_size_fill(&td, r_scaled_width, r_scaled_height);
+	}
+	return td;
+}
+
 TilesDescriptor_t *TilesReceiver::get_tiles(Area::t_dimensions *d, int cw_rotation, bool is_thumb) {
 	tiles_descriptor.reset();
 	TilesDescriptor_t *t = &tiles_descriptor;
 	t->receiver = this;
-	int r_scaled_width = scaled_width;
-	int r_scaled_height = scaled_height;
-	if(cw_rotation == 90 || cw_rotation == 270)
-		std::swap(r_scaled_width, r_scaled_height);
 	t->post_width = d->width();
 	t->post_height = d->height();
 	// calculate resulting size
 	Area::t_dimensions dimensions_post(*d);
 	if(do_scale && is_thumb == false) {
 		// do resize for process_export()
-		Area::t_dimensions td = *d;
-		if(scale_to_fit)
-			Area::scale_dimensions_to_size_fit(&td, r_scaled_width, r_scaled_height);
-		else
-			Area::scale_dimensions_to_size_fill(&td, r_scaled_width, r_scaled_height);
+		Area::t_dimensions td = scaled_dimensions(d, cw_rotation);
 		t->scale_factor_x = td.position.px_size_x;
 		t->scale_factor_y = td.position.px_size_y;
 		dimensions_post.position.x = td.position.x;
@@ -267,8 +279,8 @@ TilesDescriptor_t *TilesReceiver::get_tiles(Area::t_dimensions *d, int cw_rotati
 		// how much tiles...
 		int *lx;
 		int *ly;
-		const int cx = split_line(dimensions_post.size.w, &lx, TILE_OFFLINE_WIDTH);
-		const int cy = split_line(dimensions_post.size.h, &ly, TILE_OFFLINE_HEIGHT);
+		const int cx = split_line(dimensions_post.size.w, &lx, offline_tile_length);
+		const int cy = split_line(dimensions_post.size.h, &ly, offline_tile_length);
 		const int tiles_count = cx * cy;
 		// ...we should create with indexes mapping...
 		t->index_list = std::list<int>();
@@ -311,6 +323,9 @@ TilesDescriptor_t *TilesReceiver::get_tiles(Area::t_dimensions *d, int cw_rotati
 		int h = height;
 		if(cw_rotation == 90 || cw_rotation == 270)
 			std::swap(w, h);
+		// can be a repeated request, after OOM
+		if(area_image != nullptr)
+			delete area_image;
 		area_image = new Area(w, h, Area::type_for_format(tiles_format));
 	}
 	return t;
@@ -110,12 +110,17 @@ public:
 	virtual TilesDescriptor_t *get_tiles(void);
 	// return splitted and resized tiles with photo size from ::register_forward_dimensions()
 	virtual TilesDescriptor_t *get_tiles(class Area::t_dimensions *, int cw_rotation, bool is_thumb);
+	// size of the result, with scaling of export if any, for photo size from ::register_forward_dimensions()
+	Area::t_dimensions scaled_dimensions(const class Area::t_dimensions *d, int cw_rotation);
 	// argument is next processed tile from the last request
 	virtual void receive_tile(Tile_t *tile, bool is_thumb);
 	// all asked tiles are processed
 	virtual void process_done(bool is_thumb);
 	// notice tiles receiver that processing will took long
 	virtual void long_wait(bool set);
+	// size of tiles for offline processing, can be decreased to fit processing into the memory budget
+	void set_offline_tile_length(int length);
+	int get_offline_tile_length(void) {return offline_tile_length;}
 
 	Area *area_image = nullptr;
 	Area *area_thumb = nullptr;
@@ -131,6 +136,7 @@ protected:
 	int default_tile_length;
 	int default_tile_width;
 	int default_tile_height;
+	int offline_tile_length;
 
 	// last, or only, request ID
 	int request_ID = 0;